@@ -17,6 +17,7 @@
 #define CHRY_SFLASH_ERR_RANGE       3
 #define CHRY_SFLASH_ERR_IO          4
 #define CHRY_SFLASH_ERR_TIMEOUT     5
+#define CHRY_SFLASH_ERR_BUSY        6
 
 #define CHRY_SFLASH_CMDMODE_NONE    0
 #define CHRY_SFLASH_CMDMODE_1LINES  1
@@ -54,11 +55,22 @@
 #define CHRY_SFLASH_IOMODE_QUAD     2
 #define CHRY_SFLASH_IOMODE_OCTAL    3
 
+/* chry_sflash_transfer_batch() flags, the marked request is a status poll using its poll_phase */
+#define CHRY_SFLASH_BATCH_POLL_FIRST (1U << 0)
+#define CHRY_SFLASH_BATCH_POLL_LAST  (1U << 1)
+
+/* one buffer of a scatter-gather data phase */
+struct chry_sflash_segment {
+    uint8_t *buf;
+    uint32_t len;
+};
+
 struct chry_sflash_request {
     uint16_t cs_pin;
     uint16_t freq;
 
     bool dma_enable;
+    bool dtr_enable; /* address, dummy and data phases on both clock edges */
 
     struct {
         uint8_t cmd;
@@ -80,13 +92,27 @@ struct chry_sflash_request {
         uint8_t data_mode;
         uint8_t *buf;
         uint32_t len;
+        /* when seg_count is non-zero the data phase streams these back to back and buf/len are unused */
+        const struct chry_sflash_segment *segs;
+        uint8_t seg_count;
     } data_phase;
+
+    /* only for polls in a batch: repeat the read until (status & mask) == match */
+    struct {
+        uint8_t mask;
+        uint8_t match;
+        uint32_t timeout_ms;
+    } poll_phase;
 };
 
 struct chry_sflash_host {
-    uint32_t spi_idx;
+    uint32_t spi_idx; /* controller or bank of the host, see the port */
     uint8_t iomode;
     uint8_t format;
+    bool dtr_enable; /* controller can do DTR, the core uses it when SFDP allows */
+    bool qpi_enable; /* let the core switch the part to 4-4-4 mode when SFDP allows */
+    bool dual_flash; /* two identical parts on separate data lines, even bytes in the first,
+                        each part gets half the address and status polls wait for both */
     void *user_data;
 };
 
@@ -94,10 +120,92 @@ struct chry_sflash_host {
 extern "C" {
 #endif
 
+/* bytes moved by the data phase, with or without a segment list */
+static inline uint32_t chry_sflash_request_data_len(const struct chry_sflash_request *req)
+{
+    uint32_t len = 0;
+
+    if (req->data_phase.seg_count == 0) {
+        return req->data_phase.len;
+    }
+    for (uint8_t i = 0; i < req->data_phase.seg_count; i++) {
+        len += req->data_phase.segs[i].len;
+    }
+    return len;
+}
+
 int chry_sflash_init(struct chry_sflash_host *host);
 int chry_sflash_deinit(struct chry_sflash_host *host);
 int chry_sflash_set_frequency(struct chry_sflash_host *host, uint32_t freq);
 int chry_sflash_transfer(struct chry_sflash_host *host, struct chry_sflash_request *req);
+int chry_sflash_memory_map(struct chry_sflash_host *host, struct chry_sflash_request *req, void **addr);
+int chry_sflash_poll_status(struct chry_sflash_host *host, struct chry_sflash_request *req, uint8_t mask, uint8_t match, uint32_t timeout_ms);
+/*
+ * Run n requests back to back in the port, e.g. status poll, WREN, program
+ * and status poll. Stops at the first error and returns it.
+ */
+int chry_sflash_transfer_batch(struct chry_sflash_host *host, struct chry_sflash_request *reqs, uint32_t n, uint32_t flags);
+uint32_t chry_sflash_get_tick_ms(struct chry_sflash_host *host);
+/*
+ * Bus lock of the host, implemented by the port. The NOR and NAND cores
+ * hold it for each call so several threads can share a host, hosts on
+ * different controllers lock independently. It must nest, the cores call
+ * their own API with it held. Bare-metal ports leave it empty.
+ */
+void chry_sflash_lock(struct chry_sflash_host *host);
+void chry_sflash_unlock(struct chry_sflash_host *host);
+uint32_t chry_sflash_crc32_update(uint32_t crc, const uint8_t *buf, uint32_t len);
+
+#ifdef CONFIG_CHRY_SFLASH_ASYNC
+/*
+ * Asynchronous transfers. The request is copied into an entry of a fixed
+ * pool (CONFIG_CHRY_SFLASH_ASYNC_DEPTH) and queued, its buffers and
+ * segment list must stay valid until the callback. Callbacks run in
+ * interrupt or worker context, short transfers may complete before the
+ * submit returns. A submit that returns an error never calls back.
+ */
+
+/*
+ * Longest data phase the cores put in one async transfer, longer reads go
+ * as several. The default fits the 16-bit transfer count of the STM32
+ * QUADSPI DMA and is a whole number of 32-byte cache lines and even for
+ * dual-flash, so every piece keeps the alignment of the first.
+ */
+#ifndef CONFIG_CHRY_SFLASH_ASYNC_MAX_LEN
+#define CONFIG_CHRY_SFLASH_ASYNC_MAX_LEN (0xFFE0U)
+#endif
+
+typedef void (*chry_sflash_callback_t)(struct chry_sflash_host *host, int status, void *arg);
+
+struct chry_sflash_async_xfer {
+    struct chry_sflash_async_xfer *next;
+    struct chry_sflash_host *host;
+    struct chry_sflash_request req;
+    bool poll; /* status poll, req reads the status register */
+    uint8_t mask;
+    uint8_t match;
+    uint32_t timeout_ms;
+    chry_sflash_callback_t callback;
+    void *arg;
+};
+
+int chry_sflash_transfer_async(struct chry_sflash_host *host, struct chry_sflash_request *req, chry_sflash_callback_t callback, void *arg);
+int chry_sflash_poll_status_async(struct chry_sflash_host *host, struct chry_sflash_request *req, uint8_t mask, uint8_t match, uint32_t timeout_ms,
+                                  chry_sflash_callback_t callback, void *arg);
+
+/* called by the port when the transfer started by chry_sflash_async_start() is done */
+void chry_sflash_async_complete(struct chry_sflash_host *host, int status);
+
+/*
+ * Implemented by the port. chry_sflash_async_start() returns 1 when the
+ * transfer is in flight and chry_sflash_async_complete() will follow,
+ * otherwise the transfer already ran and the result is returned. The lock
+ * keeps the completion context out of the queue.
+ */
+int chry_sflash_async_start(struct chry_sflash_async_xfer *xfer);
+void chry_sflash_async_lock(struct chry_sflash_host *host);
+void chry_sflash_async_unlock(struct chry_sflash_host *host);
+#endif
 
 #ifdef __cplusplus
 }
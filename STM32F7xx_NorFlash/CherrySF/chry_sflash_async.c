@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2024, sakumisu
+ * Copyright (c) 2024, RCSN
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "chry_sflash.h"
+
+/*
+ * Request queue behind chry_sflash_transfer_async(). Entries come from a
+ * fixed pool, the head of the queue is the one the port is running. There
+ * is one queue for all hosts, transfers of different hosts run one after
+ * another and the port's async lock has to cover all of them.
+ */
+#ifdef CONFIG_CHRY_SFLASH_ASYNC
+
+#ifndef CONFIG_CHRY_SFLASH_ASYNC_DEPTH
+#define CONFIG_CHRY_SFLASH_ASYNC_DEPTH 8
+#endif
+
+static struct chry_sflash_async_xfer async_pool[CONFIG_CHRY_SFLASH_ASYNC_DEPTH];
+static struct chry_sflash_async_xfer *async_free;
+static struct chry_sflash_async_xfer *async_head;
+static struct chry_sflash_async_xfer *async_tail;
+static bool async_pool_ready;
+
+/* call back for the head and release it, returns the next entry to start */
+static struct chry_sflash_async_xfer *chry_sflash_async_finish(struct chry_sflash_host *host, int status)
+{
+    struct chry_sflash_async_xfer *xfer = async_head;
+    struct chry_sflash_async_xfer *next;
+
+    /* the head stays queued during the callback, so a submit from it only appends */
+    xfer->callback(host, status, xfer->arg);
+
+    chry_sflash_async_lock(host);
+    async_head = xfer->next;
+    if (async_head == NULL) {
+        async_tail = NULL;
+    }
+    xfer->next = async_free;
+    async_free = xfer;
+    next = async_head;
+    chry_sflash_async_unlock(host);
+
+    return next;
+}
+
+/* start entries until one stays in flight, synchronous completions loop here instead of recursing */
+static void chry_sflash_async_run(struct chry_sflash_async_xfer *xfer)
+{
+    int ret;
+
+    while (xfer != NULL) {
+        ret = chry_sflash_async_start(xfer);
+        if (ret == 1) {
+            return;
+        }
+        xfer = chry_sflash_async_finish(xfer->host, ret);
+    }
+}
+
+static int chry_sflash_async_submit(struct chry_sflash_host *host, struct chry_sflash_async_xfer *tmpl)
+{
+    struct chry_sflash_async_xfer *xfer;
+    bool start;
+
+    if (tmpl->callback == NULL) {
+        return -CHRY_SFLASH_ERR_INVAL;
+    }
+
+    chry_sflash_async_lock(host);
+    if (!async_pool_ready) {
+        for (uint32_t i = 0; i < CONFIG_CHRY_SFLASH_ASYNC_DEPTH; i++) {
+            async_pool[i].next = async_free;
+            async_free = &async_pool[i];
+        }
+        async_pool_ready = true;
+    }
+    xfer = async_free;
+    if (xfer == NULL) {
+        chry_sflash_async_unlock(host);
+        return -CHRY_SFLASH_ERR_NOMEM;
+    }
+    async_free = xfer->next;
+
+    *xfer = *tmpl;
+    xfer->next = NULL;
+    start = (async_head == NULL);
+    if (start) {
+        async_head = xfer;
+    } else {
+        async_tail->next = xfer;
+    }
+    async_tail = xfer;
+    chry_sflash_async_unlock(host);
+
+    if (start) {
+        chry_sflash_async_run(xfer);
+    }
+    return 0;
+}
+
+int chry_sflash_transfer_async(struct chry_sflash_host *host, struct chry_sflash_request *req, chry_sflash_callback_t callback, void *arg)
+{
+    struct chry_sflash_async_xfer xfer = { 0 };
+
+    xfer.host = host;
+    xfer.req = *req;
+    xfer.callback = callback;
+    xfer.arg = arg;
+
+    return chry_sflash_async_submit(host, &xfer);
+}
+
+int chry_sflash_poll_status_async(struct chry_sflash_host *host, struct chry_sflash_request *req, uint8_t mask, uint8_t match, uint32_t timeout_ms,
+                                  chry_sflash_callback_t callback, void *arg)
+{
+    struct chry_sflash_async_xfer xfer = { 0 };
+
+    xfer.host = host;
+    xfer.req = *req;
+    xfer.poll = true;
+    xfer.mask = mask;
+    xfer.match = match;
+    xfer.timeout_ms = timeout_ms;
+    xfer.callback = callback;
+    xfer.arg = arg;
+
+    return chry_sflash_async_submit(host, &xfer);
+}
+
+void chry_sflash_async_complete(struct chry_sflash_host *host, int status)
+{
+    if (async_head == NULL) {
+        return;
+    }
+    chry_sflash_async_run(chry_sflash_async_finish(host, status));
+}
+
+#endif
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2024, sakumisu
+ * Copyright (c) 2024, RCSN
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "chry_sflash.h"
+
+/*
+ * CRC-32 (IEEE 802.3, reflected, same result as zlib crc32).
+ * Ports with a CRC unit define CONFIG_CHRY_SFLASH_CRC32_HW and provide
+ * chry_sflash_crc32_update() themselves.
+ */
+#ifndef CONFIG_CHRY_SFLASH_CRC32_HW
+
+#define CRC32_POLY_REFLECTED (0xEDB88320UL)
+
+static uint32_t crc32_table[8][256];
+static bool crc32_table_ready;
+
+static void chry_sflash_crc32_init_table(void)
+{
+    uint32_t crc;
+    uint32_t i, j;
+
+    for (i = 0; i < 256; i++) {
+        crc = i;
+        for (j = 0; j < 8; j++) {
+            crc = (crc >> 1) ^ ((crc & 1U) ? CRC32_POLY_REFLECTED : 0U);
+        }
+        crc32_table[0][i] = crc;
+    }
+
+    /* table[n][i] is the crc of byte i followed by n zero bytes */
+    for (i = 0; i < 256; i++) {
+        crc = crc32_table[0][i];
+        for (j = 1; j < 8; j++) {
+            crc = (crc >> 8) ^ crc32_table[0][crc & 0xFFU];
+            crc32_table[j][i] = crc;
+        }
+    }
+    crc32_table_ready = true;
+}
+
+uint32_t chry_sflash_crc32_update(uint32_t crc, const uint8_t *buf, uint32_t len)
+{
+    uint32_t one, two;
+
+    if (!crc32_table_ready) {
+        chry_sflash_crc32_init_table();
+    }
+
+    crc = ~crc;
+
+    /* slice-by-8, eight table lookups per 8 input bytes */
+    while (len >= 8) {
+        one = crc ^ ((uint32_t)buf[0] | ((uint32_t)buf[1] << 8) | ((uint32_t)buf[2] << 16) | ((uint32_t)buf[3] << 24));
+        two = (uint32_t)buf[4] | ((uint32_t)buf[5] << 8) | ((uint32_t)buf[6] << 16) | ((uint32_t)buf[7] << 24);
+        crc = crc32_table[7][one & 0xFFU] ^
+              crc32_table[6][(one >> 8) & 0xFFU] ^
+              crc32_table[5][(one >> 16) & 0xFFU] ^
+              crc32_table[4][one >> 24] ^
+              crc32_table[3][two & 0xFFU] ^
+              crc32_table[2][(two >> 8) & 0xFFU] ^
+              crc32_table[1][(two >> 16) & 0xFFU] ^
+              crc32_table[0][two >> 24];
+        buf += 8;
+        len -= 8;
+    }
+
+    while (len--) {
+        crc = (crc >> 8) ^ crc32_table[0][(crc ^ *buf++) & 0xFFU];
+    }
+
+    return ~crc;
+}
+
+#endif
@@ -80,26 +80,34 @@ static inline int chry_sflash_nandflash_select_buf_mode(struct chry_sflash_nandf
     return ret;
 }
 
-static inline int chry_sflash_nandflash_send_command_data(struct chry_sflash_nandflash *flash, uint8_t command, uint8_t dummy_bytes, uint8_t *data, uint32_t len)
+static inline void chry_sflash_nandflash_fill_command_seq(struct chry_sflash_request *command_seq, uint8_t command, uint8_t dummy_bytes, uint8_t *data, uint32_t len)
 {
-    struct chry_sflash_host *host = flash->host;
-    struct chry_sflash_request command_seq = { 0 };
-
-    command_seq.dma_enable = false;
-    command_seq.cmd_phase.cmd = command;
-    command_seq.cmd_phase.cmd_mode = CHRY_SFLASH_CMDMODE_1LINES;
-    command_seq.dummy_phase.dummy_bytes = dummy_bytes;
-    command_seq.data_phase.direction = CHRY_SFLASH_DATA_WRITE;
-    command_seq.data_phase.data_mode = CHRY_SFLASH_DATAMODE_1LINES;
-    command_seq.data_phase.buf = data;
-    command_seq.data_phase.len = len;
-
-    return chry_sflash_transfer(host, &command_seq);
+    command_seq->dma_enable = false;
+    command_seq->cmd_phase.cmd = command;
+    command_seq->cmd_phase.cmd_mode = CHRY_SFLASH_CMDMODE_1LINES;
+    command_seq->dummy_phase.dummy_bytes = dummy_bytes;
+    command_seq->data_phase.direction = CHRY_SFLASH_DATA_WRITE;
+    command_seq->data_phase.data_mode = CHRY_SFLASH_DATAMODE_1LINES;
+    command_seq->data_phase.buf = data;
+    command_seq->data_phase.len = len;
 }
 
-static inline int chry_sflash_nandflash_check_status(struct chry_sflash_nandflash *flash, uint8_t *status)
+/* SR3 read polled for OIP to clear, status returns the final SR3 for the fail bits */
+static void chry_sflash_nandflash_fill_poll_seq(struct chry_sflash_request *command_seq, uint8_t *status)
 {
-    return chry_sflash_nandflash_read_status_register(flash, NANDFLASH_SR3_ADDR, status);
+    command_seq->dma_enable = false;
+    command_seq->cmd_phase.cmd = NANDFLASH_COMMAND_READ_STATUS_REG;
+    command_seq->cmd_phase.cmd_mode = CHRY_SFLASH_CMDMODE_1LINES;
+    command_seq->addr_phase.addr = NANDFLASH_SR3_ADDR;
+    command_seq->addr_phase.addr_mode = CHRY_SFLASH_ADDRMODE_1LINES;
+    command_seq->addr_phase.addr_size = CHRY_SFLASH_ADDRSIZE_8BITS;
+    command_seq->data_phase.direction = CHRY_SFLASH_DATA_READ;
+    command_seq->data_phase.data_mode = CHRY_SFLASH_DATAMODE_1LINES;
+    command_seq->data_phase.buf = status;
+    command_seq->data_phase.len = 1;
+    command_seq->poll_phase.mask = NANDFLASH_SR3_BUSY;
+    command_seq->poll_phase.match = 0;
+    command_seq->poll_phase.timeout_ms = NANDFLASH_BUSY_TIMEOUT_MS;
 }
 
 int chry_sflash_nandflash_init(struct chry_sflash_nandflash *flash, struct chry_sflash_host *host)
@@ -196,39 +204,77 @@ int chry_sflash_nandflash_erase(struct chry_sflash_nandflash *flash, uint32_t bl
     int ret;
     uint8_t status;
     uint8_t page_addr_buf[2];
+    struct chry_sflash_request command_seq[3] = { 0 };
 
     if (block > flash->total_blocks) {
         return -CHRY_SFLASH_ERR_RANGE;
     }
 
-    ret = chry_sflash_nandflash_send_command_data(flash, NANDFLASH_COMMAND_WRITE_ENABLE, 0, NULL, 0);
-    if (ret < 0) {
-        return ret;
-    }
-
     page_addr_buf[0] = ((block * flash->pages_per_block) >> 8) & 0xff;
     page_addr_buf[1] = (block * flash->pages_per_block) & 0xff;
-    ret = chry_sflash_nandflash_send_command_data(flash, NANDFLASH_COMMAND_BLOCK_ERASE, 1, page_addr_buf, 2);
+
+    chry_sflash_nandflash_fill_command_seq(&command_seq[0], NANDFLASH_COMMAND_WRITE_ENABLE, 0, NULL, 0);
+    chry_sflash_nandflash_fill_command_seq(&command_seq[1], NANDFLASH_COMMAND_BLOCK_ERASE, 1, page_addr_buf, 2);
+    chry_sflash_nandflash_fill_poll_seq(&command_seq[2], &status);
+
+    chry_sflash_lock(flash->host);
+    ret = chry_sflash_transfer_batch(flash->host, command_seq, 3, CHRY_SFLASH_BATCH_POLL_LAST);
+    chry_sflash_unlock(flash->host);
     if (ret < 0) {
         return ret;
     }
-
-    while (1) {
-        ret = chry_sflash_nandflash_check_status(flash, &status);
-        if (ret < 0) {
-            return ret;
-        }
-        if (!(status & NANDFLASH_SR3_BUSY)) {
-            if (status & NANDFLASH_SR3_ERASE_FAIL) {
-                return -CHRY_SFLASH_ERR_IO;
-            }
-            break;
-        }
+    if (status & NANDFLASH_SR3_ERASE_FAIL) {
+        return -CHRY_SFLASH_ERR_IO;
     }
 
     return 0;
 }
 
+/*
+ * Requests moving main data and spare between the host and the page
+ * cache, built from the page_seq template. A full page and its spare are
+ * contiguous in the cache, they go as one transaction with two segments,
+ * otherwise each part gets its own. Returns the number of requests.
+ */
+static uint32_t chry_sflash_nandflash_fill_page_seqs(struct chry_sflash_nandflash *flash,
+                                                     const struct chry_sflash_request *page_seq,
+                                                     struct chry_sflash_request *command_seq,
+                                                     struct chry_sflash_segment *segs,
+                                                     uint8_t *buf,
+                                                     uint32_t buflen,
+                                                     uint8_t *spare,
+                                                     uint32_t spare_len)
+{
+    uint32_t n = 0;
+
+    if (buf && (buflen == flash->bytes_per_page) && spare && spare_len) {
+        segs[0].buf = buf;
+        segs[0].len = buflen;
+        segs[1].buf = spare;
+        segs[1].len = spare_len;
+        command_seq[n] = *page_seq;
+        command_seq[n].addr_phase.addr = 0;
+        command_seq[n].data_phase.segs = segs;
+        command_seq[n++].data_phase.seg_count = 2;
+        return n;
+    }
+
+    if (buf && buflen) {
+        command_seq[n] = *page_seq;
+        command_seq[n].addr_phase.addr = 0;
+        command_seq[n].data_phase.buf = buf;
+        command_seq[n++].data_phase.len = buflen;
+    }
+
+    if (spare && spare_len) {
+        command_seq[n] = *page_seq;
+        command_seq[n].addr_phase.addr = flash->bytes_per_page;
+        command_seq[n].data_phase.buf = spare;
+        command_seq[n++].data_phase.len = spare_len;
+    }
+    return n;
+}
+
 int chry_sflash_nandflash_write(struct chry_sflash_nandflash *flash,
                                     uint32_t block,
                                     uint32_t page,
@@ -240,67 +286,43 @@ int chry_sflash_nandflash_write(struct chry_sflash_nandflash *flash,
     int ret;
     uint8_t status;
     uint8_t page_addr_buf[2];
-    struct chry_sflash_host *host = flash->host;
-    struct chry_sflash_request command_seq = { 0 };
+    struct chry_sflash_request page_seq = { 0 };
+    struct chry_sflash_request command_seq[5] = { 0 };
+    struct chry_sflash_segment segs[2];
+    uint32_t n = 0;
 
     if (block > flash->total_blocks || page > flash->pages_per_block || (buflen && (buflen > flash->bytes_per_page)) || (spare_len && (spare_len > flash->spare_bytes_per_page))) {
         return -CHRY_SFLASH_ERR_RANGE;
     }
 
-    command_seq.dma_enable = true;
-    command_seq.cmd_phase.cmd = flash->program_cmd;
-    command_seq.cmd_phase.cmd_mode = CHRY_SFLASH_CMDMODE_1LINES;
-    command_seq.addr_phase.addr_mode = flash->program_addr_mode;
-    command_seq.addr_phase.addr_size = CHRY_SFLASH_ADDRSIZE_16BITS;
-    command_seq.data_phase.direction = CHRY_SFLASH_DATA_WRITE;
-    command_seq.data_phase.data_mode = flash->program_data_mode;
-
-    ret = chry_sflash_nandflash_send_command_data(flash, NANDFLASH_COMMAND_WRITE_ENABLE, 0, NULL, 0);
-    if (ret < 0) {
-        return ret;
-    }
-
-    if (buf && buflen) {
-        command_seq.addr_phase.addr = 0;
-        command_seq.data_phase.buf = buf;
-        command_seq.data_phase.len = buflen;
-        ret = chry_sflash_transfer(host, &command_seq);
-        if (ret < 0) {
-            return ret;
-        }
-    }
-
-    if (spare && spare_len) {
-        command_seq.addr_phase.addr = flash->bytes_per_page;
-        command_seq.data_phase.buf = spare;
-        command_seq.data_phase.len = spare_len;
-        ret = chry_sflash_transfer(host, &command_seq);
-        if (ret < 0) {
-            return ret;
-        }
-    }
+    page_seq.dma_enable = true;
+    page_seq.cmd_phase.cmd = flash->program_cmd;
+    page_seq.cmd_phase.cmd_mode = CHRY_SFLASH_CMDMODE_1LINES;
+    page_seq.addr_phase.addr_mode = flash->program_addr_mode;
+    page_seq.addr_phase.addr_size = CHRY_SFLASH_ADDRSIZE_16BITS;
+    page_seq.data_phase.direction = CHRY_SFLASH_DATA_WRITE;
+    page_seq.data_phase.data_mode = flash->program_data_mode;
 
     page_addr_buf[0] = ((page + block * flash->pages_per_block) >> 8) & 0xff;
     page_addr_buf[1] = (page + block * flash->pages_per_block) & 0xff;
-    ret = chry_sflash_nandflash_send_command_data(flash, NANDFLASH_COMMAND_PROGRAM_EXECUTE, 1, page_addr_buf, 2);
+
+    /* WREN, program data load, program execute and the busy poll as one batch */
+    chry_sflash_nandflash_fill_command_seq(&command_seq[n++], NANDFLASH_COMMAND_WRITE_ENABLE, 0, NULL, 0);
+    n += chry_sflash_nandflash_fill_page_seqs(flash, &page_seq, &command_seq[n], segs, buf, buflen, spare, spare_len);
+    chry_sflash_nandflash_fill_command_seq(&command_seq[n++], NANDFLASH_COMMAND_PROGRAM_EXECUTE, 1, page_addr_buf, 2);
+    chry_sflash_nandflash_fill_poll_seq(&command_seq[n++], &status);
+
+    chry_sflash_lock(flash->host);
+    ret = chry_sflash_transfer_batch(flash->host, command_seq, n, CHRY_SFLASH_BATCH_POLL_LAST);
+    chry_sflash_unlock(flash->host);
     if (ret < 0) {
         return ret;
     }
-
-    while (1) {
-        ret = chry_sflash_nandflash_check_status(flash, &status);
-        if (ret < 0) {
-            return ret;
-        }
-        if (!(status & NANDFLASH_SR3_BUSY)) {
-            if (status & NANDFLASH_SR3_PROGRAM_FAIL) {
-                return -CHRY_SFLASH_ERR_IO;
-            }
-            if (((status & NANDFLASH_SR3_ECC_STATUS_MASK) >> NANDFLASH_SR3_ECC_STATUS_SHIFT) > 1) {
-                return -CHRY_SFLASH_ERR_IO;
-            }
-            break;
-        }
+    if (status & NANDFLASH_SR3_PROGRAM_FAIL) {
+        return -CHRY_SFLASH_ERR_IO;
+    }
+    if (((status & NANDFLASH_SR3_ECC_STATUS_MASK) >> NANDFLASH_SR3_ECC_STATUS_SHIFT) > 1) {
+        return -CHRY_SFLASH_ERR_IO;
     }
 
     return 0;
@@ -317,66 +339,41 @@ int chry_sflash_nandflash_read(struct chry_sflash_nandflash *flash,
     int ret;
     uint8_t status;
     uint8_t page_addr_buf[2];
-    struct chry_sflash_host *host = flash->host;
-    struct chry_sflash_request command_seq = { 0 };
-
-    command_seq.dma_enable = true;
-    command_seq.cmd_phase.cmd = flash->read_cmd;
-    command_seq.cmd_phase.cmd_mode = CHRY_SFLASH_CMDMODE_1LINES;
-    command_seq.addr_phase.addr_mode = flash->read_addr_mode;
-    command_seq.addr_phase.addr_size = CHRY_SFLASH_ADDRSIZE_16BITS;
-    command_seq.dummy_phase.dummy_bytes = flash->read_dummy_bytes;
-    command_seq.data_phase.direction = CHRY_SFLASH_DATA_READ;
-    command_seq.data_phase.data_mode = flash->read_data_mode;
+    struct chry_sflash_request page_seq = { 0 };
+    struct chry_sflash_request command_seq[4] = { 0 };
+    struct chry_sflash_segment segs[2];
+    uint32_t n = 0;
+
+    page_seq.dma_enable = true;
+    page_seq.cmd_phase.cmd = flash->read_cmd;
+    page_seq.cmd_phase.cmd_mode = CHRY_SFLASH_CMDMODE_1LINES;
+    page_seq.addr_phase.addr_mode = flash->read_addr_mode;
+    page_seq.addr_phase.addr_size = CHRY_SFLASH_ADDRSIZE_16BITS;
+    page_seq.dummy_phase.dummy_bytes = flash->read_dummy_bytes;
+    page_seq.data_phase.direction = CHRY_SFLASH_DATA_READ;
+    page_seq.data_phase.data_mode = flash->read_data_mode;
 
     page_addr_buf[0] = ((page + block * flash->pages_per_block) >> 8) & 0xff;
     page_addr_buf[1] = (page + block * flash->pages_per_block) & 0xff;
-    ret = chry_sflash_nandflash_send_command_data(flash, NANDFLASH_COMMAND_PAGE_DATA_READ_INTO_CACHE, 1, page_addr_buf, 2);
-    if (ret < 0) {
-        return ret;
-    }
 
-    while (1) {
-        ret = chry_sflash_nandflash_check_status(flash, &status);
-        if (ret < 0) {
-            return ret;
-        }
-        if (!(status & NANDFLASH_SR3_BUSY)) {
-            break;
-        }
-    }
-
-    if (buf && buflen) {
-        command_seq.addr_phase.addr = 0;
-        command_seq.data_phase.buf = buf;
-        command_seq.data_phase.len = buflen;
-        ret = chry_sflash_transfer(host, &command_seq);
-        if (ret < 0) {
-            return ret;
-        }
+    /* page read into the cache and its busy poll, then the cache reads and the final status */
+    chry_sflash_nandflash_fill_command_seq(&command_seq[0], NANDFLASH_COMMAND_PAGE_DATA_READ_INTO_CACHE, 1, page_addr_buf, 2);
+    chry_sflash_nandflash_fill_poll_seq(&command_seq[1], &status);
+
+    /* the page cache is shared, no other thread may load a page between the two batches */
+    chry_sflash_lock(flash->host);
+    ret = chry_sflash_transfer_batch(flash->host, command_seq, 2, CHRY_SFLASH_BATCH_POLL_LAST);
+    if (ret == 0) {
+        n = chry_sflash_nandflash_fill_page_seqs(flash, &page_seq, command_seq, segs, buf, buflen, spare, spare_len);
+        chry_sflash_nandflash_fill_poll_seq(&command_seq[n++], &status);
+        ret = chry_sflash_transfer_batch(flash->host, command_seq, n, CHRY_SFLASH_BATCH_POLL_LAST);
     }
-
-    if (spare && spare_len) {
-        command_seq.addr_phase.addr = flash->bytes_per_page;
-        command_seq.data_phase.buf = spare;
-        command_seq.data_phase.len = spare_len;
-        ret = chry_sflash_transfer(host, &command_seq);
-        if (ret < 0) {
-            return ret;
-        }
+    chry_sflash_unlock(flash->host);
+    if (ret < 0) {
+        return ret;
     }
-
-    while (1) {
-        ret = chry_sflash_nandflash_check_status(flash, &status);
-        if (ret < 0) {
-            return ret;
-        }
-        if (!(status & NANDFLASH_SR3_BUSY)) {
-            if (((status & NANDFLASH_SR3_ECC_STATUS_MASK) >> NANDFLASH_SR3_ECC_STATUS_SHIFT) > 1) {
-                return -CHRY_SFLASH_ERR_IO;
-            }
-            break;
-        }
+    if (((status & NANDFLASH_SR3_ECC_STATUS_MASK) >> NANDFLASH_SR3_ECC_STATUS_SHIFT) > 1) {
+        return -CHRY_SFLASH_ERR_IO;
     }
 
     return 0;
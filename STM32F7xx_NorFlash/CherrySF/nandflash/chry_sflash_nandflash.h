@@ -61,6 +61,9 @@
 #define NANDFLASH_SR3_ECC_STATUS_MASK                   (0x3 << NANDFLASH_SR3_ECC_STATUS_SHIFT)
 #define NANDFLASH_SR3_BBM_LUT_FULL                      (1 << 6)
 
+/* Upper bound for one block erase, page program or page read into cache */
+#define NANDFLASH_BUSY_TIMEOUT_MS                       (100U)
+
 struct chry_sflash_nandflash {
     struct chry_sflash_host *host;
     const char *name;
@@ -8,6 +8,13 @@
 
 #define MAX_24BIT_ADDRESSING_SIZE ((1UL << 24))
 
+#ifdef CONFIG_CHRY_SFLASH_ASYNC
+#define NORFLASH_ASYNC_OP_NONE         0
+#define NORFLASH_ASYNC_OP_ERASE        1
+#define NORFLASH_ASYNC_OP_WRITE        2
+#define NORFLASH_ASYNC_OP_READ         3
+#endif
+
 /**
  * @brief QE bit enable sequence option
  */
@@ -19,10 +26,13 @@ typedef enum {
     spi_nor_quad_en_set_bi1_in_status_reg2_via_0x31_cmd = 4U, /**< QE bit is in status register 2 and configured by CMD 0x31 */
 } spi_nor_quad_enable_seq_t;
 
-static inline int chry_sflash_norflash_read_sfdp(struct chry_sflash_norflash *flash, uint32_t addr, uint8_t *buffer, uint32_t buflen)
+static int chry_sflash_norflash_read_sfdp(struct chry_sflash_norflash *flash, uint32_t addr, uint8_t *buffer, uint32_t buflen)
 {
     struct chry_sflash_host *host = flash->host;
     struct chry_sflash_request command_seq = { 0 };
+    uint8_t pairs[32];
+    uint32_t chunk;
+    int ret;
 
     command_seq.dma_enable = false;
     command_seq.cmd_phase.cmd = NORFLASH_COMMAND_READ_SFDP;
@@ -36,7 +46,50 @@ static inline int chry_sflash_norflash_read_sfdp(struct chry_sflash_norflash *fl
     command_seq.data_phase.buf = buffer;
     command_seq.data_phase.len = buflen;
 
-    return chry_sflash_transfer(host, &command_seq);
+    if (!host->dual_flash) {
+        return chry_sflash_transfer(host, &command_seq);
+    }
+
+    /* dual-flash: both parts answer at half the address, keep the first one's bytes */
+    command_seq.data_phase.buf = pairs;
+    while (buflen > 0) {
+        chunk = (buflen > sizeof(pairs) / 2) ? sizeof(pairs) / 2 : buflen;
+        command_seq.addr_phase.addr = addr * 2;
+        command_seq.data_phase.len = chunk * 2;
+
+        ret = chry_sflash_transfer(host, &command_seq);
+        if (ret < 0) {
+            return ret;
+        }
+        for (uint32_t i = 0; i < chunk; i++) {
+            /* the parameters only describe both if the parts are the same */
+            if (pairs[i * 2] != pairs[i * 2 + 1]) {
+                return -CHRY_SFLASH_ERR_INVAL;
+            }
+            buffer[i] = pairs[i * 2];
+        }
+        addr += chunk;
+        buffer += chunk;
+        buflen -= chunk;
+    }
+    return 0;
+}
+
+/* the blocking calls stay off the part while a non-blocking operation runs on it */
+static inline bool chry_sflash_norflash_async_busy(struct chry_sflash_norflash *flash)
+{
+#ifdef CONFIG_CHRY_SFLASH_ASYNC
+    return flash->async.op != NORFLASH_ASYNC_OP_NONE;
+#else
+    return false;
+#endif
+}
+
+static inline void chry_sflash_norflash_fill_command_seq(struct chry_sflash_norflash *flash, struct chry_sflash_request *command_seq, uint8_t command)
+{
+    command_seq->dma_enable = false;
+    command_seq->cmd_phase.cmd = command;
+    command_seq->cmd_phase.cmd_mode = flash->cmd_mode;
 }
 
 static inline int chry_sflash_norflash_send_command(struct chry_sflash_norflash *flash, uint8_t command)
@@ -44,9 +97,7 @@ static inline int chry_sflash_norflash_send_command(struct chry_sflash_norflash
     struct chry_sflash_host *host = flash->host;
     struct chry_sflash_request command_seq = { 0 };
 
-    command_seq.dma_enable = false;
-    command_seq.cmd_phase.cmd = command;
-    command_seq.cmd_phase.cmd_mode = CHRY_SFLASH_CMDMODE_1LINES;
+    chry_sflash_norflash_fill_command_seq(flash, &command_seq, command);
 
     return chry_sflash_transfer(host, &command_seq);
 }
@@ -55,46 +106,194 @@ static inline int chry_sflash_norflash_read_status_register(struct chry_sflash_n
 {
     struct chry_sflash_host *host = flash->host;
     struct chry_sflash_request command_seq = { 0 };
+    uint8_t status[2];
+    int ret;
 
     command_seq.dma_enable = false;
     command_seq.cmd_phase.cmd = command;
-    command_seq.cmd_phase.cmd_mode = CHRY_SFLASH_CMDMODE_1LINES;
-    command_seq.data_phase.data_mode = CHRY_SFLASH_DATAMODE_1LINES;
+    command_seq.cmd_phase.cmd_mode = flash->cmd_mode;
+    command_seq.data_phase.data_mode = flash->cmd_mode;
     command_seq.data_phase.direction = CHRY_SFLASH_DATA_READ;
-    command_seq.data_phase.buf = reg_data;
-    command_seq.data_phase.len = sizeof(uint8_t);
+    command_seq.data_phase.buf = status;
+    command_seq.data_phase.len = host->dual_flash ? 2 : 1;
 
-    return chry_sflash_transfer(host, &command_seq);
+    ret = chry_sflash_transfer(host, &command_seq);
+    /* dual-flash: one byte per part, a bit only counts as set when both have it */
+    *reg_data = host->dual_flash ? (status[0] & status[1]) : status[0];
+    return ret;
 }
 
-static inline int chry_sflash_norflash_is_busy(struct chry_sflash_norflash *flash, bool *busy)
+static void chry_sflash_norflash_fill_status_seq(struct chry_sflash_norflash *flash, struct chry_sflash_request *command_seq)
 {
-    uint8_t sr = 0;
-    int ret;
+    command_seq->dma_enable = false;
+    command_seq->cmd_phase.cmd = NORFLASH_COMMAND_READ_STATUS_REG1;
+    command_seq->cmd_phase.cmd_mode = flash->cmd_mode;
+    command_seq->data_phase.data_mode = flash->cmd_mode;
+    command_seq->data_phase.direction = CHRY_SFLASH_DATA_READ;
+    command_seq->data_phase.len = sizeof(uint8_t);
+}
 
-    ret = chry_sflash_norflash_read_status_register(flash, NORFLASH_COMMAND_READ_STATUS_REG1, &sr);
-    if (ret < 0) {
-        return ret;
-    }
-    *busy = (sr & 0b1) ? true : false;
-    return 0;
+/* status read polled for WIP (SR1 bit 0) to clear when it runs in a batch */
+static void chry_sflash_norflash_fill_poll_seq(struct chry_sflash_norflash *flash, struct chry_sflash_request *command_seq, uint32_t timeout_ms)
+{
+    chry_sflash_norflash_fill_status_seq(flash, command_seq);
+    command_seq->poll_phase.mask = 0x01;
+    command_seq->poll_phase.match = 0x00;
+    command_seq->poll_phase.timeout_ms = timeout_ms;
 }
 
-static int chry_sflash_norflash_write_status_register(struct chry_sflash_norflash *flash, uint8_t command, uint8_t reg_data)
+static int chry_sflash_norflash_wait_ready(struct chry_sflash_norflash *flash, uint32_t timeout_ms)
+{
+    struct chry_sflash_request command_seq = { 0 };
+
+    chry_sflash_norflash_fill_status_seq(flash, &command_seq);
+
+    /* wait for WIP (SR1 bit 0) to clear */
+    return chry_sflash_poll_status(flash->host, &command_seq, 0x01, 0x00, timeout_ms);
+}
+
+/* WIP of the part, in dual-flash of either part */
+static int chry_sflash_norflash_read_busy(struct chry_sflash_norflash *flash, bool *busy)
 {
-    struct chry_sflash_host *host = flash->host;
     struct chry_sflash_request command_seq = { 0 };
+    uint8_t status[2] = { 0 };
     int ret;
+
+    chry_sflash_norflash_fill_status_seq(flash, &command_seq);
+    command_seq.data_phase.buf = status;
+    command_seq.data_phase.len = flash->host->dual_flash ? 2 : 1;
+    ret = chry_sflash_transfer(flash->host, &command_seq);
+    *busy = ((status[0] | status[1]) & 0x01U) != 0;
+    return ret;
+}
+
+/*
+ * Wait for the erase or program just started with the bus lock given up
+ * between status reads, the caller holds it once. A read of another
+ * thread gets in there, finds busy_op set and suspends the operation
+ * around itself, see chry_sflash_norflash_suspend_op().
+ */
+static int chry_sflash_norflash_wait_done(struct chry_sflash_norflash *flash, uint8_t op, uint32_t addr, uint32_t len, uint32_t timeout_ms)
+{
+    uint32_t start = chry_sflash_get_tick_ms(flash->host);
+    uint32_t seq = ++flash->busy_seq;
     bool busy;
+    int ret;
 
+    flash->busy_op = op;
+    flash->busy_addr = addr;
+    flash->busy_len = len;
+    /* the start counts as a resume, the operation gets its interval before the first suspend */
+    flash->resume_tick_ms = start;
+    flash->suspended_ms = 0;
     while (1) {
-        ret = chry_sflash_norflash_is_busy(flash, &busy);
+        ret = chry_sflash_norflash_read_busy(flash, &busy);
+        if (ret < 0) {
+            return ret;
+        }
+        if (!busy) {
+            break;
+        }
+        if ((chry_sflash_get_tick_ms(flash->host) - start - flash->suspended_ms) > timeout_ms) {
+            return -CHRY_SFLASH_ERR_TIMEOUT;
+        }
+        chry_sflash_unlock(flash->host);
+        chry_sflash_lock(flash->host);
+        /* another writer saw this one done and started its own, WIP is now about that */
+        if (flash->busy_seq != seq) {
+            return 0;
+        }
+    }
+    /* WIP clear, whoever started the last operation, nothing runs any more */
+    flash->busy_op = NORFLASH_BUSY_NONE;
+    return 0;
+}
+
+/* before a writer starts: an erase or program of another thread still running gets the bus between polls */
+static int chry_sflash_norflash_wait_busy_op(struct chry_sflash_norflash *flash)
+{
+    uint32_t start = chry_sflash_get_tick_ms(flash->host);
+    bool busy;
+    int ret;
+
+    while (flash->busy_op != NORFLASH_BUSY_NONE) {
+        ret = chry_sflash_norflash_read_busy(flash, &busy);
         if (ret < 0) {
             return ret;
         }
         if (!busy) {
+            flash->busy_op = NORFLASH_BUSY_NONE;
             break;
         }
+        if ((chry_sflash_get_tick_ms(flash->host) - start) > flash->chip_erase_timeout_ms) {
+            return -CHRY_SFLASH_ERR_TIMEOUT;
+        }
+        chry_sflash_unlock(flash->host);
+        chry_sflash_lock(flash->host);
+    }
+    return 0;
+}
+
+/* suspend what busy_op names for a read, suspended tells whether it needs a resume */
+static int chry_sflash_norflash_suspend_op(struct chry_sflash_norflash *flash, uint32_t addr, uint32_t len, bool *suspended)
+{
+    const struct chry_sflash_norflash_suspend *suspend;
+    uint32_t interval_ms;
+    bool busy;
+    int ret;
+
+    *suspended = false;
+    if (flash->busy_op == NORFLASH_BUSY_NONE) {
+        return 0;
+    }
+    /* the area under erase or program reads back undefined while suspended */
+    if ((addr < flash->busy_addr + flash->busy_len) && (flash->busy_addr < addr + len)) {
+        return 0;
+    }
+    suspend = &flash->suspend[flash->busy_op - 1];
+
+    /* ms ticks: the interval has passed for sure once the tick moved one further than it spans */
+    interval_ms = (suspend->interval_us + 999U) / 1000U;
+    do {
+        ret = chry_sflash_norflash_read_busy(flash, &busy);
+        if (ret < 0) {
+            return ret;
+        }
+        if (!busy) {
+            flash->busy_op = NORFLASH_BUSY_NONE;
+            return 0;
+        }
+    } while ((chry_sflash_get_tick_ms(flash->host) - flash->resume_tick_ms) <= interval_ms);
+
+    ret = chry_sflash_norflash_send_command(flash, suspend->suspend_cmd);
+    if (ret < 0) {
+        return ret;
+    }
+    flash->suspend_tick_ms = chry_sflash_get_tick_ms(flash->host);
+    *suspended = true;
+    return chry_sflash_norflash_wait_ready(flash, (suspend->latency_us + 999U) / 1000U + 1U);
+}
+
+static int chry_sflash_norflash_resume_op(struct chry_sflash_norflash *flash)
+{
+    int ret;
+
+    ret = chry_sflash_norflash_send_command(flash, flash->suspend[flash->busy_op - 1].resume_cmd);
+    flash->resume_tick_ms = chry_sflash_get_tick_ms(flash->host);
+    flash->suspended_ms += flash->resume_tick_ms - flash->suspend_tick_ms;
+    return ret;
+}
+
+static int chry_sflash_norflash_write_status_register(struct chry_sflash_norflash *flash, uint8_t command, uint8_t *reg_data, uint32_t len)
+{
+    struct chry_sflash_host *host = flash->host;
+    struct chry_sflash_request command_seq = { 0 };
+    uint8_t pairs[4];
+    int ret;
+
+    ret = chry_sflash_norflash_wait_ready(flash, NORFLASH_WRITE_STATUS_TIMEOUT_MS);
+    if (ret < 0) {
+        return ret;
     }
 
     ret = chry_sflash_norflash_send_command(flash, NORFLASH_COMMAND_WRITE_ENABLE);
@@ -104,25 +303,33 @@ static int chry_sflash_norflash_write_status_register(struct chry_sflash_norflas
 
     command_seq.dma_enable = false;
     command_seq.cmd_phase.cmd = command;
-    command_seq.cmd_phase.cmd_mode = CHRY_SFLASH_CMDMODE_1LINES;
-    command_seq.data_phase.data_mode = CHRY_SFLASH_DATAMODE_1LINES;
+    command_seq.cmd_phase.cmd_mode = flash->cmd_mode;
+    command_seq.data_phase.data_mode = flash->cmd_mode;
     command_seq.data_phase.direction = CHRY_SFLASH_DATA_WRITE;
-    command_seq.data_phase.buf = &reg_data;
-    command_seq.data_phase.len = sizeof(uint8_t);
+    command_seq.data_phase.buf = reg_data;
+    command_seq.data_phase.len = len;
+
+    /* dual-flash: every byte is sent twice so both parts get the same value */
+    if (host->dual_flash) {
+        if (len > sizeof(pairs) / 2) {
+            return -CHRY_SFLASH_ERR_INVAL;
+        }
+        for (uint32_t i = 0; i < len; i++) {
+            pairs[i * 2] = reg_data[i];
+            pairs[i * 2 + 1] = reg_data[i];
+        }
+        command_seq.data_phase.buf = pairs;
+        command_seq.data_phase.len = len * 2;
+    }
 
     ret = chry_sflash_transfer(host, &command_seq);
     if (ret < 0) {
         return ret;
     }
 
-    while (1) {
-        ret = chry_sflash_norflash_is_busy(flash, &busy);
-        if (ret < 0) {
-            return ret;
-        }
-        if (!busy) {
-            break;
-        }
+    ret = chry_sflash_norflash_wait_ready(flash, NORFLASH_WRITE_STATUS_TIMEOUT_MS);
+    if (ret < 0) {
+        return ret;
     }
     return 0;
 }
@@ -210,6 +417,136 @@ static int chry_sflash_norflash_read_sfdp_info(struct chry_sflash_norflash *flas
     return 0;
 }
 
+static void chry_sflash_norflash_parse_chip_erase_time(struct chry_sflash_norflash *flash, struct chry_sflash_norflash_jedec_info *jedec_info)
+{
+    static const uint32_t chip_erase_unit_ms[4] = { 16U, 256U, 4000U, 64000U };
+    uint32_t typical_ms;
+    uint32_t multiplier;
+
+    if (jedec_info->basic_flash_param_table_size < SFDP_BASIC_PROTOCOL_TABLE_SIZE_REVA) {
+        flash->chip_erase_typical_ms = 0;
+        flash->chip_erase_timeout_ms = NORFLASH_CHIP_ERASE_TIMEOUT_DEFAULT_MS;
+        return;
+    }
+
+    /* bits[4:0] count, bits[6:5] unit; max time = 2 * (multiplier + 1) * typical */
+    typical_ms = ((jedec_info->basic_flash_param_table.dword11.chip_erase_time & 0x1FU) + 1U) *
+                 chip_erase_unit_ms[(jedec_info->basic_flash_param_table.dword11.chip_erase_time >> 5) & 0x3U];
+    multiplier = jedec_info->basic_flash_param_table.dword10.erase_time_multiplier;
+    flash->chip_erase_typical_ms = typical_ms;
+    flash->chip_erase_timeout_ms = 2U * (multiplier + 1U) * typical_ms;
+}
+
+static void chry_sflash_norflash_parse_suspend_para(struct chry_sflash_norflash *flash, struct chry_sflash_norflash_jedec_info *jedec_info)
+{
+    static const uint32_t latency_unit_ns[4] = { 128U, 1000U, 8000U, 64000U };
+    jedec_basic_flash_param_table_t *table = &jedec_info->basic_flash_param_table;
+    struct chry_sflash_norflash_suspend *erase = &flash->suspend[NORFLASH_BUSY_ERASE - 1];
+    struct chry_sflash_norflash_suspend *program = &flash->suspend[NORFLASH_BUSY_PROGRAM - 1];
+
+    flash->suspend_enable = false;
+    if ((jedec_info->basic_flash_param_table_size < SFDP_BASIC_PROTOCOL_TABLE_SIZE_REVA) ||
+        table->dword12.suspend_resume_unsupported) {
+        return;
+    }
+
+    /* max latency = (count + 1) * unit, resume to suspend interval = (count + 1) * 64 us */
+    erase->suspend_cmd = table->dword13.inst_suspend;
+    erase->resume_cmd = table->dword13.inst_resume;
+    erase->latency_us = ((table->dword12.erase_suspend_max_latency_count + 1U) *
+                             latency_unit_ns[table->dword12.erase_suspend_max_latency_unit] + 999U) / 1000U;
+    erase->interval_us = (table->dword12.erase_resume_suspend_interval + 1U) * 64U;
+    program->suspend_cmd = table->dword13.inst_program_suspend;
+    program->resume_cmd = table->dword13.inst_program_resume;
+    program->latency_us = ((table->dword12.program_suspend_max_latency_count + 1U) *
+                               latency_unit_ns[table->dword12.program_suspend_max_latency_unit] + 999U) / 1000U;
+    program->interval_us = (table->dword12.program_resume_suspend_interval + 1U) * 64U;
+
+#ifdef CONFIG_CHRY_SFLASH_NOR_SUSPEND
+    /* only worth it when another thread can get the bus while erase or program waits */
+    flash->suspend_enable = (erase->suspend_cmd != 0U) && (erase->resume_cmd != 0U) &&
+                            (program->suspend_cmd != 0U) && (program->resume_cmd != 0U);
+#endif
+}
+
+static void chry_sflash_norflash_parse_erase_para(struct chry_sflash_norflash *flash, struct chry_sflash_norflash_jedec_info *jedec_info)
+{
+    static const uint32_t erase_unit_ms[4] = { 1U, 16U, 128U, 1000U };
+    jedec_basic_flash_param_table_t *table = &jedec_info->basic_flash_param_table;
+    struct chry_sflash_norflash_erase_type type = { 0 };
+    struct chry_sflash_norflash_erase_type *types = flash->erase_types;
+    bool has_times = (jedec_info->basic_flash_param_table_size >= SFDP_BASIC_PROTOCOL_TABLE_SIZE_REVA);
+    uint32_t times[4];
+    uint32_t units;
+    uint8_t count = 0;
+    uint8_t j;
+
+    times[0] = table->dword10.erase1_time;
+    times[1] = table->dword10.erase2_time;
+    times[2] = table->dword10.erase3_time;
+    times[3] = table->dword10.erase4_time;
+
+    for (uint8_t i = 0; i < 4U; i++) {
+        if (table->dword8_9[i].erase_size == 0U) {
+            continue;
+        }
+        type.size = 1UL << table->dword8_9[i].erase_size;
+        if (type.size < 1024U) {
+            continue;
+        }
+        type.cmd = table->dword8_9[i].erase_inst;
+        if (flash->flash_size > MAX_24BIT_ADDRESSING_SIZE) {
+            if (jedec_info->jedec_4byte_addressing_inst_table_enable) {
+                type.cmd = jedec_info->jedec_4byte_addressing_inst_table.dword2.erase_inst[i];
+            } else if (type.cmd == NORFLASH_COMMAND_SECTOR_ERASE_4K_3B) {
+                type.cmd = NORFLASH_COMMAND_SECTOR_ERASE_4K_4B;
+            } else if (type.cmd == NORFLASH_COMMAND_SECTOR_ERASE_64K_3B) {
+                type.cmd = NORFLASH_COMMAND_SECTOR_ERASE_64K_4B;
+            } else {
+                /* no 4-byte address form known for this type */
+                continue;
+            }
+        }
+        if (has_times) {
+            /* bits[4:0] count, bits[6:5] unit; max time = 2 * (multiplier + 1) * typical */
+            type.typical_ms = ((times[i] & 0x1FU) + 1U) * erase_unit_ms[(times[i] >> 5) & 0x3U];
+            type.timeout_ms = 2U * (table->dword10.erase_time_multiplier + 1U) * type.typical_ms;
+        } else {
+            /* no times, the planner then minimises the number of erase commands */
+            type.typical_ms = 1U;
+            type.timeout_ms = NORFLASH_BLOCK_ERASE_TIMEOUT_MS;
+        }
+
+        for (j = count; (j > 0) && (types[j - 1].size > type.size); j--) {
+            types[j] = types[j - 1];
+        }
+        types[j] = type;
+        count++;
+    }
+    flash->erase_type_count = count;
+
+    /* the sizes are powers of two, a full unit is covered exactly by the units of any smaller type */
+    flash->sector_size = 0;
+    flash->block_size = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        types[i].cover_ms = types[i].typical_ms;
+        types[i].split = false;
+        if (i > 0) {
+            units = types[i].size / types[i - 1].size;
+            if ((units * types[i - 1].cover_ms) < types[i].typical_ms) {
+                types[i].cover_ms = units * types[i - 1].cover_ms;
+                types[i].split = true;
+            }
+        }
+        if (types[i].size < (1024U * 1024U)) {
+            flash->block_size = types[i].size;
+        }
+    }
+    if (count > 0) {
+        flash->sector_size = types[0].size;
+    }
+}
+
 static void chry_sflash_norflash_parse_page_program_para(struct chry_sflash_norflash *flash, struct chry_sflash_norflash_jedec_info *jedec_info)
 {
     if (flash->addr_size == CHRY_SFLASH_ADDRSIZE_24BITS) {
@@ -245,6 +582,8 @@ static void chry_sflash_norflash_parse_page_program_para(struct chry_sflash_norf
 static void chry_sflash_norflash_parse_read_para(struct chry_sflash_norflash *flash, struct chry_sflash_norflash_jedec_info *jedec_info)
 {
     uint32_t read_cmd;
+    uint32_t sdr_read_cmd;
+    uint8_t sdr_dummy_bytes;
     uint8_t addr_mode;
     uint8_t data_mode;
     uint8_t dummy_clocks;
@@ -380,14 +719,85 @@ static void chry_sflash_norflash_parse_read_para(struct chry_sflash_norflash *fl
         flash->read_dummy_bytes = 1;
     }
 
+    /* upgrade 1-4-4 to 1S-4D-4D when both the controller and the part can clock on both edges, QPI reads are SDR */
+    flash->read_dtr = false;
+    sdr_read_cmd = read_cmd;
+    sdr_dummy_bytes = flash->read_dummy_bytes;
+    if (flash->host->dtr_enable && (flash->qpi_enable_cmd == 0U) && (addr_mode == CHRY_SFLASH_ADDRMODE_4LINES) &&
+        jedec_info->basic_flash_param_table.dword1.support_ddr_clocking) {
+        if (flash->addr_size == CHRY_SFLASH_ADDRSIZE_24BITS) {
+            read_cmd = NORFLASH_COMMAND_FAST_READ_1_4_4_DTR_3B;
+            flash->read_dtr = true;
+        } else if (jedec_info->jedec_4byte_addressing_inst_table_enable &&
+                   jedec_info->jedec_4byte_addressing_inst_table.dword1.support_1s_4d_4d_dtr_read) {
+            read_cmd = NORFLASH_COMMAND_FAST_READ_1_4_4_DTR_4B;
+            flash->read_dtr = true;
+        }
+        if (flash->read_dtr) {
+            flash->read_dummy_bytes = NORFLASH_DTR_READ_DUMMY_CLOCKS * 4 / 8;
+        }
+        /* JESD216F tables describe the 1S-4D-4D read, prefer them over the defaults */
+        if (flash->read_dtr && (flash->addr_size == CHRY_SFLASH_ADDRSIZE_24BITS) &&
+            (jedec_info->basic_flash_param_table_size >= SFDP_BASIC_PROTOCOL_TABLE_SIZE_REVF) &&
+            jedec_info->basic_flash_param_table.dword21.support_1s_4d_4d_fast_read &&
+            (jedec_info->basic_flash_param_table.dword23.inst_1s_4d_4d_fast_read != 0U)) {
+            mode_clocks = jedec_info->basic_flash_param_table.dword23.mode_clocks_1s_4d_4d_fast_read;
+            dummy_clocks = jedec_info->basic_flash_param_table.dword23.dummy_clocks_1s_4d_4d_fast_read;
+            /* dummy bytes on four lines are two clocks each, an odd count can not be sent, stay on the SDR read */
+            if ((dummy_clocks + mode_clocks) % 2U) {
+                flash->read_dtr = false;
+                flash->read_dummy_bytes = sdr_dummy_bytes;
+                read_cmd = sdr_read_cmd;
+            } else {
+                read_cmd = jedec_info->basic_flash_param_table.dword23.inst_1s_4d_4d_fast_read;
+                flash->read_dummy_bytes = (dummy_clocks + mode_clocks) * 4 / 8;
+            }
+        }
+    }
+
     flash->read_cmd = read_cmd;
     flash->read_addr_mode = addr_mode;
     flash->read_data_mode = data_mode;
 }
 
+static void chry_sflash_norflash_parse_qpi_para(struct chry_sflash_norflash *flash, struct chry_sflash_norflash_jedec_info *jedec_info)
+{
+    uint8_t enable_seq;
+    uint8_t disable_seq;
+
+    flash->qpi_enable_cmd = 0;
+    if (!flash->host->qpi_enable || (flash->host->iomode != CHRY_SFLASH_IOMODE_QUAD) ||
+        (jedec_info->basic_flash_param_table_size < SFDP_BASIC_PROTOCOL_TABLE_SIZE_REVA) ||
+        !jedec_info->basic_flash_param_table.dword5.support_4_4_4_fast_read) {
+        return;
+    }
+
+    /* only the single opcode sequences, the 65h/71h read-modify-write ones are not handled */
+    enable_seq = jedec_info->basic_flash_param_table.dword15.mode_4_4_4_enable_seq;
+    disable_seq = jedec_info->basic_flash_param_table.dword15.mode_4_4_4_disable_seq;
+    if (!(disable_seq & 0x0BU)) {
+        return;
+    }
+    if (enable_seq & 0x03U) {
+        /* bit0 needs QE first, enter_quad_mode has set it by then */
+        flash->qpi_enable_cmd = NORFLASH_COMMAND_ENTER_QPI_38;
+    } else if (enable_seq & 0x04U) {
+        flash->qpi_enable_cmd = NORFLASH_COMMAND_ENTER_QPI_35;
+    } else {
+        return;
+    }
+
+    flash->qpi_disable_seq = disable_seq;
+    flash->qpi_read_cmd = jedec_info->basic_flash_param_table.dword7.inst_4_4_4_fast_read;
+    flash->qpi_read_dummy_bytes = (jedec_info->basic_flash_param_table.dword7.dummy_clocks_4_4_4_fast_read +
+                                   jedec_info->basic_flash_param_table.dword7.mode_clocks_4_4_4_fast_read) *
+                                  4 / 8;
+}
+
 static int chry_sflash_norflash_enter_quad_mode(struct chry_sflash_norflash *flash, struct chry_sflash_norflash_jedec_info *jedec_info)
 {
     uint8_t status_val = 0;
+    uint8_t status_buf[2];
     uint8_t read_status_reg = 0;
     uint8_t write_status_reg = 0;
     int ret;
@@ -444,7 +854,7 @@ static int chry_sflash_norflash_enter_quad_mode(struct chry_sflash_norflash *fla
                         write_status_reg = NORFLASH_COMMAND_WRITE_STATUS_REG1;
                         status_val &= (uint8_t)~0x3cU; /* Clear Block protection */
                         status_val |= (1 << 6);
-                        ret = chry_sflash_norflash_write_status_register(flash, status_val, write_status_reg);
+                        ret = chry_sflash_norflash_write_status_register(flash, write_status_reg, &status_val, 1);
                         if (ret < 0) {
                             return ret;
                         }
@@ -453,10 +863,13 @@ static int chry_sflash_norflash_enter_quad_mode(struct chry_sflash_norflash *fla
                 case spi_nor_quad_en_set_bit1_in_status_reg2:
                     if (!(status_val & (1 << 1))) {
                         write_status_reg = NORFLASH_COMMAND_WRITE_STATUS_REG1;
-                        status_val |= (1 << 1);
-                        /* QE bit will be programmed after status1 register, so need to left shit 8 bit */
-                        status_val <<= 8;
-                        ret = chry_sflash_norflash_write_status_register(flash, status_val, write_status_reg);
+                        /* QE bit will be programmed after status1 register, write both with 01h */
+                        ret = chry_sflash_norflash_read_status_register(flash, NORFLASH_COMMAND_READ_STATUS_REG1, &status_buf[0]);
+                        if (ret < 0) {
+                            return ret;
+                        }
+                        status_buf[1] = status_val | (1 << 1);
+                        ret = chry_sflash_norflash_write_status_register(flash, write_status_reg, status_buf, 2);
                         if (ret < 0) {
                             return ret;
                         }
@@ -466,7 +879,7 @@ static int chry_sflash_norflash_enter_quad_mode(struct chry_sflash_norflash *fla
                     if (!(status_val & (1 << 1))) {
                         write_status_reg = NORFLASH_COMMAND_WRITE_STATUS_REG2;
                         status_val |= (1 << 1);
-                        ret = chry_sflash_norflash_write_status_register(flash, status_val, write_status_reg);
+                        ret = chry_sflash_norflash_write_status_register(flash, write_status_reg, &status_val, 1);
                         if (ret < 0) {
                             return ret;
                         }
@@ -476,7 +889,7 @@ static int chry_sflash_norflash_enter_quad_mode(struct chry_sflash_norflash *fla
                     if (!(status_val & (1 << 7))) {
                         write_status_reg = NORFLASH_COMMAND_WRITE_STATUS_REG2;
                         status_val |= (1 << 7);
-                        ret = chry_sflash_norflash_write_status_register(flash, status_val, write_status_reg);
+                        ret = chry_sflash_norflash_write_status_register(flash, write_status_reg, &status_val, 1);
                         if (ret < 0) {
                             return ret;
                         }
@@ -493,16 +906,13 @@ static int chry_sflash_norflash_enter_quad_mode(struct chry_sflash_norflash *fla
 int chry_sflash_norflash_init(struct chry_sflash_norflash *flash, struct chry_sflash_host *host)
 {
     struct chry_sflash_norflash_jedec_info jedec_info;
-    uint32_t sector_size = 0xffffffff;
-    uint32_t block_size = 0U;
-    uint32_t block_erase_type = 0U;
-    uint32_t sector_erase_type = 0U;
     int ret;
 
     memset(&jedec_info, 0, sizeof(jedec_info));
     memset(flash, 0, sizeof(struct chry_sflash_norflash));
 
     flash->host = host;
+    flash->cmd_mode = CHRY_SFLASH_CMDMODE_1LINES;
 
     chry_sflash_set_frequency(flash->host, SFDP_READ_FREQUENCY);
     ret = chry_sflash_norflash_read_sfdp_info(flash, &jedec_info);
@@ -526,63 +936,34 @@ int chry_sflash_norflash_init(struct chry_sflash_norflash *flash, struct chry_sf
         flash->page_size = (flash->page_size == (1UL << 15)) ? 256U : flash->page_size;
     }
 
-    /* Calculate Sector Size */
-    for (uint32_t i = 0; i < 4U; i++) {
-        if (jedec_info.basic_flash_param_table.dword8_9[i].erase_size != 0U) {
-            uint32_t current_erase_size = 1UL << jedec_info.basic_flash_param_table.dword8_9[i].erase_size;
-            if (current_erase_size < 1024U) {
-                continue;
-            }
-            if (current_erase_size < sector_size) {
-                sector_size = current_erase_size;
-                sector_erase_type = i;
-            }
-            if ((current_erase_size > block_size) && (current_erase_size < (1024U * 1024U))) {
-                block_size = current_erase_size;
-                block_erase_type = i;
-            }
-        }
-    }
+    /* every erase type with its command and time, for the erase planner */
+    chry_sflash_norflash_parse_erase_para(flash, &jedec_info);
 
-    if (flash->flash_size > MAX_24BIT_ADDRESSING_SIZE) {
-        if (jedec_info.jedec_4byte_addressing_inst_table_enable) {
-            flash->sector_erase_cmd = jedec_info.jedec_4byte_addressing_inst_table.dword2.erase_inst[sector_erase_type];
-            flash->block_erase_cmd = jedec_info.jedec_4byte_addressing_inst_table.dword2.erase_inst[block_erase_type];
-        } else {
-            switch (jedec_info.basic_flash_param_table.dword8_9[sector_erase_type].erase_inst) {
-                case NORFLASH_COMMAND_SECTOR_ERASE_4K_3B:
-                    flash->sector_erase_cmd = NORFLASH_COMMAND_SECTOR_ERASE_4K_4B;
-                    break;
-                case NORFLASH_COMMAND_SECTOR_ERASE_64K_3B:
-                    flash->sector_erase_cmd = NORFLASH_COMMAND_SECTOR_ERASE_64K_4B;
-                    break;
-                default:
-                    /* Reserved for future use */
-                    break;
-            }
-            switch (jedec_info.basic_flash_param_table.dword8_9[block_erase_type].erase_inst) {
-                case NORFLASH_COMMAND_SECTOR_ERASE_4K_3B:
-                    flash->block_erase_cmd = NORFLASH_COMMAND_SECTOR_ERASE_4K_4B;
-                    break;
-                case NORFLASH_COMMAND_SECTOR_ERASE_64K_3B:
-                    flash->block_erase_cmd = NORFLASH_COMMAND_SECTOR_ERASE_64K_4B;
-                    break;
-                default:
-                    /* Reserved for future use */
-                    break;
-            }
+    flash->addr_size = flash->flash_size > MAX_24BIT_ADDRESSING_SIZE ? CHRY_SFLASH_ADDRSIZE_32BITS : CHRY_SFLASH_ADDRSIZE_24BITS;
+
+    /* dual-flash: each part sees half the address, so every unit of the pair is twice the part's */
+    if (host->dual_flash) {
+        flash->flash_size *= 2;
+        flash->sector_size *= 2;
+        flash->block_size *= 2;
+        flash->page_size *= 2;
+        for (uint8_t i = 0; i < flash->erase_type_count; i++) {
+            flash->erase_types[i].size *= 2;
         }
-    } else {
-        flash->sector_erase_cmd = jedec_info.basic_flash_param_table.dword8_9[sector_erase_type].erase_inst;
-        flash->block_erase_cmd = jedec_info.basic_flash_param_table.dword8_9[block_erase_type].erase_inst;
     }
 
-    flash->addr_size = flash->flash_size > MAX_24BIT_ADDRESSING_SIZE ? CHRY_SFLASH_ADDRSIZE_32BITS : CHRY_SFLASH_ADDRSIZE_24BITS;
-    flash->sector_size = sector_size;
-    flash->block_size = block_size;
-
     chry_sflash_norflash_parse_page_program_para(flash, &jedec_info);
+    chry_sflash_norflash_parse_qpi_para(flash, &jedec_info);
     chry_sflash_norflash_parse_read_para(flash, &jedec_info);
+    chry_sflash_norflash_parse_chip_erase_time(flash, &jedec_info);
+    chry_sflash_norflash_parse_suspend_para(flash, &jedec_info);
+    if (flash->read_dtr) {
+        flash->max_frequency = NORFLASH_DTR_READ_MAX_FREQUENCY;
+    } else if ((flash->read_cmd == NORFLASH_COMMAND_READ_1_1_1_3B) || (flash->read_cmd == NORFLASH_COMMAND_READ_1_1_1_4B)) {
+        flash->max_frequency = NORFLASH_READ_MAX_FREQUENCY;
+    } else {
+        flash->max_frequency = NORFLASH_FAST_READ_MAX_FREQUENCY;
+    }
 
     if (flash->host->iomode == CHRY_SFLASH_IOMODE_QUAD) {
         ret = chry_sflash_norflash_enter_quad_mode(flash, &jedec_info);
@@ -598,168 +979,856 @@ int chry_sflash_norflash_init(struct chry_sflash_norflash *flash, struct chry_sf
         }
     }
 
+    ret = chry_sflash_norflash_enter_qpi(flash);
+    if (ret < 0) {
+        return ret;
+    }
+
+    /* discovery ran at SFDP_READ_FREQUENCY, switch to the speed of the read command */
+    ret = chry_sflash_set_frequency(flash->host, flash->max_frequency);
+    if (ret < 0) {
+        return ret;
+    }
+
 //    printf("Nor Flash sfdp version :v%d.%d\r\n", flash->sfdp_major_version, flash->sfdp_minor_version);
 //    printf("Nor Flash size :%d MB\r\n", flash->flash_size / 1024 / 1024);
 //    printf("Nor Flash block_size :%d KB\r\n", flash->block_size / 1024);
 //    printf("Nor Flash sector_size :%d KB\r\n", flash->sector_size / 1024);
 //    printf("Nor Flash page_size :%d Byte\r\n", flash->page_size);
 //    printf("Nor Flash addr_size :%d Byte\r\n", flash->addr_size);
-//    printf("Nor Flash block_erase_cmd :0x%02x\r\n", flash->block_erase_cmd);
-//    printf("Nor Flash sector_erase_cmd :0x%02x\r\n", flash->sector_erase_cmd);
 //    printf("Nor Flash page_program_cmd: 0x%02X, addr_mode: %d, data_mode: %d\r\n", flash->page_program_cmd, flash->page_program_addr_mode, flash->page_program_data_mode);
 //    printf("Nor Flash read_cmd: 0x%02X, addr_mode: %d, data_mode: %d\r\n", flash->read_cmd, flash->read_addr_mode, flash->read_data_mode);
+//    printf("Nor Flash chip_erase_timeout: %d ms\r\n", flash->chip_erase_timeout_ms);
     return 0;
 }
 
-int chry_sflash_norflash_erase(struct chry_sflash_norflash *flash, uint32_t start_addr, uint32_t len)
+int chry_sflash_norflash_deinit(struct chry_sflash_norflash *flash)
 {
-    struct chry_sflash_host *host = flash->host;
-    struct chry_sflash_request command_seq = { 0 };
     int ret;
-    bool busy;
-    uint32_t offset;
-    uint32_t erase_size;
 
-    if ((start_addr % flash->sector_size) || (len % flash->sector_size)) {
-        return -CHRY_SFLASH_ERR_INVAL;
+    if (chry_sflash_norflash_async_busy(flash)) {
+        return -CHRY_SFLASH_ERR_BUSY;
     }
+    chry_sflash_lock(flash->host);
+    ret = chry_sflash_norflash_wait_idle(flash);
+    if (ret == 0) {
+        /* leave the part in SPI mode for the boot rom and the next init */
+        ret = chry_sflash_norflash_exit_qpi(flash);
+    }
+    chry_sflash_unlock(flash->host);
+    return ret;
+}
 
-    offset = 0;
-    while (len > 0) {
-        while (1) {
-            ret = chry_sflash_norflash_is_busy(flash, &busy);
-            if (ret < 0) {
-                return ret;
-            }
-            if (!busy) {
-                break;
-            }
-        }
-
-        ret = chry_sflash_norflash_send_command(flash, NORFLASH_COMMAND_WRITE_ENABLE);
-        if (ret < 0) {
-            return ret;
-        }
-
-        command_seq.dma_enable = false;
-        command_seq.cmd_phase.cmd = flash->sector_erase_cmd;
-        command_seq.cmd_phase.cmd_mode = CHRY_SFLASH_CMDMODE_1LINES;
-        command_seq.addr_phase.addr = start_addr + offset;
-        command_seq.addr_phase.addr_mode = CHRY_SFLASH_ADDRMODE_1LINES;
-        command_seq.addr_phase.addr_size = flash->addr_size;
+int chry_sflash_norflash_enter_qpi(struct chry_sflash_norflash *flash)
+{
+    int ret;
 
-        if (len > flash->block_size) {
-            erase_size = flash->block_size;
-            command_seq.cmd_phase.cmd = flash->block_erase_cmd;
-        } else {
-            erase_size = flash->sector_size;
-            command_seq.cmd_phase.cmd = flash->sector_erase_cmd;
-        }
+    if (chry_sflash_norflash_async_busy(flash)) {
+        return -CHRY_SFLASH_ERR_BUSY;
+    }
+    if (flash->qpi_enable_cmd == 0U) {
+        return 0;
+    }
 
-        ret = chry_sflash_transfer(host, &command_seq);
-        if (ret < 0) {
-            return ret;
+    chry_sflash_lock(flash->host);
+    ret = 0;
+    if (flash->cmd_mode != CHRY_SFLASH_CMDMODE_4LINES) {
+        ret = chry_sflash_norflash_wait_idle(flash);
+        if (ret == 0) {
+            ret = chry_sflash_norflash_send_command(flash, flash->qpi_enable_cmd);
         }
-
-        while (1) {
-            ret = chry_sflash_norflash_is_busy(flash, &busy);
-            if (ret < 0) {
-                return ret;
-            }
-            if (!busy) {
-                break;
-            }
+        if (ret == 0) {
+            flash->cmd_mode = CHRY_SFLASH_CMDMODE_4LINES;
         }
-
-        offset += erase_size;
-        len -= erase_size;
     }
-
-    return 0;
+    chry_sflash_unlock(flash->host);
+    return ret;
 }
 
-int chry_sflash_norflash_write(struct chry_sflash_norflash *flash, uint32_t start_addr, uint8_t *buf, uint32_t buflen)
+/* the *_locked helpers run with the bus lock of the host held by their public wrapper */
+static int chry_sflash_norflash_exit_qpi_locked(struct chry_sflash_norflash *flash)
 {
-    struct chry_sflash_host *host = flash->host;
-    struct chry_sflash_request command_seq = { 0 };
-    uint32_t data_len;
-    uint8_t *data;
     int ret;
-    bool busy;
 
-    if ((start_addr + buflen) > flash->flash_size) {
-        return -CHRY_SFLASH_ERR_RANGE;
+    if (flash->cmd_mode != CHRY_SFLASH_CMDMODE_4LINES) {
+        return 0;
     }
 
-    command_seq.dma_enable = true;
-    command_seq.cmd_phase.cmd = flash->page_program_cmd;
-    command_seq.cmd_phase.cmd_mode = CHRY_SFLASH_CMDMODE_1LINES;
-    command_seq.addr_phase.addr_mode = flash->page_program_addr_mode;
-    command_seq.addr_phase.addr_size = flash->addr_size;
-    command_seq.data_phase.direction = CHRY_SFLASH_DATA_WRITE;
-    command_seq.data_phase.data_mode = flash->page_program_data_mode;
+    ret = chry_sflash_norflash_wait_ready(flash, flash->chip_erase_timeout_ms);
+    if (ret < 0) {
+        return ret;
+    }
+    if (flash->qpi_disable_seq & 0x01U) {
+        ret = chry_sflash_norflash_send_command(flash, NORFLASH_COMMAND_EXIT_QPI_FF);
+    } else if (flash->qpi_disable_seq & 0x02U) {
+        ret = chry_sflash_norflash_send_command(flash, NORFLASH_COMMAND_EXIT_QPI_F5);
+    } else {
+        ret = chry_sflash_norflash_send_command(flash, NORFLASH_COMMAND_RESET_ENABLE);
+        if (ret == 0) {
+            ret = chry_sflash_norflash_send_command(flash, NORFLASH_COMMAND_RESET);
+        }
+    }
+    if (ret < 0) {
+        return ret;
+    }
+    flash->cmd_mode = CHRY_SFLASH_CMDMODE_1LINES;
+
+    /* a soft reset also drops the volatile 4-byte address mode */
+    if (!(flash->qpi_disable_seq & 0x03U) && (flash->addr_size == CHRY_SFLASH_ADDRSIZE_32BITS)) {
+        ret = chry_sflash_norflash_wait_ready(flash, NORFLASH_WRITE_STATUS_TIMEOUT_MS);
+        if (ret < 0) {
+            return ret;
+        }
+        ret = chry_sflash_norflash_send_command(flash, NORFLASH_COMMAND_ENTER_4B_ADDRESS_MODE);
+    }
+    return ret;
+}
+
+int chry_sflash_norflash_exit_qpi(struct chry_sflash_norflash *flash)
+{
+    int ret;
+
+    if (chry_sflash_norflash_async_busy(flash)) {
+        return -CHRY_SFLASH_ERR_BUSY;
+    }
+    chry_sflash_lock(flash->host);
+    ret = chry_sflash_norflash_exit_qpi_locked(flash);
+    chry_sflash_unlock(flash->host);
+    return ret;
+}
+
+static int chry_sflash_norflash_read_jedec_id_locked(struct chry_sflash_norflash *flash, uint8_t *id, uint32_t len)
+{
+    struct chry_sflash_host *host = flash->host;
+    struct chry_sflash_request command_seq = { 0 };
+    uint8_t pairs[16];
+    int ret;
+
+    command_seq.dma_enable = false;
+    command_seq.cmd_phase.cmd = NORFLASH_COMMAND_READ_JEDECID;
+    command_seq.cmd_phase.cmd_mode = flash->cmd_mode;
+    command_seq.data_phase.direction = CHRY_SFLASH_DATA_READ;
+    command_seq.data_phase.data_mode = flash->cmd_mode;
+    command_seq.data_phase.buf = id;
+    command_seq.data_phase.len = len;
+
+    if (!host->dual_flash) {
+        return chry_sflash_transfer(host, &command_seq);
+    }
+
+    /* dual-flash: report the first part, a different second part is an error */
+    if (len > sizeof(pairs) / 2) {
+        return -CHRY_SFLASH_ERR_INVAL;
+    }
+    command_seq.data_phase.buf = pairs;
+    command_seq.data_phase.len = len * 2;
+    ret = chry_sflash_transfer(host, &command_seq);
+    if (ret < 0) {
+        return ret;
+    }
+    for (uint32_t i = 0; i < len; i++) {
+        if (pairs[i * 2] != pairs[i * 2 + 1]) {
+            return -CHRY_SFLASH_ERR_INVAL;
+        }
+        id[i] = pairs[i * 2];
+    }
+    return 0;
+}
+
+int chry_sflash_norflash_read_jedec_id(struct chry_sflash_norflash *flash, uint8_t *id, uint32_t len)
+{
+    int ret;
+
+    if (chry_sflash_norflash_async_busy(flash)) {
+        return -CHRY_SFLASH_ERR_BUSY;
+    }
+    chry_sflash_lock(flash->host);
+    ret = chry_sflash_norflash_read_jedec_id_locked(flash, id, len);
+    chry_sflash_unlock(flash->host);
+    return ret;
+}
+
+/*
+ * Erase planner. The erase types are powers of two, so the cheapest cover
+ * of an aligned range takes at every address the largest unit that is
+ * aligned there and fits, erased whole or, when split, by the units of a
+ * smaller type which the SFDP typical times rate faster. A range of the
+ * whole chip goes to chip erase when that is faster still.
+ */
+static uint8_t chry_sflash_norflash_plan_fit(struct chry_sflash_norflash *flash, uint32_t addr, uint32_t len)
+{
+    uint8_t k;
+
+    for (k = flash->erase_type_count - 1; k > 0; k--) {
+        if (((addr % flash->erase_types[k].size) == 0U) && (len >= flash->erase_types[k].size)) {
+            break;
+        }
+    }
+    return k;
+}
+
+static uint32_t chry_sflash_norflash_plan_cover_ms(struct chry_sflash_norflash *flash, uint32_t addr, uint32_t len)
+{
+    const struct chry_sflash_norflash_erase_type *type;
+    uint32_t total_ms = 0;
+
+    while (len > 0) {
+        type = &flash->erase_types[chry_sflash_norflash_plan_fit(flash, addr, len)];
+        total_ms += type->cover_ms;
+        addr += type->size;
+        len -= type->size;
+    }
+    return total_ms;
+}
+
+/* the next command of the erase plan, returns the size it erases and its timeout in timeout_ms */
+static uint32_t chry_sflash_norflash_fill_erase_seq(struct chry_sflash_norflash *flash, struct chry_sflash_request *command_seq, uint32_t addr, uint32_t len,
+                                                    uint32_t *timeout_ms)
+{
+    const struct chry_sflash_norflash_erase_type *type;
+    uint8_t k;
+
+    if ((addr == 0U) && (len == flash->flash_size) && (flash->chip_erase_typical_ms != 0U) &&
+        (flash->chip_erase_typical_ms < chry_sflash_norflash_plan_cover_ms(flash, addr, len))) {
+        chry_sflash_norflash_fill_command_seq(flash, command_seq, NORFLASH_COMMAND_CHIPERASE);
+        *timeout_ms = flash->chip_erase_timeout_ms;
+        return len;
+    }
+
+    k = chry_sflash_norflash_plan_fit(flash, addr, len);
+    while ((k > 0) && flash->erase_types[k].split) {
+        k--;
+    }
+    type = &flash->erase_types[k];
+
+    command_seq->dma_enable = false;
+    command_seq->cmd_phase.cmd = type->cmd;
+    command_seq->cmd_phase.cmd_mode = flash->cmd_mode;
+    command_seq->addr_phase.addr = addr;
+    command_seq->addr_phase.addr_mode = flash->cmd_mode;
+    command_seq->addr_phase.addr_size = flash->addr_size;
+    *timeout_ms = type->timeout_ms;
+    return type->size;
+}
+
+int chry_sflash_norflash_erase(struct chry_sflash_norflash *flash, uint32_t start_addr, uint32_t len)
+{
+    struct chry_sflash_host *host = flash->host;
+    struct chry_sflash_request command_seq[4] = { 0 };
+    uint32_t flags = CHRY_SFLASH_BATCH_POLL_FIRST | CHRY_SFLASH_BATCH_POLL_LAST;
+    uint32_t first = 0;
+    int ret = 0;
+    uint32_t offset;
+    uint32_t erase_size;
+    uint32_t timeout_ms;
+    bool sliced;
+
+    if (chry_sflash_norflash_async_busy(flash)) {
+        return -CHRY_SFLASH_ERR_BUSY;
+    }
+    if ((flash->erase_type_count == 0) || (start_addr % flash->sector_size) || (len % flash->sector_size)) {
+        return -CHRY_SFLASH_ERR_INVAL;
+    }
+
+    /*
+     * ready poll, WREN, erase, done poll; after the first unit the previous done poll covers the ready one.
+     * With suspend the done poll gives the bus up to readers instead, a chip erase cannot be suspended.
+     */
+    chry_sflash_norflash_fill_poll_seq(flash, &command_seq[0], flash->chip_erase_timeout_ms);
+    chry_sflash_norflash_fill_command_seq(flash, &command_seq[1], NORFLASH_COMMAND_WRITE_ENABLE);
+
+    chry_sflash_lock(host);
+    ret = chry_sflash_norflash_wait_busy_op(flash);
+    offset = 0;
+    while ((ret == 0) && (len > 0)) {
+        erase_size = chry_sflash_norflash_fill_erase_seq(flash, &command_seq[2], start_addr + offset, len, &timeout_ms);
+        chry_sflash_norflash_fill_poll_seq(flash, &command_seq[3], timeout_ms);
+        sliced = flash->suspend_enable && (command_seq[2].cmd_phase.cmd != NORFLASH_COMMAND_CHIPERASE);
+
+        if (sliced) {
+            ret = chry_sflash_norflash_wait_busy_op(flash);
+            if (ret == 0) {
+                ret = chry_sflash_transfer_batch(host, &command_seq[first], 3 - first, flags & ~CHRY_SFLASH_BATCH_POLL_LAST);
+            }
+            if (ret == 0) {
+                ret = chry_sflash_norflash_wait_done(flash, NORFLASH_BUSY_ERASE, start_addr + offset, erase_size, timeout_ms);
+            }
+        } else {
+            ret = chry_sflash_transfer_batch(host, &command_seq[first], 4 - first, flags);
+        }
+        if (ret < 0) {
+            break;
+        }
+        /* a sliced unit gave the bus up, another writer may have started since, so poll for ready again */
+        first = sliced ? 0 : 1;
+        flags = sliced ? flags : CHRY_SFLASH_BATCH_POLL_LAST;
+
+        offset += erase_size;
+        len -= erase_size;
+    }
+    chry_sflash_unlock(host);
+
+    return ret;
+}
+
+int chry_sflash_norflash_erase_chip(struct chry_sflash_norflash *flash)
+{
+    struct chry_sflash_request command_seq[4] = { 0 };
+    int ret;
+
+    if (chry_sflash_norflash_async_busy(flash)) {
+        return -CHRY_SFLASH_ERR_BUSY;
+    }
+    chry_sflash_norflash_fill_poll_seq(flash, &command_seq[0], flash->chip_erase_timeout_ms);
+    chry_sflash_norflash_fill_command_seq(flash, &command_seq[1], NORFLASH_COMMAND_WRITE_ENABLE);
+    chry_sflash_norflash_fill_command_seq(flash, &command_seq[2], NORFLASH_COMMAND_CHIPERASE);
+    chry_sflash_norflash_fill_poll_seq(flash, &command_seq[3], flash->chip_erase_timeout_ms);
+
+    chry_sflash_lock(flash->host);
+    ret = chry_sflash_norflash_wait_busy_op(flash);
+    if (ret == 0) {
+        ret = chry_sflash_transfer_batch(flash->host, command_seq, 4, CHRY_SFLASH_BATCH_POLL_FIRST | CHRY_SFLASH_BATCH_POLL_LAST);
+    }
+    chry_sflash_unlock(flash->host);
+    return ret;
+}
+
+static void chry_sflash_norflash_fill_program_seq(struct chry_sflash_norflash *flash, struct chry_sflash_request *command_seq)
+{
+    command_seq->dma_enable = true;
+    command_seq->cmd_phase.cmd = flash->page_program_cmd;
+    command_seq->cmd_phase.cmd_mode = CHRY_SFLASH_CMDMODE_1LINES;
+    command_seq->addr_phase.addr_mode = flash->page_program_addr_mode;
+    command_seq->addr_phase.addr_size = flash->addr_size;
+    command_seq->data_phase.direction = CHRY_SFLASH_DATA_WRITE;
+    command_seq->data_phase.data_mode = flash->page_program_data_mode;
+    if (flash->cmd_mode == CHRY_SFLASH_CMDMODE_4LINES) {
+        command_seq->cmd_phase.cmd = (flash->addr_size == CHRY_SFLASH_ADDRSIZE_24BITS) ?
+                                         NORFLASH_COMMAND_PAGE_PROGRAM_4_4_4_3B :
+                                         NORFLASH_COMMAND_PAGE_PROGRAM_4_4_4_4B;
+        command_seq->cmd_phase.cmd_mode = CHRY_SFLASH_CMDMODE_4LINES;
+        command_seq->addr_phase.addr_mode = CHRY_SFLASH_ADDRMODE_4LINES;
+        command_seq->data_phase.data_mode = CHRY_SFLASH_DATAMODE_4LINES;
+    }
+}
+
+static int chry_sflash_norflash_program_pages(struct chry_sflash_norflash *flash, uint32_t start_addr, uint8_t *buf, uint32_t buflen, bool wait_last)
+{
+    struct chry_sflash_host *host = flash->host;
+    struct chry_sflash_request command_seq[4] = { 0 };
+    uint32_t flags = CHRY_SFLASH_BATCH_POLL_FIRST;
+    uint32_t first = 0;
+    uint32_t data_len;
+    uint8_t *data;
+    bool wait;
+    bool sliced;
+    int ret;
+
+    if ((start_addr + buflen) > flash->flash_size) {
+        return -CHRY_SFLASH_ERR_RANGE;
+    }
+    ret = chry_sflash_norflash_wait_busy_op(flash);
+    if (ret < 0) {
+        return ret;
+    }
+
+    /* ready poll, WREN, page program, done poll per page, as one batch; with suspend the done poll gives the bus up */
+    chry_sflash_norflash_fill_poll_seq(flash, &command_seq[0], flash->chip_erase_timeout_ms);
+    chry_sflash_norflash_fill_command_seq(flash, &command_seq[1], NORFLASH_COMMAND_WRITE_ENABLE);
+    chry_sflash_norflash_fill_program_seq(flash, &command_seq[2]);
+    chry_sflash_norflash_fill_poll_seq(flash, &command_seq[3], NORFLASH_PAGE_PROGRAM_TIMEOUT_MS);
 
     data = buf;
     while (buflen > 0) {
         data_len = flash->page_size - start_addr % flash->page_size;
 
-        command_seq.addr_phase.addr = start_addr;
-        command_seq.data_phase.buf = data;
-        command_seq.data_phase.len = (buflen > data_len) ? data_len : buflen;
+        command_seq[2].addr_phase.addr = start_addr;
+        command_seq[2].data_phase.buf = data;
+        command_seq[2].data_phase.len = (buflen > data_len) ? data_len : buflen;
 
-        while (1) {
-            ret = chry_sflash_norflash_is_busy(flash, &busy);
-            if (ret < 0) {
-                return ret;
+        /* the last page may be left programming, the next access waits for it */
+        wait = wait_last || (buflen != command_seq[2].data_phase.len);
+
+        sliced = wait && flash->suspend_enable;
+        if (sliced) {
+            ret = chry_sflash_norflash_wait_busy_op(flash);
+            if (ret == 0) {
+                ret = chry_sflash_transfer_batch(host, &command_seq[first], 3 - first, flags);
             }
-            if (!busy) {
-                break;
+            if (ret == 0) {
+                ret = chry_sflash_norflash_wait_done(flash, NORFLASH_BUSY_PROGRAM, start_addr, command_seq[2].data_phase.len,
+                                                     NORFLASH_PAGE_PROGRAM_TIMEOUT_MS);
             }
+        } else {
+            ret = chry_sflash_transfer_batch(host, &command_seq[first], (wait ? 4 : 3) - first, flags | (wait ? CHRY_SFLASH_BATCH_POLL_LAST : 0));
         }
-
-        ret = chry_sflash_norflash_send_command(flash, NORFLASH_COMMAND_WRITE_ENABLE);
+        /* a failed batch may have left a page programming */
+        flash->program_pending = (ret < 0) || !wait;
         if (ret < 0) {
             return ret;
         }
+        if (!wait) {
+            break;
+        }
+        first = sliced ? 0 : 1;
+        flags = sliced ? CHRY_SFLASH_BATCH_POLL_FIRST : 0;
 
-        ret = chry_sflash_transfer(host, &command_seq);
+        buflen -= command_seq[2].data_phase.len;
+        start_addr += command_seq[2].data_phase.len;
+        data += command_seq[2].data_phase.len;
+    }
+    return 0;
+}
+
+static int chry_sflash_norflash_program(struct chry_sflash_norflash *flash, uint32_t start_addr, uint8_t *buf, uint32_t buflen, bool wait_last)
+{
+    uint8_t pair[2];
+    int ret;
+
+    if (!flash->host->dual_flash) {
+        return chry_sflash_norflash_program_pages(flash, start_addr, buf, buflen, wait_last);
+    }
+
+    if ((start_addr + buflen) > flash->flash_size) {
+        return -CHRY_SFLASH_ERR_RANGE;
+    }
+
+    /* dual-flash transfers move whole byte pairs, pad an odd head or tail with 0xFF which programs nothing */
+    if ((start_addr & 1U) && (buflen > 0)) {
+        pair[0] = 0xFF;
+        pair[1] = buf[0];
+        ret = chry_sflash_norflash_program_pages(flash, start_addr - 1U, pair, 2, wait_last);
+        if (ret < 0) {
+            return ret;
+        }
+        start_addr++;
+        buf++;
+        buflen--;
+    }
+    if (buflen & ~1U) {
+        ret = chry_sflash_norflash_program_pages(flash, start_addr, buf, buflen & ~1U, wait_last);
+        if (ret < 0) {
+            return ret;
+        }
+    }
+    if (buflen & 1U) {
+        pair[0] = buf[buflen - 1U];
+        pair[1] = 0xFF;
+        ret = chry_sflash_norflash_program_pages(flash, start_addr + buflen - 1U, pair, 2, wait_last);
         if (ret < 0) {
             return ret;
         }
+    }
+    return 0;
+}
 
-        while (1) {
-            ret = chry_sflash_norflash_is_busy(flash, &busy);
-            if (ret < 0) {
-                return ret;
-            }
-            if (!busy) {
-                break;
-            }
+int chry_sflash_norflash_write(struct chry_sflash_norflash *flash, uint32_t start_addr, uint8_t *buf, uint32_t buflen)
+{
+    int ret;
+
+    if (chry_sflash_norflash_async_busy(flash)) {
+        return -CHRY_SFLASH_ERR_BUSY;
+    }
+    chry_sflash_lock(flash->host);
+    ret = chry_sflash_norflash_program(flash, start_addr, buf, buflen, true);
+    chry_sflash_unlock(flash->host);
+    return ret;
+}
+
+int chry_sflash_norflash_write_nowait(struct chry_sflash_norflash *flash, uint32_t start_addr, uint8_t *buf, uint32_t buflen)
+{
+    int ret;
+
+    if (chry_sflash_norflash_async_busy(flash)) {
+        return -CHRY_SFLASH_ERR_BUSY;
+    }
+    chry_sflash_lock(flash->host);
+    ret = chry_sflash_norflash_program(flash, start_addr, buf, buflen, false);
+    chry_sflash_unlock(flash->host);
+    return ret;
+}
+
+int chry_sflash_norflash_wait_idle(struct chry_sflash_norflash *flash)
+{
+    int ret = 0;
+
+    if (chry_sflash_norflash_async_busy(flash)) {
+        return -CHRY_SFLASH_ERR_BUSY;
+    }
+    chry_sflash_lock(flash->host);
+    /* an erase or program of another thread that gave the bus up */
+    if (flash->busy_op != NORFLASH_BUSY_NONE) {
+        ret = chry_sflash_norflash_wait_ready(flash, flash->chip_erase_timeout_ms);
+        if (ret == 0) {
+            flash->busy_op = NORFLASH_BUSY_NONE;
+        }
+    }
+    if ((ret == 0) && flash->program_pending) {
+        ret = chry_sflash_norflash_wait_ready(flash, NORFLASH_PAGE_PROGRAM_TIMEOUT_MS);
+        if (ret == 0) {
+            flash->program_pending = false;
         }
+    }
+    chry_sflash_unlock(flash->host);
+    return ret;
+}
 
-        buflen -= command_seq.data_phase.len;
-        start_addr += command_seq.data_phase.len;
-        data += command_seq.data_phase.len;
+static void chry_sflash_norflash_fill_read_seq(struct chry_sflash_norflash *flash, struct chry_sflash_request *command_seq)
+{
+    command_seq->addr_phase.addr_size = flash->addr_size;
+    command_seq->data_phase.direction = CHRY_SFLASH_DATA_READ;
+    if (flash->cmd_mode == CHRY_SFLASH_CMDMODE_4LINES) {
+        command_seq->cmd_phase.cmd = flash->qpi_read_cmd;
+        command_seq->cmd_phase.cmd_mode = CHRY_SFLASH_CMDMODE_4LINES;
+        command_seq->addr_phase.addr_mode = CHRY_SFLASH_ADDRMODE_4LINES;
+        command_seq->dummy_phase.dummy_bytes = flash->qpi_read_dummy_bytes;
+        command_seq->data_phase.data_mode = CHRY_SFLASH_DATAMODE_4LINES;
+    } else {
+        command_seq->cmd_phase.cmd = flash->read_cmd;
+        command_seq->cmd_phase.cmd_mode = CHRY_SFLASH_CMDMODE_1LINES;
+        command_seq->addr_phase.addr_mode = flash->read_addr_mode;
+        command_seq->dtr_enable = flash->read_dtr;
+        command_seq->dummy_phase.dummy_bytes = flash->read_dummy_bytes;
+        command_seq->data_phase.data_mode = flash->read_data_mode;
     }
-    return 0;
 }
 
-int chry_sflash_norflash_read(struct chry_sflash_norflash *flash, uint32_t start_addr, uint8_t *buf, uint32_t buflen)
+static int chry_sflash_norflash_read_seq(struct chry_sflash_norflash *flash, uint32_t start_addr, uint8_t *buf, uint32_t buflen)
 {
     struct chry_sflash_host *host = flash->host;
     struct chry_sflash_request command_seq = { 0 };
 
+    chry_sflash_norflash_fill_read_seq(flash, &command_seq);
     command_seq.dma_enable = true;
-    command_seq.cmd_phase.cmd = flash->read_cmd;
-    command_seq.cmd_phase.cmd_mode = CHRY_SFLASH_CMDMODE_1LINES;
     command_seq.addr_phase.addr = start_addr;
-    command_seq.addr_phase.addr_mode = flash->read_addr_mode;
-    command_seq.addr_phase.addr_size = flash->addr_size;
-    command_seq.dummy_phase.dummy_bytes = flash->read_dummy_bytes;
-    command_seq.data_phase.direction = CHRY_SFLASH_DATA_READ;
-    command_seq.data_phase.data_mode = flash->read_data_mode;
     command_seq.data_phase.buf = buf;
     command_seq.data_phase.len = buflen;
 
     return chry_sflash_transfer(host, &command_seq);
-}
\ No newline at end of file
+}
+
+static int chry_sflash_norflash_read_data(struct chry_sflash_norflash *flash, uint32_t start_addr, uint8_t *buf, uint32_t buflen)
+{
+    struct chry_sflash_request command_seq = { 0 };
+    struct chry_sflash_segment segs[3];
+    uint8_t head[2];
+    uint8_t tail[2];
+    uint32_t mid_len;
+    uint8_t seg_count = 0;
+    int ret;
+
+    if (!flash->host->dual_flash || (((start_addr | buflen) & 1U) == 0)) {
+        return chry_sflash_norflash_read_seq(flash, start_addr, buf, buflen);
+    }
+
+    /* dual-flash transfers move whole byte pairs, an odd head or tail byte comes with its neighbour in the same transaction */
+    if (start_addr & 1U) {
+        segs[seg_count].buf = head;
+        segs[seg_count++].len = 2;
+        buflen--;
+    }
+    mid_len = buflen & ~1U;
+    if (mid_len) {
+        segs[seg_count].buf = &buf[(start_addr & 1U)];
+        segs[seg_count++].len = mid_len;
+    }
+    if (buflen & 1U) {
+        segs[seg_count].buf = tail;
+        segs[seg_count++].len = 2;
+    }
+
+    chry_sflash_norflash_fill_read_seq(flash, &command_seq);
+    command_seq.dma_enable = true;
+    command_seq.addr_phase.addr = start_addr & ~1U;
+    command_seq.data_phase.segs = segs;
+    command_seq.data_phase.seg_count = seg_count;
+
+    ret = chry_sflash_transfer(flash->host, &command_seq);
+    if (ret < 0) {
+        return ret;
+    }
+    if (start_addr & 1U) {
+        buf[0] = head[1];
+    }
+    if (buflen & 1U) {
+        buf[(start_addr & 1U) + mid_len] = tail[0];
+    }
+    return 0;
+}
+
+/* an erase or program another thread waits on is suspended for the read instead of waited for, unless the read is inside it */
+static int chry_sflash_norflash_read_locked(struct chry_sflash_norflash *flash, uint32_t start_addr, uint8_t *buf, uint32_t buflen)
+{
+    bool suspended;
+    int ret;
+    int resume_ret;
+
+    ret = chry_sflash_norflash_suspend_op(flash, start_addr, buflen, &suspended);
+    if ((ret == 0) && !suspended) {
+        ret = chry_sflash_norflash_wait_idle(flash);
+    }
+    if (ret == 0) {
+        ret = chry_sflash_norflash_read_data(flash, start_addr, buf, buflen);
+    }
+    if (suspended) {
+        resume_ret = chry_sflash_norflash_resume_op(flash);
+        if (ret == 0) {
+            ret = resume_ret;
+        }
+    }
+    return ret;
+}
+
+int chry_sflash_norflash_read(struct chry_sflash_norflash *flash, uint32_t start_addr, uint8_t *buf, uint32_t buflen)
+{
+    int ret;
+
+    if (chry_sflash_norflash_async_busy(flash)) {
+        return -CHRY_SFLASH_ERR_BUSY;
+    }
+    chry_sflash_lock(flash->host);
+    ret = chry_sflash_norflash_read_locked(flash, start_addr, buf, buflen);
+    chry_sflash_unlock(flash->host);
+    return ret;
+}
+
+int chry_sflash_norflash_memory_map(struct chry_sflash_norflash *flash, void **addr)
+{
+    struct chry_sflash_host *host = flash->host;
+    struct chry_sflash_request command_seq = { 0 };
+    int ret;
+
+    if (chry_sflash_norflash_async_busy(flash)) {
+        return -CHRY_SFLASH_ERR_BUSY;
+    }
+    chry_sflash_lock(host);
+    ret = chry_sflash_norflash_wait_idle(flash);
+    if (ret == 0) {
+        chry_sflash_norflash_fill_read_seq(flash, &command_seq);
+        ret = chry_sflash_memory_map(host, &command_seq, addr);
+    }
+    chry_sflash_unlock(host);
+    return ret;
+}
+
+static int chry_sflash_norflash_crc32_locked(struct chry_sflash_norflash *flash, uint32_t start_addr, uint32_t len, uint32_t *crc)
+{
+    uint8_t buf[256];
+    uint32_t chunk;
+    void *map;
+    int ret;
+
+    if ((start_addr + len) > flash->flash_size) {
+        return -CHRY_SFLASH_ERR_RANGE;
+    }
+
+    /* hosts with a memory mapped window feed the crc directly from it */
+    if (chry_sflash_norflash_memory_map(flash, &map) == 0) {
+        *crc = chry_sflash_crc32_update(0, (const uint8_t *)map + start_addr, len);
+        return 0;
+    }
+
+    *crc = 0;
+    while (len > 0) {
+        chunk = (len > sizeof(buf)) ? sizeof(buf) : len;
+
+        ret = chry_sflash_norflash_read(flash, start_addr, buf, chunk);
+        if (ret < 0) {
+            return ret;
+        }
+        *crc = chry_sflash_crc32_update(*crc, buf, chunk);
+
+        start_addr += chunk;
+        len -= chunk;
+    }
+    return 0;
+}
+
+int chry_sflash_norflash_crc32(struct chry_sflash_norflash *flash, uint32_t start_addr, uint32_t len, uint32_t *crc)
+{
+    int ret;
+
+    if (chry_sflash_norflash_async_busy(flash)) {
+        return -CHRY_SFLASH_ERR_BUSY;
+    }
+    /* the memory mapped window is read while the lock is held */
+    chry_sflash_lock(flash->host);
+    ret = chry_sflash_norflash_crc32_locked(flash, start_addr, len, crc);
+    chry_sflash_unlock(flash->host);
+    return ret;
+}
+
+#ifdef CONFIG_CHRY_SFLASH_ASYNC
+#define NORFLASH_ASYNC_STEP_WAIT_READY 0 /* previous work of the part, as the blocking calls do */
+#define NORFLASH_ASYNC_STEP_WREN       1
+#define NORFLASH_ASYNC_STEP_COMMAND    2
+#define NORFLASH_ASYNC_STEP_WAIT_DONE  3
+
+static void chry_sflash_norflash_async_done(struct chry_sflash_host *host, int status, void *arg);
+
+/* queue the transfer for the current step */
+static int chry_sflash_norflash_async_issue(struct chry_sflash_norflash *flash)
+{
+    struct chry_sflash_norflash_async *async = &flash->async;
+    struct chry_sflash_request command_seq = { 0 };
+    uint32_t timeout_ms;
+
+    switch (async->step) {
+        case NORFLASH_ASYNC_STEP_WAIT_READY:
+        case NORFLASH_ASYNC_STEP_WAIT_DONE:
+            if (async->step == NORFLASH_ASYNC_STEP_WAIT_READY) {
+                timeout_ms = flash->chip_erase_timeout_ms;
+            } else if (async->op == NORFLASH_ASYNC_OP_ERASE) {
+                timeout_ms = async->timeout_ms;
+            } else {
+                timeout_ms = NORFLASH_PAGE_PROGRAM_TIMEOUT_MS;
+            }
+            chry_sflash_norflash_fill_status_seq(flash, &command_seq);
+            command_seq.data_phase.buf = &async->status;
+            return chry_sflash_poll_status_async(flash->host, &command_seq, 0x01, 0x00, timeout_ms,
+                                                 chry_sflash_norflash_async_done, flash);
+
+        case NORFLASH_ASYNC_STEP_WREN:
+            command_seq.cmd_phase.cmd = NORFLASH_COMMAND_WRITE_ENABLE;
+            command_seq.cmd_phase.cmd_mode = flash->cmd_mode;
+            break;
+
+        default:
+            if (async->op == NORFLASH_ASYNC_OP_ERASE) {
+                async->chunk = chry_sflash_norflash_fill_erase_seq(flash, &command_seq, async->addr, async->len, &async->timeout_ms);
+                break;
+            }
+            if (async->op == NORFLASH_ASYNC_OP_WRITE) {
+                chry_sflash_norflash_fill_program_seq(flash, &command_seq);
+                async->chunk = flash->page_size - async->addr % flash->page_size;
+                if (async->chunk > async->len) {
+                    async->chunk = async->len;
+                }
+            } else {
+                chry_sflash_norflash_fill_read_seq(flash, &command_seq);
+                command_seq.dma_enable = true;
+                async->chunk = async->len;
+                if (async->chunk > CONFIG_CHRY_SFLASH_ASYNC_MAX_LEN) {
+                    async->chunk = CONFIG_CHRY_SFLASH_ASYNC_MAX_LEN;
+                }
+            }
+            command_seq.addr_phase.addr = async->addr;
+            command_seq.data_phase.buf = async->buf;
+            command_seq.data_phase.len = async->chunk;
+            break;
+    }
+
+    return chry_sflash_transfer_async(flash->host, &command_seq, chry_sflash_norflash_async_done, flash);
+}
+
+static void chry_sflash_norflash_async_done(struct chry_sflash_host *host, int status, void *arg)
+{
+    struct chry_sflash_norflash *flash = arg;
+    struct chry_sflash_norflash_async *async = &flash->async;
+    bool finished = false;
+
+    if (status == 0) {
+        switch (async->step) {
+            case NORFLASH_ASYNC_STEP_WAIT_READY:
+                flash->program_pending = false;
+                async->step = (async->op == NORFLASH_ASYNC_OP_READ) ? NORFLASH_ASYNC_STEP_COMMAND : NORFLASH_ASYNC_STEP_WREN;
+                break;
+            case NORFLASH_ASYNC_STEP_WREN:
+                async->step = NORFLASH_ASYNC_STEP_COMMAND;
+                break;
+            case NORFLASH_ASYNC_STEP_COMMAND:
+                async->addr += async->chunk;
+                if (async->buf != NULL) {
+                    async->buf += async->chunk;
+                }
+                async->len -= async->chunk;
+                if (async->op == NORFLASH_ASYNC_OP_READ) {
+                    /* the next chunk goes straight on, no command in between */
+                    finished = (async->len == 0);
+                } else {
+                    flash->program_pending = (async->op == NORFLASH_ASYNC_OP_WRITE);
+                    async->step = NORFLASH_ASYNC_STEP_WAIT_DONE;
+                }
+                break;
+            default:
+                flash->program_pending = false;
+                finished = (async->len == 0);
+                async->step = NORFLASH_ASYNC_STEP_WREN;
+                break;
+        }
+        if (!finished) {
+            status = chry_sflash_norflash_async_issue(flash);
+            if (status == 0) {
+                return;
+            }
+        }
+    }
+
+    async->op = NORFLASH_ASYNC_OP_NONE;
+    async->callback(flash, status, async->arg);
+}
+
+static int chry_sflash_norflash_async_begin(struct chry_sflash_norflash *flash, uint8_t op, uint32_t start_addr, uint8_t *buf, uint32_t buflen,
+                                            chry_sflash_norflash_callback_t callback, void *arg)
+{
+    struct chry_sflash_norflash_async *async = &flash->async;
+    int ret;
+
+    if (callback == NULL) {
+        return -CHRY_SFLASH_ERR_INVAL;
+    }
+    if ((start_addr + buflen) > flash->flash_size) {
+        return -CHRY_SFLASH_ERR_RANGE;
+    }
+    if (flash->host->dual_flash && ((start_addr | buflen) & 1U)) {
+        return -CHRY_SFLASH_ERR_INVAL;
+    }
+    if (async->op != NORFLASH_ASYNC_OP_NONE) {
+        return -CHRY_SFLASH_ERR_BUSY;
+    }
+    if (buflen == 0) {
+        callback(flash, 0, arg);
+        return 0;
+    }
+
+    async->op = op;
+    async->addr = start_addr;
+    async->buf = buf;
+    async->len = buflen;
+    async->callback = callback;
+    async->arg = arg;
+    /* reads only wait when a write_nowait page may still be programming */
+    if ((op == NORFLASH_ASYNC_OP_READ) && !flash->program_pending) {
+        async->step = NORFLASH_ASYNC_STEP_COMMAND;
+    } else {
+        async->step = NORFLASH_ASYNC_STEP_WAIT_READY;
+    }
+
+    ret = chry_sflash_norflash_async_issue(flash);
+    if (ret < 0) {
+        async->op = NORFLASH_ASYNC_OP_NONE;
+    }
+    return ret;
+}
+
+int chry_sflash_norflash_erase_async(struct chry_sflash_norflash *flash, uint32_t start_addr, uint32_t len,
+                                     chry_sflash_norflash_callback_t callback, void *arg)
+{
+    if ((flash->erase_type_count == 0) || (start_addr % flash->sector_size) || (len % flash->sector_size)) {
+        return -CHRY_SFLASH_ERR_INVAL;
+    }
+    return chry_sflash_norflash_async_begin(flash, NORFLASH_ASYNC_OP_ERASE, start_addr, NULL, len, callback, arg);
+}
+
+int chry_sflash_norflash_write_async(struct chry_sflash_norflash *flash, uint32_t start_addr, uint8_t *buf, uint32_t buflen,
+                                     chry_sflash_norflash_callback_t callback, void *arg)
+{
+    return chry_sflash_norflash_async_begin(flash, NORFLASH_ASYNC_OP_WRITE, start_addr, buf, buflen, callback, arg);
+}
+
+int chry_sflash_norflash_read_async(struct chry_sflash_norflash *flash, uint32_t start_addr, uint8_t *buf, uint32_t buflen,
+                                    chry_sflash_norflash_callback_t callback, void *arg)
+{
+    return chry_sflash_norflash_async_begin(flash, NORFLASH_ASYNC_OP_READ, start_addr, buf, buflen, callback, arg);
+}
+#endif
@@ -56,6 +56,53 @@
 #define NORFLASH_COMMAND_FAST_READ_1_4_4_3B    (0xEBU)
 #define NORFLASH_COMMAND_FAST_READ_1_4_4_4B    (0xECU)
 
+#define NORFLASH_COMMAND_FAST_READ_1_4_4_DTR_3B (0xEDU)
+#define NORFLASH_COMMAND_FAST_READ_1_4_4_DTR_4B (0xEEU)
+
+#define NORFLASH_COMMAND_PAGE_PROGRAM_4_4_4_3B (0x02U)
+#define NORFLASH_COMMAND_PAGE_PROGRAM_4_4_4_4B (0x12U)
+#define NORFLASH_COMMAND_ENTER_QPI_38          (0x38U)
+#define NORFLASH_COMMAND_ENTER_QPI_35          (0x35U)
+#define NORFLASH_COMMAND_EXIT_QPI_FF           (0xFFU)
+#define NORFLASH_COMMAND_EXIT_QPI_F5           (0xF5U)
+#define NORFLASH_COMMAND_RESET_ENABLE          (0x66U)
+#define NORFLASH_COMMAND_RESET                 (0x99U)
+
+/*
+ * SFDP carries no clock limits. The bus is ramped to one of these after
+ * discovery, the plain 03h/13h read without dummy cycles is the slow one
+ * and DTR reads have their own, lower, limit.
+ */
+#ifndef NORFLASH_READ_MAX_FREQUENCY
+#define NORFLASH_READ_MAX_FREQUENCY            (50000000U)
+#endif
+#ifndef NORFLASH_FAST_READ_MAX_FREQUENCY
+#define NORFLASH_FAST_READ_MAX_FREQUENCY       (104000000U)
+#endif
+#ifndef NORFLASH_DTR_READ_MAX_FREQUENCY
+#define NORFLASH_DTR_READ_MAX_FREQUENCY        (80000000U)
+#endif
+/* SFDP only flags DTR clocking, the dummy clocks (mode clock included) of EDh are the common ones */
+#ifndef NORFLASH_DTR_READ_DUMMY_CLOCKS
+#define NORFLASH_DTR_READ_DUMMY_CLOCKS         (8U)
+#endif
+
+/* Used when the SFDP table is too old to describe the chip erase time */
+#define NORFLASH_CHIP_ERASE_TIMEOUT_DEFAULT_MS (400000U)
+/* Upper bound for a single page program left running by write_nowait */
+#define NORFLASH_PAGE_PROGRAM_TIMEOUT_MS       (100U)
+/* Upper bound for one sector or block erase when SFDP has no erase times */
+#define NORFLASH_BLOCK_ERASE_TIMEOUT_MS        (5000U)
+/* SFDP dword8/9 describe up to four erase types */
+#define NORFLASH_ERASE_TYPE_MAX                (4U)
+
+/* what a suspend of the running operation would suspend, see busy_op */
+#define NORFLASH_BUSY_NONE                     (0U)
+#define NORFLASH_BUSY_ERASE                    (1U)
+#define NORFLASH_BUSY_PROGRAM                  (2U)
+/* Upper bound for a status register write */
+#define NORFLASH_WRITE_STATUS_TIMEOUT_MS       (100U)
+
 struct chry_sflash_norflash_jedec_info {
     jedec_basic_flash_param_table_t basic_flash_param_table;
     uint32_t basic_flash_param_table_size;
@@ -63,17 +110,57 @@ struct chry_sflash_norflash_jedec_info {
     bool jedec_4byte_addressing_inst_table_enable;
 };
 
+/*
+ * One SFDP erase type. cover_ms is the cheapest time for a full aligned
+ * unit, either typical_ms or, with split set, the units of the next
+ * smaller type that together are faster.
+ */
+struct chry_sflash_norflash_erase_type {
+    uint32_t size;
+    uint32_t typical_ms;
+    uint32_t cover_ms;
+    uint32_t timeout_ms;
+    uint8_t cmd;
+    bool split;
+};
+
+/* SFDP dword12/13 suspend and resume of an erase or a program */
+struct chry_sflash_norflash_suspend {
+    uint8_t suspend_cmd;
+    uint8_t resume_cmd;
+    uint32_t latency_us;  /* suspend until the part is ready, max */
+    uint32_t interval_us; /* resume until the next suspend, min, the operation makes no progress otherwise */
+};
+
+struct chry_sflash_norflash;
+
+#ifdef CONFIG_CHRY_SFLASH_ASYNC
+typedef void (*chry_sflash_norflash_callback_t)(struct chry_sflash_norflash *flash, int status, void *arg);
+
+/* progress of the one non-blocking operation a flash can have in flight */
+struct chry_sflash_norflash_async {
+    uint8_t op;
+    uint8_t step;
+    uint8_t status;
+    uint32_t addr;
+    uint8_t *buf;
+    uint32_t len;
+    uint32_t chunk;
+    uint32_t timeout_ms;
+    chry_sflash_norflash_callback_t callback;
+    void *arg;
+};
+#endif
+
 struct chry_sflash_norflash {
     struct chry_sflash_host *host;
     uint8_t sfdp_major_version;
     uint8_t sfdp_minor_version;
     uint32_t flash_size;
-    uint32_t block_size;
-    uint32_t sector_size;
+    uint32_t block_size;           /* largest erase type below 1 MB */
+    uint32_t sector_size;          /* smallest erase type */
     uint32_t page_size;
     uint8_t addr_size;
-    uint8_t block_erase_cmd;
-    uint8_t sector_erase_cmd;
     uint8_t page_program_cmd;
     uint8_t page_program_addr_mode;
     uint8_t page_program_data_mode;
@@ -81,6 +168,30 @@ struct chry_sflash_norflash {
     uint8_t read_addr_mode;
     uint8_t read_dummy_bytes;
     uint8_t read_data_mode;
+    bool read_dtr;
+    uint8_t cmd_mode;              /* 4 lines while the part is in QPI (4-4-4) mode */
+    uint8_t qpi_enable_cmd;        /* 0 when QPI is not used */
+    uint8_t qpi_disable_seq;       /* SFDP dword15 4-4-4 mode disable sequence */
+    uint8_t qpi_read_cmd;
+    uint8_t qpi_read_dummy_bytes;
+    struct chry_sflash_norflash_erase_type erase_types[NORFLASH_ERASE_TYPE_MAX]; /* ascending size */
+    uint8_t erase_type_count;
+    uint32_t chip_erase_typical_ms; /* 0 when SFDP has no chip erase time */
+    struct chry_sflash_norflash_suspend suspend[2]; /* erase, program */
+    bool suspend_enable;           /* SFDP suspend/resume; erase and program then give the bus up while they wait */
+    uint8_t busy_op;               /* NORFLASH_BUSY_*, an erase or program started and not yet seen done */
+    uint32_t busy_addr;            /* area of busy_op, reads inside it wait instead of suspending */
+    uint32_t busy_len;
+    uint32_t busy_seq;             /* counts started busy_ops, a waiter whose count moved on knows its own is done */
+    uint32_t resume_tick_ms;
+    uint32_t suspend_tick_ms;
+    uint32_t suspended_ms;         /* busy_op made no progress for this long, its timeout starts later by as much */
+    uint32_t chip_erase_timeout_ms;
+    uint32_t max_frequency;
+    bool program_pending;
+#ifdef CONFIG_CHRY_SFLASH_ASYNC
+    struct chry_sflash_norflash_async async;
+#endif
 };
 
 #ifdef __cplusplus
@@ -88,9 +199,36 @@ extern "C" {
 #endif
 
 int chry_sflash_norflash_init(struct chry_sflash_norflash *flash, struct chry_sflash_host *host);
+int chry_sflash_norflash_deinit(struct chry_sflash_norflash *flash);
+int chry_sflash_norflash_enter_qpi(struct chry_sflash_norflash *flash);
+int chry_sflash_norflash_exit_qpi(struct chry_sflash_norflash *flash);
+int chry_sflash_norflash_read_jedec_id(struct chry_sflash_norflash *flash, uint8_t *id, uint32_t len);
 int chry_sflash_norflash_erase(struct chry_sflash_norflash *flash, uint32_t start_addr, uint32_t len);
+int chry_sflash_norflash_erase_chip(struct chry_sflash_norflash *flash);
 int chry_sflash_norflash_write(struct chry_sflash_norflash *flash, uint32_t start_addr, uint8_t *buf, uint32_t buflen);
+int chry_sflash_norflash_write_nowait(struct chry_sflash_norflash *flash, uint32_t start_addr, uint8_t *buf, uint32_t buflen);
+int chry_sflash_norflash_wait_idle(struct chry_sflash_norflash *flash);
 int chry_sflash_norflash_read(struct chry_sflash_norflash *flash, uint32_t start_addr, uint8_t *buf, uint32_t buflen);
+int chry_sflash_norflash_memory_map(struct chry_sflash_norflash *flash, void **addr);
+int chry_sflash_norflash_crc32(struct chry_sflash_norflash *flash, uint32_t start_addr, uint32_t len, uint32_t *crc);
+
+#ifdef CONFIG_CHRY_SFLASH_ASYNC
+/*
+ * Non-blocking erase, write and read on chry_sflash_transfer_async(). Each
+ * step (WREN, command, status poll) is queued from the completion of the
+ * previous one and the callback reports the result of the whole operation.
+ * One operation per flash at a time, until the callback a second one and
+ * the blocking calls on the flash return -CHRY_SFLASH_ERR_BUSY. Reads go
+ * in pieces of CONFIG_CHRY_SFLASH_ASYNC_MAX_LEN. In dual-flash mode
+ * address and length must be even.
+ */
+int chry_sflash_norflash_erase_async(struct chry_sflash_norflash *flash, uint32_t start_addr, uint32_t len,
+                                     chry_sflash_norflash_callback_t callback, void *arg);
+int chry_sflash_norflash_write_async(struct chry_sflash_norflash *flash, uint32_t start_addr, uint8_t *buf, uint32_t buflen,
+                                     chry_sflash_norflash_callback_t callback, void *arg);
+int chry_sflash_norflash_read_async(struct chry_sflash_norflash *flash, uint32_t start_addr, uint8_t *buf, uint32_t buflen,
+                                    chry_sflash_norflash_callback_t callback, void *arg);
+#endif
 
 #ifdef __cplusplus
 }
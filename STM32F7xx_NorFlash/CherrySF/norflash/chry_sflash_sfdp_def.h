@@ -25,6 +25,7 @@
 #define SFDP_BASIC_PROTOCOL_TABLE_SIZE_REVB                                SFDP_BASIC_PROTOCOL_TABLE_SIZE_REVA
 #define SFDP_BASIC_PROTOCOL_TABLE_SIZE_REVC                                (80U)
 #define SFDP_BASIC_PROTOCOL_TABLE_SIZE_REVD                                SFDP_BASIC_PROTOCOL_TABLE_SIZE_REVC
+#define SFDP_BASIC_PROTOCOL_TABLE_SIZE_REVF                                (92U)
 
 #define SFDP_PARAMETER_ID_BASIC_SPI_PROTOCOL                               (0xFF00U)
 #define SFDP_PARAMETER_ID_SECTOR_MAP                                       (0xFF81U)
@@ -145,7 +146,16 @@ typedef union _jedec_flash_param_table {
             uint32_t reserved0                    : 1;
         } dword11;
         struct {
-            uint32_t reserved0;
+            uint32_t program_suspend_prohibited_ops    : 4;
+            uint32_t erase_suspend_prohibited_ops      : 4;
+            uint32_t reserved0                         : 1;
+            uint32_t program_resume_suspend_interval   : 4;
+            uint32_t program_suspend_max_latency_count : 5;
+            uint32_t program_suspend_max_latency_unit  : 2;
+            uint32_t erase_resume_suspend_interval     : 4;
+            uint32_t erase_suspend_max_latency_count   : 5;
+            uint32_t erase_suspend_max_latency_unit    : 2;
+            uint32_t suspend_resume_unsupported        : 1;
         } dword12;
         struct {
             uint32_t inst_program_resume  : 8;
@@ -4,7 +4,7 @@
  *
  * SPDX-License-Identifier: Apache-2.0
  */
-#include "chry_sflash.h"
+#include "chry_sflash_port_hpm.h"
 
 #ifdef HPMSOC_HAS_HPMSDK_DMAV2
 #include "hpm_dmav2_drv.h"
@@ -16,27 +16,25 @@
 #include "hpm_l1c_drv.h"
 #include "hpm_clock_drv.h"
 #include "hpm_gpio_drv.h"
+#include "hpm_csr_drv.h"
+#include "hpm_interrupt.h"
 #include "hpm_spi.h"
 #include "board.h"
 
-typedef struct {
-    uint8_t rx_dma_ch;
-    uint8_t tx_dma_ch;
-    uint8_t rx_dma_req;
-    uint8_t tx_dma_req;
-    void *dma_base;
-    void *dmamux_base;
-} hpm_spi_dma_config_t;
-
-typedef struct {
-    hpm_spi_dma_config_t dma_control;
-    uint32_t transfer_max_size;
-    SPI_Type *host_base;
-    uint16_t cs_pin;
-} hpm_spi_config_t;
+/* Upper bound for one SPI transaction when it completes by interrupt */
+#define HPM_SPI_XFER_TIMEOUT_MS 1000
+/* Controllers that complete by interrupt */
+#define HPM_SPI_MAX_IRQ_HOSTS   4
+/* Cache line sized bounce buffers for the unaligned ends of DMA reads */
+#define HPM_SPI_BOUNCE_COUNT    4
 
 #include "hpm_spi_config.h"
 
+static hpm_spi_config_t *irq_configs[HPM_SPI_MAX_IRQ_HOSTS];
+
+ATTR_ALIGN(HPM_L1C_CACHELINE_SIZE) static uint8_t bounce_pool[HPM_SPI_BOUNCE_COUNT][HPM_L1C_CACHELINE_SIZE];
+static uint32_t bounce_used;
+
 static hpm_stat_t spi_nor_tx_trigger_dma(DMA_Type *dma_ptr, uint8_t ch_num, SPI_Type *spi_ptr,
                                          uint32_t src, uint8_t data_width, uint32_t size, uint8_t burst_size)
 {
@@ -92,7 +90,8 @@ static hpm_stat_t spi_nor_rx_trigger_dma(DMA_Type *dma_ptr, uint8_t ch_num, SPI_
 static void hpm_config_cmd_addr_format(hpm_spi_config_t *config, struct chry_sflash_request *cmd_seq, spi_control_config_t *control_config)
 {
     spi_trans_mode_t _trans_mode;
-    control_config->master_config.cmd_enable = true;
+    /* continuation segments of a scatter-gather data phase have no command */
+    control_config->master_config.cmd_enable = (cmd_seq->cmd_phase.cmd_mode != CHRY_SFLASH_CMDMODE_NONE);
 
     /* judge the valid of addr */
     if (cmd_seq->addr_phase.addr_mode != CHRY_SFLASH_ADDRMODE_NONE) {
@@ -161,117 +160,222 @@ static hpm_stat_t init(hpm_spi_config_t *config)
                                             config->dma_control.tx_dma_ch),
                   config->dma_control.tx_dma_req, true);
 
+    if (config->irq != 0) {
+        for (uint8_t i = 0; i < HPM_SPI_MAX_IRQ_HOSTS; i++) {
+            if ((irq_configs[i] == NULL) || (irq_configs[i] == config)) {
+                irq_configs[i] = config;
+                break;
+            }
+            if (i == HPM_SPI_MAX_IRQ_HOSTS - 1) {
+                return status_invalid_argument;
+            }
+        }
+        spi_disable_interrupt(config->host_base, spi_end_int);
+        intc_m_enable_irq_with_priority(config->irq, 1);
+    }
+
     return status_success;
 }
 
-static hpm_stat_t hpm_spi_transfer_via_dma(hpm_spi_config_t *config, spi_control_config_t *control_config,
-                                           uint8_t cmd, uint32_t addr,
-                                           uint8_t *buf, uint32_t len, bool is_read)
+void chry_sflash_hpm_spi_isr(SPI_Type *spi_ptr)
 {
-    hpm_stat_t stat;
-    uint32_t data_width = 0;
-    uint8_t burst_size = DMA_NUM_TRANSFER_PER_BURST_1T;
-    uint32_t timeout_count = 0;
-    uint16_t dma_send_size;
-    if (is_read) {
-        /*The supplement of the byte less than the integer multiple of four bytes is an integer multiple of four bytes to DMA*/
-        data_width = DMA_TRANSFER_WIDTH_WORD;
-        if ((len % 4) == 0) {
-            dma_send_size = len;
-        } else {
-            dma_send_size = ((len >> 2) + 1) << 2;
+    hpm_spi_config_t *config;
+
+    for (uint8_t i = 0; i < HPM_SPI_MAX_IRQ_HOSTS; i++) {
+        config = irq_configs[i];
+        if ((config == NULL) || (config->host_base != spi_ptr)) {
+            continue;
         }
-        stat = spi_setup_dma_transfer((SPI_Type *)config->host_base, control_config, &cmd, &addr, 0, len);
-        stat = spi_nor_rx_trigger_dma((DMA_Type *)config->dma_control.dma_base,
-                                      config->dma_control.rx_dma_ch,
-                                      (SPI_Type *)config->host_base,
-                                      core_local_mem_to_sys_address(BOARD_RUNNING_CORE, (uint32_t)buf),
-                                      data_width,
-                                      dma_send_size, burst_size);
-        while (spi_is_active((SPI_Type *)config->host_base)) {
-            timeout_count++;
-            if (timeout_count >= 0xFFFFFF) {
-                stat = status_timeout;
-                break;
+        if (spi_get_interrupt_status(spi_ptr) & spi_end_int) {
+            spi_clear_interrupt_status(spi_ptr, spi_end_int);
+            spi_disable_interrupt(spi_ptr, spi_end_int);
+            config->xfer_done = true;
+            if (config->signal != NULL) {
+                config->signal(config->wait_arg);
             }
         }
-        timeout_count = 0;
-        if ((dma_check_transfer_status(
-                 (DMA_Type *)config->dma_control.dma_base,
-                 config->dma_control.rx_dma_ch) &&
-             DMA_CHANNEL_STATUS_TC) == 0) {
-            dma_disable_channel((DMA_Type *)config->dma_control.dma_base, config->dma_control.rx_dma_ch);
-            dma_reset((DMA_Type *)config->dma_control.dma_base);
-        }
-    } else {
-        if ((len % 4) == 0) {
-            spi_enable_data_merge((SPI_Type *)config->host_base);
-            data_width = DMA_TRANSFER_WIDTH_WORD;
-        } else {
-            data_width = DMA_TRANSFER_WIDTH_BYTE;
-        }
-        spi_set_tx_fifo_threshold((SPI_Type *)config->host_base, 3);
-        burst_size = DMA_NUM_TRANSFER_PER_BURST_1T;
-        stat = spi_setup_dma_transfer((SPI_Type *)config->host_base, control_config, &cmd, &addr, len, 0);
+        return;
+    }
+}
+
+/* before the transaction is triggered, so its end cannot be missed */
+static void hpm_spi_arm_done(hpm_spi_config_t *config)
+{
+    if (config->irq != 0) {
+        config->xfer_done = false;
+        spi_clear_interrupt_status(config->host_base, spi_end_int);
+        spi_enable_interrupt(config->host_base, spi_end_int);
+    }
+}
 
-        stat = spi_nor_tx_trigger_dma((DMA_Type *)config->dma_control.dma_base,
-                                      config->dma_control.tx_dma_ch,
-                                      (SPI_Type *)config->host_base,
-                                      core_local_mem_to_sys_address(BOARD_RUNNING_CORE, (uint32_t)buf),
-                                      data_width, len, burst_size);
+static hpm_stat_t hpm_spi_wait_idle(hpm_spi_config_t *config)
+{
+    SPI_Type *spi_ptr = config->host_base;
+    hpm_stat_t stat = status_success;
+    uint32_t timeout_count = 0;
+    uint64_t timeout_cycles;
+    uint64_t start;
 
-        while (spi_is_active((SPI_Type *)config->host_base)) {
+    if (config->irq == 0) {
+        while (spi_is_active(spi_ptr)) {
             timeout_count++;
             if (timeout_count >= 0xFFFFFF) {
+                return status_timeout;
+            }
+        }
+        return status_success;
+    }
+
+    start = hpm_csr_get_core_mcycle();
+    if (config->wait != NULL) {
+        /* a stale signal from an earlier timeout just waits again */
+        while (!config->xfer_done) {
+            if (config->wait(config->wait_arg, HPM_SPI_XFER_TIMEOUT_MS) != 0) {
+                stat = config->xfer_done ? status_success : status_timeout;
+                break;
+            }
+        }
+    } else {
+        timeout_cycles = (uint64_t)(clock_get_frequency(clock_cpu0) / 1000) * HPM_SPI_XFER_TIMEOUT_MS;
+        while (!config->xfer_done) {
+            /* WFI returns for a pending interrupt even while they are masked, the flag cannot be missed */
+            disable_global_irq(CSR_MSTATUS_MIE_MASK);
+            if (!config->xfer_done) {
+                __asm volatile("wfi");
+            }
+            enable_global_irq(CSR_MSTATUS_MIE_MASK);
+            if ((hpm_csr_get_core_mcycle() - start) > timeout_cycles) {
                 stat = status_timeout;
                 break;
             }
         }
-        timeout_count = 0;
-        spi_disable_data_merge((SPI_Type *)config->host_base);
+    }
+    config->wait_cycles += hpm_csr_get_core_mcycle() - start;
+
+    if (stat != status_success) {
+        spi_disable_interrupt(spi_ptr, spi_end_int);
     }
     return stat;
 }
 
+static hpm_stat_t hpm_spi_transfer_via_dma(hpm_spi_config_t *config, spi_control_config_t *control_config,
+                                           uint8_t cmd, uint32_t addr,
+                                           uint8_t *buf, uint32_t len)
+{
+    hpm_stat_t stat;
+    uint32_t data_width = 0;
+    uint8_t burst_size = DMA_NUM_TRANSFER_PER_BURST_1T;
+
+    /* word wide DMA needs a word aligned source as well */
+    if (((len | (uint32_t)buf) % 4) == 0) {
+        spi_enable_data_merge((SPI_Type *)config->host_base);
+        data_width = DMA_TRANSFER_WIDTH_WORD;
+    } else {
+        data_width = DMA_TRANSFER_WIDTH_BYTE;
+    }
+    spi_set_tx_fifo_threshold((SPI_Type *)config->host_base, 3);
+    hpm_spi_arm_done(config);
+    stat = spi_setup_dma_transfer((SPI_Type *)config->host_base, control_config, &cmd, &addr, len, 0);
+
+    stat = spi_nor_tx_trigger_dma((DMA_Type *)config->dma_control.dma_base,
+                                  config->dma_control.tx_dma_ch,
+                                  (SPI_Type *)config->host_base,
+                                  core_local_mem_to_sys_address(BOARD_RUNNING_CORE, (uint32_t)buf),
+                                  data_width, len, burst_size);
+
+    if (stat == status_success) {
+        stat = hpm_spi_wait_idle(config);
+    }
+    spi_disable_data_merge((SPI_Type *)config->host_base);
+    return stat;
+}
+
+/* like read(), a write longer than one SPI transaction continues as data-only transactions */
 static hpm_stat_t write(hpm_spi_config_t *config, struct chry_sflash_request *cmd_seq)
 {
     hpm_stat_t stat = status_success;
     spi_control_config_t control_config = { 0 };
+    struct chry_sflash_request cont_seq;
     uint32_t aligned_start;
     uint32_t aligned_end;
     uint32_t aligned_size;
-    if ((cmd_seq->data_phase.len > config->transfer_max_size) || (config == NULL) || (config->host_base == NULL)) {
+    uint32_t write_size;
+    uint32_t write_start = cmd_seq->addr_phase.addr;
+    uint8_t *src_8 = (uint8_t *)cmd_seq->data_phase.buf;
+    uint32_t remaining_len = cmd_seq->data_phase.len;
+    bool dma = (cmd_seq->dma_enable == 1);
+
+    if ((config == NULL) || (config->host_base == NULL)) {
         return status_invalid_argument;
     }
 
-    gpio_write_pin(HPM_GPIO0, GPIO_GET_PORT_INDEX(config->cs_pin), GPIO_GET_PIN_INDEX(config->cs_pin), false);
-
     spi_master_get_default_control_config(&control_config);
     hpm_config_cmd_addr_format(config, cmd_seq, &control_config);
 
-    if (cmd_seq->dma_enable == 1) {
+    if (dma) {
         control_config.common_config.tx_dma_enable = true;
         control_config.common_config.rx_dma_enable = false;
         if (l1c_dc_is_enabled()) {
             /* cache writeback for sent buff */
-            aligned_start = HPM_L1C_CACHELINE_ALIGN_DOWN((uint32_t)cmd_seq->data_phase.buf);
-            aligned_end = HPM_L1C_CACHELINE_ALIGN_UP((uint32_t)cmd_seq->data_phase.buf + cmd_seq->data_phase.len);
+            aligned_start = HPM_L1C_CACHELINE_ALIGN_DOWN((uint32_t)src_8);
+            aligned_end = HPM_L1C_CACHELINE_ALIGN_UP((uint32_t)src_8 + remaining_len);
             aligned_size = aligned_end - aligned_start;
             l1c_dc_writeback(aligned_start, aligned_size);
         }
-        stat = hpm_spi_transfer_via_dma(config, &control_config, cmd_seq->cmd_phase.cmd, cmd_seq->addr_phase.addr,
-                                        (uint8_t *)cmd_seq->data_phase.buf, cmd_seq->data_phase.len, false);
-    } else {
-        stat = spi_transfer((SPI_Type *)config->host_base, &control_config,
-                            &cmd_seq->cmd_phase.cmd, &cmd_seq->addr_phase.addr,
-                            cmd_seq->data_phase.buf, cmd_seq->data_phase.len, NULL, 0);
     }
 
-    gpio_write_pin(HPM_GPIO0, GPIO_GET_PORT_INDEX(config->cs_pin), GPIO_GET_PIN_INDEX(config->cs_pin), true);
+    do {
+        write_size = MIN(remaining_len, config->transfer_max_size);
+        if (dma) {
+            stat = hpm_spi_transfer_via_dma(config, &control_config, cmd_seq->cmd_phase.cmd, write_start,
+                                            src_8, write_size);
+        } else {
+            stat = spi_transfer((SPI_Type *)config->host_base, &control_config,
+                                &cmd_seq->cmd_phase.cmd, &write_start,
+                                src_8, write_size, NULL, 0);
+        }
+        HPM_BREAK_IF(stat != status_success);
+        remaining_len -= write_size;
+        src_8 += write_size;
+
+        if ((remaining_len > 0U) && control_config.master_config.cmd_enable) {
+            cont_seq = *cmd_seq;
+            cont_seq.cmd_phase.cmd_mode = CHRY_SFLASH_CMDMODE_NONE;
+            cont_seq.addr_phase.addr_mode = CHRY_SFLASH_ADDRMODE_NONE;
+            cont_seq.dummy_phase.dummy_bytes = 0;
+            spi_master_get_default_control_config(&control_config);
+            hpm_config_cmd_addr_format(config, &cont_seq, &control_config);
+            control_config.common_config.tx_dma_enable = dma;
+            control_config.common_config.rx_dma_enable = false;
+        }
+    } while (remaining_len > 0U);
 
     return stat;
 }
 
+static hpm_stat_t hpm_dma_wait_done(DMA_Type *dma_ptr, uint8_t ch_num)
+{
+    uint32_t timeout_count = 0;
+    uint32_t status;
+
+    while (1) {
+        status = dma_check_transfer_status(dma_ptr, ch_num);
+        if (status & DMA_CHANNEL_STATUS_TC) {
+            return status_success;
+        }
+        if ((status & (DMA_CHANNEL_STATUS_ERROR | DMA_CHANNEL_STATUS_ABORT)) || (++timeout_count >= 0xFFFFFF)) {
+            return status_fail;
+        }
+    }
+}
+
+/*
+ * One SPI transaction moves at most transfer_max_size bytes. Chip select
+ * stays low for the whole read, so the part keeps streaming: the first
+ * transaction carries command, address and dummy cycles, the following
+ * ones are data only. With DMA the rx channel is armed once for the whole
+ * buffer and only the SPI controller is re-triggered per transaction.
+ */
 static hpm_stat_t read(hpm_spi_config_t *config, struct chry_sflash_request *cmd_seq)
 {
     hpm_stat_t stat = status_success;
@@ -279,89 +383,253 @@ static hpm_stat_t read(hpm_spi_config_t *config, struct chry_sflash_request *cmd
     uint32_t aligned_end;
     uint32_t aligned_size;
     spi_control_config_t control_config = { 0 };
+    struct chry_sflash_request cont_seq;
+    SPI_Type *spi_ptr;
+    DMA_Type *dma_ptr;
     uint32_t read_size = 0;
     uint32_t read_start = cmd_seq->addr_phase.addr;
     uint8_t *dst_8 = (uint8_t *)cmd_seq->data_phase.buf;
     uint32_t remaining_len = cmd_seq->data_phase.len;
+    bool dma = (cmd_seq->dma_enable == 1);
 
     if ((config == NULL) || (config->host_base == NULL)) {
         return status_invalid_argument;
     }
+    spi_ptr = (SPI_Type *)config->host_base;
+    dma_ptr = (DMA_Type *)config->dma_control.dma_base;
+    if (dma && (dma_ptr == NULL)) {
+        return status_fail;
+    }
 
     spi_master_get_default_control_config(&control_config);
     hpm_config_cmd_addr_format(config, cmd_seq, &control_config);
 
-    if (cmd_seq->dma_enable == 1) {
-        if (config->dma_control.dma_base == NULL) {
-            return status_fail;
-        }
-        // if (((uint32_t)dst_8 % HPM_L1C_CACHELINE_SIZE) != 0) {
-        //     return status_invalid_argument;
-        // }
+    if (dma) {
         control_config.common_config.tx_dma_enable = false;
         control_config.common_config.rx_dma_enable = true;
+        /* no dirty line may be evicted over the DMA data, the lines are owned entirely, see transfer_data() */
+        if (l1c_dc_is_enabled()) {
+            aligned_start = HPM_L1C_CACHELINE_ALIGN_DOWN((uint32_t)dst_8);
+            aligned_end = HPM_L1C_CACHELINE_ALIGN_UP((uint32_t)dst_8 + remaining_len);
+            aligned_size = aligned_end - aligned_start;
+            l1c_dc_invalidate(aligned_start, aligned_size);
+        }
+        /* word wide DMA, the supplement to a multiple of four bytes is written past the data */
+        spi_enable_data_merge(spi_ptr);
+        stat = spi_nor_rx_trigger_dma(dma_ptr, config->dma_control.rx_dma_ch, spi_ptr,
+                                      core_local_mem_to_sys_address(BOARD_RUNNING_CORE, (uint32_t)dst_8),
+                                      DMA_TRANSFER_WIDTH_WORD, (remaining_len + 3U) & ~3U, DMA_NUM_TRANSFER_PER_BURST_1T);
+        if (stat != status_success) {
+            spi_disable_data_merge(spi_ptr);
+            return stat;
+        }
     }
 
-    gpio_write_pin(HPM_GPIO0, GPIO_GET_PORT_INDEX(config->cs_pin), GPIO_GET_PIN_INDEX(cmd_seq->cs_pin), false);
-
     while (remaining_len > 0U) {
         read_size = MIN(remaining_len, config->transfer_max_size);
-        if (cmd_seq->dma_enable == 1) {
-            spi_enable_data_merge((SPI_Type *)config->host_base);
-            stat = hpm_spi_transfer_via_dma(config, &control_config, cmd_seq->cmd_phase.cmd, read_start, dst_8, read_size, true);
+        if (dma) {
+            hpm_spi_arm_done(config);
+            stat = spi_setup_dma_transfer(spi_ptr, &control_config, &cmd_seq->cmd_phase.cmd, &read_start, 0, read_size);
+            if (stat == status_success) {
+                stat = hpm_spi_wait_idle(config);
+            }
         } else {
-            stat = spi_transfer((SPI_Type *)config->host_base, &control_config, &cmd_seq->cmd_phase.cmd,
+            stat = spi_transfer(spi_ptr, &control_config, &cmd_seq->cmd_phase.cmd,
                                 &read_start, NULL, 0, dst_8, read_size);
         }
         HPM_BREAK_IF(stat != status_success);
+        remaining_len -= read_size;
+        dst_8 += read_size;
+
+        if ((remaining_len > 0U) && control_config.master_config.cmd_enable) {
+            cont_seq = *cmd_seq;
+            cont_seq.cmd_phase.cmd_mode = CHRY_SFLASH_CMDMODE_NONE;
+            cont_seq.addr_phase.addr_mode = CHRY_SFLASH_ADDRMODE_NONE;
+            cont_seq.dummy_phase.dummy_bytes = 0;
+            spi_master_get_default_control_config(&control_config);
+            hpm_config_cmd_addr_format(config, &cont_seq, &control_config);
+            control_config.common_config.tx_dma_enable = false;
+            control_config.common_config.rx_dma_enable = dma;
+        }
+    }
+
+    if (dma) {
+        if (stat == status_success) {
+            stat = hpm_dma_wait_done(dma_ptr, config->dma_control.rx_dma_ch);
+        }
+        if (stat != status_success) {
+            dma_disable_channel(dma_ptr, config->dma_control.rx_dma_ch);
+            dma_reset(dma_ptr);
+        }
+        /* cache invalidate for receive buff, once for the whole read */
         if (l1c_dc_is_enabled()) {
-            /* cache invalidate for receive buff */
-            aligned_start = HPM_L1C_CACHELINE_ALIGN_DOWN((uint32_t)dst_8);
-            aligned_end = HPM_L1C_CACHELINE_ALIGN_UP(read_size);
+            aligned_start = HPM_L1C_CACHELINE_ALIGN_DOWN((uint32_t)cmd_seq->data_phase.buf);
+            aligned_end = HPM_L1C_CACHELINE_ALIGN_UP((uint32_t)cmd_seq->data_phase.buf + cmd_seq->data_phase.len);
             aligned_size = aligned_end - aligned_start;
             l1c_dc_invalidate(aligned_start, aligned_size);
         }
-        read_start += read_size;
-        remaining_len -= read_size;
-        dst_8 += read_size;
     }
 
-    gpio_write_pin(HPM_GPIO0, GPIO_GET_PORT_INDEX(config->cs_pin), GPIO_GET_PIN_INDEX(config->cs_pin), true);
-    spi_disable_data_merge((SPI_Type *)config->host_base);
+    spi_disable_data_merge(spi_ptr);
+    return stat;
+}
+
+static hpm_stat_t transfer_one(hpm_spi_config_t *config, struct chry_sflash_request *command_seq)
+{
+    if (command_seq->data_phase.direction == CHRY_SFLASH_DATA_READ) {
+        return read(config, command_seq);
+    }
+    return write(config, command_seq);
+}
+
+static uint8_t *hpm_bounce_get(void)
+{
+    uint8_t *buf = NULL;
+    uint32_t level = disable_global_irq(CSR_MSTATUS_MIE_MASK);
+
+    for (uint8_t i = 0; i < HPM_SPI_BOUNCE_COUNT; i++) {
+        if ((bounce_used & (1U << i)) == 0) {
+            bounce_used |= (1U << i);
+            buf = bounce_pool[i];
+            break;
+        }
+    }
+    restore_global_irq(level);
+    return buf;
+}
+
+static void hpm_bounce_put(uint8_t *buf)
+{
+    uint32_t level = disable_global_irq(CSR_MSTATUS_MIE_MASK);
+
+    bounce_used &= ~(1U << ((buf - bounce_pool[0]) / HPM_L1C_CACHELINE_SIZE));
+    restore_global_irq(level);
+}
+
+/*
+ * DMA buffer manager for reads. The DMA writes memory behind the data
+ * cache, so a read may only invalidate cache lines it owns entirely, and
+ * the word wide DMA writes up to three bytes past the data. The cache
+ * line aligned middle of the buffer therefore goes to DMA in place, the
+ * unaligned head and tail, less than a line each, go through bounce
+ * buffers and are copied out. With the pool empty a fragment is read by
+ * the CPU instead. Writes only clean the cache and go to DMA in place.
+ */
+static hpm_stat_t transfer_data(hpm_spi_config_t *config, struct chry_sflash_request *command_seq)
+{
+    hpm_stat_t stat = status_success;
+    struct chry_sflash_request piece;
+    uint8_t *buf = command_seq->data_phase.buf;
+    uint32_t len = command_seq->data_phase.len;
+    uint32_t sizes[3];
+    uint8_t *bounce;
+
+    if ((command_seq->dma_enable == 0) || (command_seq->data_phase.direction != CHRY_SFLASH_DATA_READ)) {
+        return transfer_one(config, command_seq);
+    }
+
+    sizes[0] = MIN(len, HPM_L1C_CACHELINE_ALIGN_UP((uint32_t)buf) - (uint32_t)buf);
+    sizes[1] = HPM_L1C_CACHELINE_ALIGN_DOWN(len - sizes[0]);
+    sizes[2] = len - sizes[0] - sizes[1];
+    if ((sizes[0] == 0) && (sizes[2] == 0)) {
+        return transfer_one(config, command_seq);
+    }
+
+    piece = *command_seq;
+    for (uint8_t i = 0; i < 3; i++) {
+        if (sizes[i] == 0) {
+            continue;
+        }
+        bounce = (i != 1) ? hpm_bounce_get() : NULL;
+        piece.data_phase.buf = (bounce != NULL) ? bounce : buf;
+        piece.data_phase.len = sizes[i];
+        piece.dma_enable = (i == 1) || (bounce != NULL);
+        stat = transfer_one(config, &piece);
+        if (bounce != NULL) {
+            if (stat == status_success) {
+                memcpy(buf, bounce, sizes[i]);
+            }
+            hpm_bounce_put(bounce);
+        }
+        HPM_BREAK_IF(stat != status_success);
+        buf += sizes[i];
+        piece.cmd_phase.cmd_mode = CHRY_SFLASH_CMDMODE_NONE;
+        piece.addr_phase.addr_mode = CHRY_SFLASH_ADDRMODE_NONE;
+        piece.dummy_phase.dummy_bytes = 0;
+    }
     return stat;
 }
 
 static hpm_stat_t transfer(hpm_spi_config_t *config, struct chry_sflash_request *command_seq)
 {
     hpm_stat_t stat = status_success;
-    if (command_seq->data_phase.direction == CHRY_SFLASH_DATA_READ) {
-        stat = read(config, command_seq);
+    struct chry_sflash_request seg_seq;
+
+    /* chip select is a GPIO, it stays low while the segments follow as data-only DMA transfers */
+    gpio_write_pin(HPM_GPIO0, GPIO_GET_PORT_INDEX(config->cs_pin), GPIO_GET_PIN_INDEX(config->cs_pin), false);
+
+    if (command_seq->data_phase.seg_count == 0) {
+        stat = transfer_data(config, command_seq);
     } else {
-        stat = write(config, command_seq);
+        seg_seq = *command_seq;
+        seg_seq.data_phase.seg_count = 0;
+        for (uint8_t i = 0; i < command_seq->data_phase.seg_count; i++) {
+            seg_seq.data_phase.buf = command_seq->data_phase.segs[i].buf;
+            seg_seq.data_phase.len = command_seq->data_phase.segs[i].len;
+            if (seg_seq.data_phase.len != 0) {
+                stat = transfer_data(config, &seg_seq);
+                HPM_BREAK_IF(stat != status_success);
+                seg_seq.cmd_phase.cmd_mode = CHRY_SFLASH_CMDMODE_NONE;
+                seg_seq.addr_phase.addr_mode = CHRY_SFLASH_ADDRMODE_NONE;
+                seg_seq.dummy_phase.dummy_bytes = 0;
+            }
+        }
     }
+
+    gpio_write_pin(HPM_GPIO0, GPIO_GET_PORT_INDEX(config->cs_pin), GPIO_GET_PIN_INDEX(config->cs_pin), true);
     return stat;
 }
 
+/*
+ * Each host carries the hpm_spi_config_t of its SPI controller in
+ * host->user_data. A host without one gets the board's default bus from
+ * spi_host_init(), which only exists for spi_idx 0.
+ */
 hpm_spi_config_t spi_config;
 
 int chry_sflash_init(struct chry_sflash_host *host)
 {
-    spi_host_init(&spi_config);
+    /* one chip select and one set of data lines, no dual-flash */
+    if (host->dual_flash) {
+        return -CHRY_SFLASH_ERR_INVAL;
+    }
 
-    init(&spi_config);
+    if (host->user_data == NULL) {
+        if (host->spi_idx != 0) {
+            return -CHRY_SFLASH_ERR_INVAL;
+        }
+        spi_host_init(&spi_config);
+        host->user_data = &spi_config;
+    }
+
+    if (init(host->user_data) != status_success) {
+        return -CHRY_SFLASH_ERR_INVAL;
+    }
 
     return 0;
 }
 
 int chry_sflash_set_frequency(struct chry_sflash_host *host, uint32_t freq)
 {
-    hpm_spi_set_sclk_frequency(spi_config.host_base, freq);
+    hpm_spi_config_t *config = host->user_data;
+
+    hpm_spi_set_sclk_frequency(config->host_base, freq);
     return 0;
 }
 
 int chry_sflash_transfer(struct chry_sflash_host *host, struct chry_sflash_request *req)
 {
-    hpm_stat_t ret = transfer(&spi_config, req);
+    hpm_stat_t ret = transfer(host->user_data, req);
     if (ret == status_success)
         return 0;
     else
@@ -371,4 +639,89 @@ int chry_sflash_transfer(struct chry_sflash_host *host, struct chry_sflash_reque
 int chry_sflash_deinit(struct chry_sflash_host *host)
 {
     return 0;
-}
\ No newline at end of file
+}
+
+int chry_sflash_memory_map(struct chry_sflash_host *host, struct chry_sflash_request *req, void **addr)
+{
+    /* plain SPI controller, no XIP window */
+    return -1;
+}
+
+int chry_sflash_poll_status(struct chry_sflash_host *host, struct chry_sflash_request *req, uint8_t mask, uint8_t match, uint32_t timeout_ms)
+{
+    uint32_t start = chry_sflash_get_tick_ms(host);
+    uint8_t status = 0;
+    uint8_t *buf = req->data_phase.buf;
+    int ret;
+
+    /* no hardware status polling, read the register until it matches */
+    req->data_phase.buf = &status;
+    req->data_phase.len = 1;
+    while (1) {
+        ret = chry_sflash_transfer(host, req);
+        if (ret < 0) {
+            break;
+        }
+        if ((status & mask) == match) {
+            break;
+        }
+        if ((chry_sflash_get_tick_ms(host) - start) > timeout_ms) {
+            ret = -CHRY_SFLASH_ERR_TIMEOUT;
+            break;
+        }
+    }
+    req->data_phase.buf = buf;
+    if (buf) {
+        *buf = status;
+    }
+    return ret;
+}
+
+int chry_sflash_transfer_batch(struct chry_sflash_host *host, struct chry_sflash_request *reqs, uint32_t n, uint32_t flags)
+{
+    struct chry_sflash_request *req;
+    int ret = 0;
+
+    /* chip select has to rise between commands, so requests run one after another */
+    for (uint32_t i = 0; (i < n) && (ret == 0); i++) {
+        req = &reqs[i];
+        if (((i == 0) && (flags & CHRY_SFLASH_BATCH_POLL_FIRST)) || ((i == n - 1) && (flags & CHRY_SFLASH_BATCH_POLL_LAST))) {
+            ret = chry_sflash_poll_status(host, req, req->poll_phase.mask, req->poll_phase.match, req->poll_phase.timeout_ms);
+        } else {
+            ret = chry_sflash_transfer(host, req);
+        }
+    }
+    return ret;
+}
+
+/* bare metal, an RTOS build puts a recursive mutex per controller here */
+void chry_sflash_lock(struct chry_sflash_host *host)
+{
+}
+
+void chry_sflash_unlock(struct chry_sflash_host *host)
+{
+}
+
+uint32_t chry_sflash_get_tick_ms(struct chry_sflash_host *host)
+{
+    return (uint32_t)(hpm_csr_get_core_mcycle() / (clock_get_frequency(clock_cpu0) / 1000));
+}
+#ifdef CONFIG_CHRY_SFLASH_ASYNC
+/* no interrupt completion yet, queued transfers run synchronously in the submitter */
+int chry_sflash_async_start(struct chry_sflash_async_xfer *xfer)
+{
+    if (xfer->poll) {
+        return chry_sflash_poll_status(xfer->host, &xfer->req, xfer->mask, xfer->match, xfer->timeout_ms);
+    }
+    return chry_sflash_transfer(xfer->host, &xfer->req);
+}
+
+void chry_sflash_async_lock(struct chry_sflash_host *host)
+{
+}
+
+void chry_sflash_async_unlock(struct chry_sflash_host *host)
+{
+}
+#endif
@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2024, sakumisu
+ * Copyright (c) 2024, RCSN
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef CHRY_SFLASH_PORT_HPM_H
+#define CHRY_SFLASH_PORT_HPM_H
+
+#include "chry_sflash.h"
+#include "hpm_spi_drv.h"
+
+/*
+ * HPM SPI port. host->user_data points at the hpm_spi_config_t of the
+ * controller, the board's hpm_spi_config.h fills it in spi_host_init().
+ *
+ * By default the port busy-waits for the end of every DMA transaction.
+ * When irq is set, the SPI end-of-transfer interrupt completes it and
+ * the CPU waits in wait(), e.g. on a semaphore or event flag that
+ * signal() gives from the interrupt. Without wait() the port sleeps on
+ * WFI. The board routes the interrupt to chry_sflash_hpm_spi_isr(), see
+ * CONFIG_CHRY_SFLASH_HPM_IRQ in the sample board headers. wait_cycles
+ * counts the CPU cycles spent waiting, the part of a transfer the CPU
+ * had for other work.
+ *
+ * DMA buffers need no particular alignment or placement. A read goes to
+ * DMA in place for its cache line aligned middle, the unaligned ends
+ * pass through a small pool of cache line sized bounce buffers.
+ */
+
+typedef struct {
+    uint8_t rx_dma_ch;
+    uint8_t tx_dma_ch;
+    uint8_t rx_dma_req;
+    uint8_t tx_dma_req;
+    void *dma_base;
+    void *dmamux_base;
+} hpm_spi_dma_config_t;
+
+typedef struct {
+    hpm_spi_dma_config_t dma_control;
+    uint32_t transfer_max_size;
+    SPI_Type *host_base;
+    uint16_t cs_pin;
+    uint32_t irq;                                /* SPI interrupt, 0 busy-waits */
+    int (*wait)(void *arg, uint32_t timeout_ms); /* returns 0 once signal() was called */
+    void (*signal)(void *arg);
+    void *wait_arg;
+    volatile bool xfer_done;
+    uint64_t wait_cycles;
+} hpm_spi_config_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* call from the SPI interrupt of a controller with irq set */
+void chry_sflash_hpm_spi_isr(SPI_Type *spi_ptr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,887 @@
+/*
+ * Copyright (c) 2024, sakumisu
+ * Copyright (c) 2024, RCSN
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "chry_sflash_port_linux.h"
+
+#define NOR_PAGE_SIZE     (256U)
+#define NOR_MAX_SIZE      (16U * 1024U * 1024U)
+#define NOR_RESET_US      (30U)
+
+#define NOR_SR1_WIP       (1U << 0)
+#define NOR_SR1_WEL       (1U << 1)
+#define NOR_SR2_QE        (1U << 1)
+#define NOR_SR2_SUS       (1U << 7)
+
+#define NOR_SFDP_BFPT_PTR (0x80U)
+
+enum nor_op_type {
+    NOR_OP_READ = 0,
+    NOR_OP_READ_SFDP,
+    NOR_OP_READ_JEDECID,
+    NOR_OP_READ_SR,
+    NOR_OP_WRITE_SR,
+    NOR_OP_WRITE_ENABLE,
+    NOR_OP_WRITE_DISABLE,
+    NOR_OP_PAGE_PROGRAM,
+    NOR_OP_ERASE,
+    NOR_OP_CHIP_ERASE,
+    NOR_OP_ENTER_QPI,
+    NOR_OP_EXIT_QPI,
+    NOR_OP_RESET_ENABLE,
+    NOR_OP_RESET,
+    NOR_OP_SUSPEND,
+    NOR_OP_RESUME,
+};
+
+struct nor_op {
+    uint8_t cmd;
+    uint8_t type;
+    uint8_t addr_lines; /* 0: no address phase, 4 lines for every phase in QPI */
+    uint8_t data_lines; /* 0: no data phase */
+    uint8_t quad;       /* needs QE */
+    uint8_t arg;        /* status register index or erase size shift */
+    uint8_t dtr;        /* address and data on both edges, only legal with a DTR request */
+    uint8_t proto;      /* NOR_PROTO_SPI and/or NOR_PROTO_QPI */
+};
+
+#define NOR_PROTO_SPI (1U << 0)
+#define NOR_PROTO_QPI (1U << 1)
+#define NOR_PROTO_ALL (NOR_PROTO_SPI | NOR_PROTO_QPI)
+
+/* W25Q128JV command set, plus the DTR reads of the -IM/-JM parts and the QPI mode of the FV parts */
+static const struct nor_op nor_ops[] = {
+    { 0x03, NOR_OP_READ, 1, 1, 0, 0, 0, NOR_PROTO_SPI },
+    { 0x0B, NOR_OP_READ, 1, 1, 0, 0, 0, NOR_PROTO_ALL },
+    { 0x3B, NOR_OP_READ, 1, 2, 0, 0, 0, NOR_PROTO_SPI },
+    { 0xBB, NOR_OP_READ, 2, 2, 0, 0, 0, NOR_PROTO_SPI },
+    { 0x6B, NOR_OP_READ, 1, 4, 1, 0, 0, NOR_PROTO_SPI },
+    { 0xEB, NOR_OP_READ, 4, 4, 1, 0, 0, NOR_PROTO_ALL },
+    { 0x0D, NOR_OP_READ, 1, 1, 0, 0, 1, NOR_PROTO_SPI },
+    { 0xBD, NOR_OP_READ, 2, 2, 0, 0, 1, NOR_PROTO_SPI },
+    { 0xED, NOR_OP_READ, 4, 4, 1, 0, 1, NOR_PROTO_SPI },
+    { 0x5A, NOR_OP_READ_SFDP, 1, 1, 0, 0, 0, NOR_PROTO_SPI },
+    { 0x9F, NOR_OP_READ_JEDECID, 0, 1, 0, 0, 0, NOR_PROTO_ALL },
+    { 0x05, NOR_OP_READ_SR, 0, 1, 0, 0, 0, NOR_PROTO_ALL },
+    { 0x35, NOR_OP_READ_SR, 0, 1, 0, 1, 0, NOR_PROTO_ALL },
+    { 0x15, NOR_OP_READ_SR, 0, 1, 0, 2, 0, NOR_PROTO_ALL },
+    { 0x01, NOR_OP_WRITE_SR, 0, 1, 0, 0, 0, NOR_PROTO_ALL },
+    { 0x31, NOR_OP_WRITE_SR, 0, 1, 0, 1, 0, NOR_PROTO_ALL },
+    { 0x11, NOR_OP_WRITE_SR, 0, 1, 0, 2, 0, NOR_PROTO_ALL },
+    { 0x06, NOR_OP_WRITE_ENABLE, 0, 0, 0, 0, 0, NOR_PROTO_ALL },
+    { 0x04, NOR_OP_WRITE_DISABLE, 0, 0, 0, 0, 0, NOR_PROTO_ALL },
+    { 0x02, NOR_OP_PAGE_PROGRAM, 1, 1, 0, 0, 0, NOR_PROTO_ALL },
+    { 0x32, NOR_OP_PAGE_PROGRAM, 1, 4, 1, 0, 0, NOR_PROTO_SPI },
+    { 0x20, NOR_OP_ERASE, 1, 0, 0, 12, 0, NOR_PROTO_ALL },
+    { 0x52, NOR_OP_ERASE, 1, 0, 0, 15, 0, NOR_PROTO_ALL },
+    { 0xD8, NOR_OP_ERASE, 1, 0, 0, 16, 0, NOR_PROTO_ALL },
+    { 0x60, NOR_OP_CHIP_ERASE, 0, 0, 0, 0, 0, NOR_PROTO_ALL },
+    { 0xC7, NOR_OP_CHIP_ERASE, 0, 0, 0, 0, 0, NOR_PROTO_ALL },
+    { 0x38, NOR_OP_ENTER_QPI, 0, 0, 1, 0, 0, NOR_PROTO_SPI },
+    { 0xFF, NOR_OP_EXIT_QPI, 0, 0, 0, 0, 0, NOR_PROTO_QPI },
+    { 0x66, NOR_OP_RESET_ENABLE, 0, 0, 0, 0, 0, NOR_PROTO_ALL },
+    { 0x99, NOR_OP_RESET, 0, 0, 0, 0, 0, NOR_PROTO_ALL },
+    { 0x75, NOR_OP_SUSPEND, 0, 0, 0, 0, 0, NOR_PROTO_ALL },
+    { 0x7A, NOR_OP_RESUME, 0, 0, 0, 0, 0, NOR_PROTO_ALL },
+};
+
+/* SFDP of a W25Q128JV, JESD216 rev 1.5 with a 16 dword basic parameter table */
+static const uint8_t nor_sfdp_header[] = {
+    0x53, 0x46, 0x44, 0x50, 0x05, 0x01, 0x00, 0xFF,
+    0x00, 0x05, 0x01, 0x10, NOR_SFDP_BFPT_PTR, 0x00, 0x00, 0xFF
+};
+
+static const uint32_t nor_sfdp_bfpt[16] = {
+    0xFFF920E5, 0x07FFFFFF, 0x6B08EB44, 0xBB423B08,
+    0xFFFFFFFE, 0x0000FFFF, 0xEB40FFFF, 0x520F200C,
+    0x0000D810, 0x00A60236, 0xC914EA82, 0x337663E9,
+    0x757A757A, 0x5CD5A2F7, 0xFF4DF719, 0x80F830E9
+};
+
+/* typical times from the W25Q128JV datasheet */
+static const struct chry_sflash_linux_nor_timing nor_default_timing = {
+    .page_program_us = 400,
+    .sector_erase_us = 45000,
+    .block32_erase_us = 120000,
+    .block64_erase_us = 150000,
+    .chip_erase_us = 40000000,
+    .suspend_us = 20,
+    .suspend_interval_us = 512,
+    .write_status_us = 10000,
+    .xfer_overhead_ns = 500,
+    .chain_overhead_ns = 50,
+    .max_freq = 133000000,
+    .max_dtr_freq = 80000000,
+    .dtr_read_clocks = 8,
+};
+
+static const struct nor_op *nor_find_op(uint8_t cmd)
+{
+    for (uint32_t i = 0; i < sizeof(nor_ops) / sizeof(nor_ops[0]); i++) {
+        if (nor_ops[i].cmd == cmd) {
+            return &nor_ops[i];
+        }
+    }
+    return NULL;
+}
+
+static bool nor_is_busy(struct chry_sflash_linux_nor *nor)
+{
+    return nor->now_ns < nor->busy_until_ns;
+}
+
+static void nor_start_busy(struct chry_sflash_linux_nor *nor, uint32_t us, bool suspendable)
+{
+    nor->sr[0] &= ~NOR_SR1_WEL;
+    nor->busy_until_ns = nor->now_ns + (uint64_t)us * 1000U;
+    nor->busy_suspendable = suspendable;
+    nor->resume_ns = nor->now_ns;
+}
+
+static void nor_suspend(struct chry_sflash_linux_nor *nor)
+{
+    /* ignored when idle, already suspended or for an operation that cannot be */
+    if (!nor_is_busy(nor) || nor->suspended || !nor->busy_suspendable) {
+        return;
+    }
+    nor->suspended_left_ns = nor->busy_until_ns - nor->now_ns;
+    /* suspended again too soon after the resume, the operation made no progress */
+    if ((nor->now_ns - nor->resume_ns) < (uint64_t)nor->timing.suspend_interval_us * 1000U) {
+        nor->suspended_left_ns += nor->now_ns - nor->resume_ns;
+    }
+    nor->busy_until_ns = nor->now_ns + (uint64_t)nor->timing.suspend_us * 1000U;
+    nor->busy_suspendable = false;
+    nor->suspended = true;
+    nor->sr[1] |= NOR_SR2_SUS;
+    nor->stats.suspends++;
+}
+
+static void nor_resume(struct chry_sflash_linux_nor *nor)
+{
+    if (!nor->suspended) {
+        return;
+    }
+    nor->busy_until_ns = nor->now_ns + nor->suspended_left_ns;
+    nor->busy_suspendable = true;
+    nor->resume_ns = nor->now_ns;
+    nor->suspended = false;
+    nor->sr[1] &= ~NOR_SR2_SUS;
+}
+
+static void nor_account_bus(struct chry_sflash_linux_nor *nor, struct chry_sflash_request *req)
+{
+    uint64_t cycles = 0;
+    uint64_t edges = 0;
+    uint64_t ns;
+
+    /* count half cycles so DTR phases can move two bits per line per clock */
+    if (req->cmd_phase.cmd_mode) {
+        cycles += 8U / req->cmd_phase.cmd_mode;
+    }
+    if (req->addr_phase.addr_mode) {
+        edges += req->addr_phase.addr_size * 8U / req->addr_phase.addr_mode;
+    }
+    if (req->data_phase.data_mode) {
+        /* same convention as the hardware ports: dummy bytes on the data lines, dummy is clocks in DTR too */
+        cycles += req->dummy_phase.dummy_bytes * 8U / req->data_phase.data_mode;
+        edges += (uint64_t)req->data_phase.len * 8U / req->data_phase.data_mode;
+    }
+    cycles *= 2U;
+    edges *= req->dtr_enable ? 1U : 2U;
+
+    ns = (cycles + edges) * 1000000000ULL / (2ULL * nor->freq);
+    ns += nor->chained ? nor->timing.chain_overhead_ns : nor->timing.xfer_overhead_ns;
+    nor->now_ns += ns;
+    nor->stats.bus_ns += ns;
+    nor->stats.transfers++;
+}
+
+static int nor_check_phases(struct chry_sflash_linux_nor *nor, const struct nor_op *op, struct chry_sflash_request *req)
+{
+    uint8_t addr_lines = (nor->qpi && op->addr_lines) ? 4U : op->addr_lines;
+    uint8_t data_lines = (nor->qpi && op->data_lines) ? 4U : op->data_lines;
+
+    if (!(op->proto & (nor->qpi ? NOR_PROTO_QPI : NOR_PROTO_SPI))) {
+        return -1;
+    }
+    if (req->dtr_enable != (op->dtr != 0)) {
+        return -1;
+    }
+    if (op->dtr && (nor->freq > nor->timing.max_dtr_freq)) {
+        return -1;
+    }
+    if ((op->cmd == 0xED) && (req->dummy_phase.dummy_bytes * 8U / req->data_phase.data_mode != nor->timing.dtr_read_clocks)) {
+        return -1;
+    }
+    if (req->addr_phase.addr_mode != addr_lines) {
+        return -1;
+    }
+    if (addr_lines && (req->addr_phase.addr_size != CHRY_SFLASH_ADDRSIZE_24BITS)) {
+        return -1;
+    }
+    if ((req->data_phase.len != 0) && (req->data_phase.data_mode != data_lines)) {
+        return -1;
+    }
+    if ((data_lines == 0) && (req->data_phase.len != 0)) {
+        return -1;
+    }
+    if ((op->type == NOR_OP_READ) && (req->data_phase.direction != CHRY_SFLASH_DATA_READ)) {
+        return -1;
+    }
+    if ((op->type == NOR_OP_PAGE_PROGRAM) && (req->data_phase.direction != CHRY_SFLASH_DATA_WRITE)) {
+        return -1;
+    }
+    return 0;
+}
+
+static void nor_read_array(struct chry_sflash_linux_nor *nor, uint32_t addr, uint8_t *buf, uint32_t len)
+{
+    /* sequential reads wrap at the end of the array */
+    for (uint32_t i = 0; i < len; i++) {
+        buf[i] = nor->mem[(addr + i) & (nor->size - 1)];
+    }
+}
+
+static void nor_page_program(struct chry_sflash_linux_nor *nor, uint32_t addr, const uint8_t *buf, uint32_t len)
+{
+    uint32_t page = addr & ~(NOR_PAGE_SIZE - 1) & (nor->size - 1);
+    uint32_t start = 0;
+    bool conflict = false;
+
+    /* more than a page: only the last 256 bytes are kept, the address wraps in the page */
+    if (len > NOR_PAGE_SIZE) {
+        start = len - NOR_PAGE_SIZE;
+    }
+    for (uint32_t i = start; i < len; i++) {
+        uint8_t *cell = &nor->mem[page + ((addr + i) & (NOR_PAGE_SIZE - 1))];
+
+        if (buf[i] & ~*cell) {
+            conflict = true;
+        }
+        *cell &= buf[i];
+    }
+    if (conflict) {
+        nor->stats.program_conflicts++;
+    }
+    nor->stats.program_ops++;
+}
+
+static void nor_erase(struct chry_sflash_linux_nor *nor, uint32_t addr, uint32_t size)
+{
+    addr &= (nor->size - 1) & ~(size - 1);
+    memset(&nor->mem[addr], 0xFF, size);
+    nor->stats.erase_ops++;
+}
+
+static void nor_write_status(struct chry_sflash_linux_nor *nor, uint8_t index, const uint8_t *buf, uint32_t len)
+{
+    /* WIP and WEL are read only, 0x01 with two bytes also writes status register 2 */
+    for (uint32_t i = 0; (i < len) && ((index + i) < 3U); i++) {
+        if ((index + i) == 0U) {
+            nor->sr[0] = (nor->sr[0] & (NOR_SR1_WIP | NOR_SR1_WEL)) | (buf[i] & ~(NOR_SR1_WIP | NOR_SR1_WEL));
+        } else {
+            nor->sr[index + i] = buf[i];
+        }
+    }
+}
+
+static int nor_execute(struct chry_sflash_linux_nor *nor, struct chry_sflash_request *req)
+{
+    const struct nor_op *op;
+    uint8_t *buf = req->data_phase.buf;
+    uint32_t len = req->data_phase.len;
+    uint32_t addr = req->addr_phase.addr;
+    uint8_t jedec_id[3] = { 0xEF, 0x40, (uint8_t)__builtin_ctz(nor->size) };
+    uint32_t erase_us;
+    bool reset_enabled;
+
+    nor_account_bus(nor, req);
+
+    reset_enabled = nor->reset_enabled;
+    nor->reset_enabled = false;
+
+    /* an opcode clocked in the other protocol decodes as noise, the part does not respond */
+    if (req->cmd_phase.cmd_mode == (nor->qpi ? CHRY_SFLASH_CMDMODE_1LINES : CHRY_SFLASH_CMDMODE_4LINES)) {
+        nor->stats.ignored_mode++;
+        if (req->data_phase.direction == CHRY_SFLASH_DATA_READ) {
+            memset(buf, 0xFF, len);
+        }
+        return 0;
+    }
+    if (req->cmd_phase.cmd_mode != (nor->qpi ? CHRY_SFLASH_CMDMODE_4LINES : CHRY_SFLASH_CMDMODE_1LINES)) {
+        nor->stats.protocol_errors++;
+        return -CHRY_SFLASH_ERR_IO;
+    }
+
+    op = nor_find_op(req->cmd_phase.cmd);
+    if ((op == NULL) || (nor_check_phases(nor, op, req) < 0) || (op->quad && !(nor->sr[1] & NOR_SR2_QE))) {
+        nor->stats.protocol_errors++;
+        return -CHRY_SFLASH_ERR_IO;
+    }
+
+    /* while busy the part only answers status reads and suspends, the bus floats otherwise */
+    if (nor_is_busy(nor) && (op->type != NOR_OP_READ_SR) && (op->type != NOR_OP_SUSPEND)) {
+        nor->stats.ignored_busy++;
+        if (req->data_phase.direction == CHRY_SFLASH_DATA_READ) {
+            memset(buf, 0xFF, len);
+        }
+        return 0;
+    }
+
+    switch (op->type) {
+        case NOR_OP_READ:
+            nor_read_array(nor, addr, buf, len);
+            break;
+        case NOR_OP_READ_SFDP:
+            for (uint32_t i = 0; i < len; i++) {
+                buf[i] = ((addr + i) < sizeof(nor->sfdp)) ? nor->sfdp[addr + i] : 0xFF;
+            }
+            break;
+        case NOR_OP_READ_JEDECID:
+            for (uint32_t i = 0; i < len; i++) {
+                buf[i] = (i < sizeof(jedec_id)) ? jedec_id[i] : 0x00;
+            }
+            break;
+        case NOR_OP_READ_SR:
+            if (nor_is_busy(nor)) {
+                nor->stats.busy_polls++;
+            }
+            for (uint32_t i = 0; i < len; i++) {
+                buf[i] = nor->sr[op->arg] | ((op->arg == 0U) && nor_is_busy(nor) ? NOR_SR1_WIP : 0U);
+            }
+            break;
+        case NOR_OP_WRITE_ENABLE:
+            nor->sr[0] |= NOR_SR1_WEL;
+            break;
+        case NOR_OP_WRITE_DISABLE:
+            nor->sr[0] &= ~NOR_SR1_WEL;
+            break;
+        case NOR_OP_WRITE_SR:
+        case NOR_OP_PAGE_PROGRAM:
+        case NOR_OP_ERASE:
+        case NOR_OP_CHIP_ERASE:
+            /* reads only while an operation is suspended */
+            if (nor->suspended) {
+                nor->stats.ignored_busy++;
+                break;
+            }
+            if (!(nor->sr[0] & NOR_SR1_WEL)) {
+                nor->stats.ignored_wel++;
+                break;
+            }
+            if (op->type == NOR_OP_WRITE_SR) {
+                nor_write_status(nor, op->arg, buf, len);
+                nor_start_busy(nor, nor->timing.write_status_us, false);
+            } else if (op->type == NOR_OP_PAGE_PROGRAM) {
+                nor_page_program(nor, addr, buf, len);
+                nor_start_busy(nor, nor->timing.page_program_us, true);
+            } else if (op->type == NOR_OP_ERASE) {
+                nor_erase(nor, addr, 1UL << op->arg);
+                if (op->arg == 12) {
+                    erase_us = nor->timing.sector_erase_us;
+                } else if (op->arg == 15) {
+                    erase_us = nor->timing.block32_erase_us;
+                } else {
+                    erase_us = nor->timing.block64_erase_us;
+                }
+                nor_start_busy(nor, erase_us, true);
+            } else {
+                nor_erase(nor, 0, nor->size);
+                nor_start_busy(nor, nor->timing.chip_erase_us, false);
+            }
+            break;
+        case NOR_OP_ENTER_QPI:
+            nor->qpi = true;
+            break;
+        case NOR_OP_EXIT_QPI:
+            nor->qpi = false;
+            break;
+        case NOR_OP_RESET_ENABLE:
+            nor->reset_enabled = true;
+            break;
+        case NOR_OP_RESET:
+            if (reset_enabled) {
+                /* a suspended operation is abandoned, its area is left half done */
+                nor->suspended = false;
+                nor->sr[1] &= ~NOR_SR2_SUS;
+                nor->qpi = false;
+                nor->sr[0] &= ~NOR_SR1_WEL;
+                nor->busy_until_ns = nor->now_ns + NOR_RESET_US * 1000U;
+                nor->busy_suspendable = false;
+            }
+            break;
+        case NOR_OP_SUSPEND:
+            nor_suspend(nor);
+            break;
+        case NOR_OP_RESUME:
+            nor_resume(nor);
+            break;
+        default:
+            break;
+    }
+    return 0;
+}
+
+static int nor_execute_dual(struct chry_sflash_linux_nor *nor, struct chry_sflash_request *req)
+{
+    struct chry_sflash_linux_nor *bank[2] = { nor, nor->bank2 };
+    struct chry_sflash_request half = *req;
+    uint32_t len = req->data_phase.len / 2U;
+    uint8_t *buf = NULL;
+    int ret = 0;
+
+    /* the controller only moves byte pairs, data starts on the first part */
+    if ((nor->bank2 == NULL) || (req->data_phase.len & 1U) ||
+        ((req->data_phase.len != 0) && req->addr_phase.addr_mode && (req->addr_phase.addr & 1U))) {
+        nor->stats.protocol_errors++;
+        return -CHRY_SFLASH_ERR_IO;
+    }
+    if (len != 0) {
+        buf = malloc(len);
+        if (buf == NULL) {
+            return -CHRY_SFLASH_ERR_NOMEM;
+        }
+    }
+
+    half.addr_phase.addr = req->addr_phase.addr / 2U;
+    half.data_phase.buf = buf;
+    half.data_phase.len = len;
+    nor->bank2->now_ns = nor->now_ns;
+    for (uint32_t b = 0; (b < 2U) && (ret == 0); b++) {
+        if (req->data_phase.direction == CHRY_SFLASH_DATA_WRITE) {
+            for (uint32_t i = 0; i < len; i++) {
+                buf[i] = req->data_phase.buf[i * 2U + b];
+            }
+        }
+        ret = nor_execute(bank[b], &half);
+        if (req->data_phase.direction == CHRY_SFLASH_DATA_READ) {
+            for (uint32_t i = 0; i < len; i++) {
+                req->data_phase.buf[i * 2U + b] = buf[i];
+            }
+        }
+    }
+    /* both parts clock in parallel, the bus time was charged once to each */
+    nor->bank2->now_ns = nor->now_ns;
+
+    free(buf);
+    return ret;
+}
+
+static int nor_transfer_one(struct chry_sflash_host *host, struct chry_sflash_request *req)
+{
+    if (host->dual_flash) {
+        return nor_execute_dual(host->user_data, req);
+    }
+    return nor_execute(host->user_data, req);
+}
+
+static int nor_transfer(struct chry_sflash_host *host, struct chry_sflash_request *req)
+{
+    struct chry_sflash_request flat;
+    uint32_t len;
+    uint32_t offset;
+    int ret;
+
+    if (req->data_phase.seg_count == 0) {
+        return nor_transfer_one(host, req);
+    }
+
+    /* the model sees one transaction, segments are gathered and scattered around it */
+    len = chry_sflash_request_data_len(req);
+    flat = *req;
+    flat.data_phase.seg_count = 0;
+    flat.data_phase.segs = NULL;
+    flat.data_phase.len = len;
+    flat.data_phase.buf = malloc(len ? len : 1);
+    if (flat.data_phase.buf == NULL) {
+        return -CHRY_SFLASH_ERR_NOMEM;
+    }
+
+    offset = 0;
+    for (uint8_t i = 0; i < req->data_phase.seg_count; i++) {
+        if (req->data_phase.direction == CHRY_SFLASH_DATA_WRITE) {
+            memcpy(&flat.data_phase.buf[offset], req->data_phase.segs[i].buf, req->data_phase.segs[i].len);
+        }
+        offset += req->data_phase.segs[i].len;
+    }
+
+    ret = nor_transfer_one(host, &flat);
+
+    offset = 0;
+    for (uint8_t i = 0; (ret >= 0) && (i < req->data_phase.seg_count); i++) {
+        if (req->data_phase.direction == CHRY_SFLASH_DATA_READ) {
+            memcpy(req->data_phase.segs[i].buf, &flat.data_phase.buf[offset], req->data_phase.segs[i].len);
+        }
+        offset += req->data_phase.segs[i].len;
+    }
+
+    free(flat.data_phase.buf);
+    return ret;
+}
+
+int chry_sflash_linux_nor_open(struct chry_sflash_linux_nor *nor, const char *path, uint32_t size)
+{
+    struct stat st;
+    uint32_t old_size;
+    uint32_t density;
+
+    if ((size == 0) || (size & (size - 1)) || (size > NOR_MAX_SIZE)) {
+        return -CHRY_SFLASH_ERR_INVAL;
+    }
+
+    memset(nor, 0, sizeof(*nor));
+    nor->fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (nor->fd < 0) {
+        return -CHRY_SFLASH_ERR_IO;
+    }
+    if (fstat(nor->fd, &st) < 0) {
+        close(nor->fd);
+        return -CHRY_SFLASH_ERR_IO;
+    }
+    old_size = (st.st_size < size) ? (uint32_t)st.st_size : size;
+    if ((st.st_size != size) && (ftruncate(nor->fd, size) < 0)) {
+        close(nor->fd);
+        return -CHRY_SFLASH_ERR_IO;
+    }
+
+    nor->mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, nor->fd, 0);
+    if (nor->mem == MAP_FAILED) {
+        close(nor->fd);
+        return -CHRY_SFLASH_ERR_NOMEM;
+    }
+    /* new storage starts out erased */
+    memset(&nor->mem[old_size], 0xFF, size - old_size);
+
+    nor->size = size;
+    nor->timing = nor_default_timing;
+    nor->freq = 1000000;
+
+    /* W25Q128JV-IQ parts leave the factory with QE set */
+    nor->sr[1] = NOR_SR2_QE;
+
+    memset(nor->sfdp, 0xFF, sizeof(nor->sfdp));
+    memcpy(nor->sfdp, nor_sfdp_header, sizeof(nor_sfdp_header));
+    memcpy(&nor->sfdp[NOR_SFDP_BFPT_PTR], nor_sfdp_bfpt, sizeof(nor_sfdp_bfpt));
+    density = size * 8U - 1U;
+    memcpy(&nor->sfdp[NOR_SFDP_BFPT_PTR + 4], &density, sizeof(density));
+
+    pthread_mutex_init(&nor->bus_lock, NULL);
+    pthread_cond_init(&nor->bus_cond, NULL);
+#ifdef CONFIG_CHRY_SFLASH_ASYNC
+    pthread_mutex_init(&nor->worker_lock, NULL);
+    pthread_cond_init(&nor->worker_cond, NULL);
+#endif
+    return 0;
+}
+
+#ifdef CONFIG_CHRY_SFLASH_ASYNC
+/* there is one async queue for all hosts, so one lock */
+static pthread_mutex_t nor_async_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void *nor_async_worker(void *arg)
+{
+    struct chry_sflash_linux_nor *nor = arg;
+    struct chry_sflash_async_xfer *xfer;
+    int ret;
+
+    pthread_mutex_lock(&nor->worker_lock);
+    while (1) {
+        while ((nor->worker_xfer == NULL) && !nor->worker_stop) {
+            pthread_cond_wait(&nor->worker_cond, &nor->worker_lock);
+        }
+        xfer = nor->worker_xfer;
+        if (xfer == NULL) {
+            break;
+        }
+        nor->worker_xfer = NULL;
+        pthread_mutex_unlock(&nor->worker_lock);
+
+        /* blocking calls from other threads may share the model */
+        chry_sflash_lock(xfer->host);
+        if (xfer->poll) {
+            ret = chry_sflash_poll_status(xfer->host, &xfer->req, xfer->mask, xfer->match, xfer->timeout_ms);
+        } else {
+            ret = chry_sflash_transfer(xfer->host, &xfer->req);
+        }
+        chry_sflash_unlock(xfer->host);
+        /* may start the next entry, which hands it back to this thread */
+        chry_sflash_async_complete(xfer->host, ret);
+
+        pthread_mutex_lock(&nor->worker_lock);
+    }
+    pthread_mutex_unlock(&nor->worker_lock);
+    return NULL;
+}
+
+/* let the worker finish what is queued and join it */
+static void nor_async_stop(struct chry_sflash_linux_nor *nor)
+{
+    if (!nor->worker_running) {
+        return;
+    }
+    pthread_mutex_lock(&nor->worker_lock);
+    nor->worker_stop = true;
+    pthread_cond_signal(&nor->worker_cond);
+    pthread_mutex_unlock(&nor->worker_lock);
+    pthread_join(nor->worker, NULL);
+    nor->worker_running = false;
+}
+
+int chry_sflash_async_start(struct chry_sflash_async_xfer *xfer)
+{
+    struct chry_sflash_linux_nor *nor = xfer->host->user_data;
+
+    /* a longer one would not fit the DMA of the target either */
+    if (!nor->worker_running || (chry_sflash_request_data_len(&xfer->req) > CONFIG_CHRY_SFLASH_ASYNC_MAX_LEN)) {
+        return -CHRY_SFLASH_ERR_INVAL;
+    }
+    pthread_mutex_lock(&nor->worker_lock);
+    nor->worker_xfer = xfer;
+    pthread_cond_signal(&nor->worker_cond);
+    pthread_mutex_unlock(&nor->worker_lock);
+    return 1;
+}
+
+void chry_sflash_async_lock(struct chry_sflash_host *host)
+{
+    pthread_mutex_lock(&nor_async_lock);
+}
+
+void chry_sflash_async_unlock(struct chry_sflash_host *host)
+{
+    pthread_mutex_unlock(&nor_async_lock);
+}
+#endif
+
+void chry_sflash_linux_nor_close(struct chry_sflash_linux_nor *nor)
+{
+#ifdef CONFIG_CHRY_SFLASH_ASYNC
+    nor_async_stop(nor);
+#endif
+    if (nor->mem != NULL) {
+        munmap(nor->mem, nor->size);
+        nor->mem = NULL;
+    }
+    if (nor->fd >= 0) {
+        close(nor->fd);
+        nor->fd = -1;
+    }
+}
+
+void chry_sflash_linux_nor_delay_us(struct chry_sflash_linux_nor *nor, uint32_t us)
+{
+    nor->now_ns += (uint64_t)us * 1000U;
+}
+
+uint64_t chry_sflash_linux_nor_time_ns(struct chry_sflash_linux_nor *nor)
+{
+    return nor->now_ns;
+}
+
+void chry_sflash_linux_nor_set_dtr_read(struct chry_sflash_linux_nor *nor, uint8_t mode_clocks, uint8_t dummy_clocks)
+{
+    uint32_t dword;
+
+    /* dwords 17 to 22 describe octal and 4S-4D-4D modes this part does not have */
+    memset(&nor->sfdp[NOR_SFDP_BFPT_PTR + sizeof(nor_sfdp_bfpt)], 0, 6 * sizeof(uint32_t));
+    /* dword 21: 1S-4D-4D fast read supported, dword 23: its opcode and clocks */
+    dword = 1U << 2;
+    memcpy(&nor->sfdp[NOR_SFDP_BFPT_PTR + 20 * sizeof(uint32_t)], &dword, sizeof(dword));
+    dword = (0xEDU << 8) | ((mode_clocks & 0x07U) << 5) | (dummy_clocks & 0x1FU);
+    memcpy(&nor->sfdp[NOR_SFDP_BFPT_PTR + 22 * sizeof(uint32_t)], &dword, sizeof(dword));
+    /* parameter header length in dwords */
+    nor->sfdp[11] = 23;
+    nor->timing.dtr_read_clocks = mode_clocks + dummy_clocks;
+}
+
+int chry_sflash_init(struct chry_sflash_host *host)
+{
+    struct chry_sflash_linux_nor *nor = host->user_data;
+    struct chry_sflash_request command_seq = { 0 };
+    int ret;
+
+    if ((nor == NULL) || (nor->mem == NULL)) {
+        return -CHRY_SFLASH_ERR_INVAL;
+    }
+
+    /* same sequence as the hardware ports: 4 lines for a part left in QPI, then SPI */
+    command_seq.cmd_phase.cmd_mode = CHRY_SFLASH_CMDMODE_4LINES;
+    for (uint32_t i = 0; i < 2; i++) {
+        command_seq.cmd_phase.cmd = 0x66; // Enable Reset
+        ret = nor_transfer(host, &command_seq);
+        if (ret < 0) {
+            return ret;
+        }
+        command_seq.cmd_phase.cmd = 0x99; // Execute Reset
+        ret = nor_transfer(host, &command_seq);
+        if (ret < 0) {
+            return ret;
+        }
+        command_seq.cmd_phase.cmd_mode = CHRY_SFLASH_CMDMODE_1LINES;
+    }
+
+    /* tRST, the part ignores commands until the reset is done */
+    chry_sflash_linux_nor_delay_us(nor, NOR_RESET_US);
+
+#ifdef CONFIG_CHRY_SFLASH_ASYNC
+    if (!nor->worker_running) {
+        nor->worker_stop = false;
+        if (pthread_create(&nor->worker, NULL, nor_async_worker, nor) != 0) {
+            return -CHRY_SFLASH_ERR_NOMEM;
+        }
+        nor->worker_running = true;
+    }
+#endif
+    return 0;
+}
+
+int chry_sflash_deinit(struct chry_sflash_host *host)
+{
+#ifdef CONFIG_CHRY_SFLASH_ASYNC
+    nor_async_stop(host->user_data);
+#endif
+    return 0;
+}
+
+int chry_sflash_set_frequency(struct chry_sflash_host *host, uint32_t freq)
+{
+    struct chry_sflash_linux_nor *nor = host->user_data;
+
+    if (freq == 0) {
+        return -CHRY_SFLASH_ERR_INVAL;
+    }
+    nor->freq = (freq > nor->timing.max_freq) ? nor->timing.max_freq : freq;
+    if (host->dual_flash && (nor->bank2 != NULL)) {
+        nor->bank2->freq = nor->freq;
+    }
+    return 0;
+}
+
+int chry_sflash_transfer(struct chry_sflash_host *host, struct chry_sflash_request *req)
+{
+    return nor_transfer(host, req);
+}
+
+int chry_sflash_memory_map(struct chry_sflash_host *host, struct chry_sflash_request *req, void **addr)
+{
+    /* reads go through transfer so they are accounted on the bus */
+    return -1;
+}
+
+int chry_sflash_poll_status(struct chry_sflash_host *host, struct chry_sflash_request *req, uint8_t mask, uint8_t match, uint32_t timeout_ms)
+{
+    uint32_t start = chry_sflash_get_tick_ms(host);
+    uint8_t status[2] = { 0 };
+    uint8_t *buf = req->data_phase.buf;
+    int ret;
+
+    /* no hardware status polling, read the register until it matches, in dual-flash on both parts */
+    req->data_phase.buf = status;
+    req->data_phase.len = host->dual_flash ? 2 : 1;
+    while (1) {
+        ret = chry_sflash_transfer(host, req);
+        if (ret < 0) {
+            break;
+        }
+        if (((status[0] & mask) == match) && (!host->dual_flash || ((status[1] & mask) == match))) {
+            break;
+        }
+        if ((chry_sflash_get_tick_ms(host) - start) > timeout_ms) {
+            ret = -CHRY_SFLASH_ERR_TIMEOUT;
+            break;
+        }
+    }
+    req->data_phase.buf = buf;
+    req->data_phase.len = 1;
+    if (buf) {
+        *buf = status[0];
+    }
+    return ret;
+}
+
+int chry_sflash_transfer_batch(struct chry_sflash_host *host, struct chry_sflash_request *reqs, uint32_t n, uint32_t flags)
+{
+    struct chry_sflash_linux_nor *nor = host->user_data;
+    struct chry_sflash_request *req;
+    int ret = 0;
+
+    /* only the first transfer pays the controller setup, the rest follow it like a descriptor chain */
+    nor->stats.batches++;
+    for (uint32_t i = 0; (i < n) && (ret >= 0); i++) {
+        req = &reqs[i];
+        if (((i == 0) && (flags & CHRY_SFLASH_BATCH_POLL_FIRST)) || ((i == n - 1) && (flags & CHRY_SFLASH_BATCH_POLL_LAST))) {
+            ret = chry_sflash_poll_status(host, req, req->poll_phase.mask, req->poll_phase.match, req->poll_phase.timeout_ms);
+        } else {
+            ret = chry_sflash_transfer(host, req);
+        }
+        nor->chained = true;
+        if (nor->bank2 != NULL) {
+            nor->bank2->chained = true;
+        }
+    }
+    nor->chained = false;
+    if (nor->bank2 != NULL) {
+        nor->bank2->chained = false;
+    }
+    return ret;
+}
+
+/* recursive ticket lock, the bus goes to the waiting threads in the order they asked */
+void chry_sflash_lock(struct chry_sflash_host *host)
+{
+    struct chry_sflash_linux_nor *nor = host->user_data;
+    uint32_t ticket;
+
+    pthread_mutex_lock(&nor->bus_lock);
+    if ((nor->bus_depth != 0) && pthread_equal(nor->bus_owner, pthread_self())) {
+        nor->bus_depth++;
+    } else {
+        ticket = nor->bus_next++;
+        if (ticket != nor->bus_serving) {
+            nor->bus_shared = true;
+        }
+        while (ticket != nor->bus_serving) {
+            pthread_cond_wait(&nor->bus_cond, &nor->bus_lock);
+        }
+        nor->bus_owner = pthread_self();
+        nor->bus_depth = 1;
+    }
+    pthread_mutex_unlock(&nor->bus_lock);
+}
+
+void chry_sflash_unlock(struct chry_sflash_host *host)
+{
+    struct chry_sflash_linux_nor *nor = host->user_data;
+    bool yield = false;
+
+    pthread_mutex_lock(&nor->bus_lock);
+    if (--nor->bus_depth == 0) {
+        nor->bus_serving++;
+        pthread_cond_broadcast(&nor->bus_cond);
+        yield = nor->bus_shared;
+    }
+    pthread_mutex_unlock(&nor->bus_lock);
+    /*
+     * A thread that is about to ask for the bus, but was preempted before it
+     * took its ticket, gets in line before this one asks again. Only once the
+     * bus turned out shared, a single thread keeps going at full speed.
+     */
+    if (yield) {
+        sched_yield();
+    }
+}
+
+uint32_t chry_sflash_get_tick_ms(struct chry_sflash_host *host)
+{
+    struct chry_sflash_linux_nor *nor = host->user_data;
+
+    return (uint32_t)(nor->now_ns / 1000000U);
+}
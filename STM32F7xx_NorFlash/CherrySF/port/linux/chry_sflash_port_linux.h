@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2024, sakumisu
+ * Copyright (c) 2024, RCSN
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef CHRY_SFLASH_PORT_LINUX_H
+#define CHRY_SFLASH_PORT_LINUX_H
+
+#include <pthread.h>
+#include "chry_sflash.h"
+
+/*
+ * Linux host port. There is no bus, chry_sflash_transfer() hands every
+ * request to an in-process SPI NOR model that behaves like a W25Q128JV:
+ * it serves the part's SFDP tables, can be switched to QPI (38h/FFh),
+ * keeps its array in an mmap'd file and only ever clears bits on
+ * program. Erase and program can be suspended (75h/7Ah). Time is virtual, every transfer is
+ * charged its bus cycles at the current frequency and program/erase keep
+ * the part busy for their typical datasheet time, so the cost of command
+ * sequences can be compared offline. chry_sflash_get_tick_ms() returns
+ * the virtual time.
+ *
+ * Point host->user_data at an opened struct chry_sflash_linux_nor before
+ * calling chry_sflash_init(). For host->dual_flash also open a second
+ * model and set bank2 on the first: like the STM32 QUADSPI, even bytes go
+ * to the first part and odd bytes to the second, each at half the
+ * address. The second part runs on the first one's clock.
+ *
+ * Every model has its own recursive bus lock behind chry_sflash_lock(),
+ * hosts on different models can be used from different threads at once.
+ * The lock is handed out in arrival order, a thread waiting for it gets
+ * the bus before the holder can take it again, as a reader of higher
+ * priority would from an RTOS mutex.
+ *
+ * With CONFIG_CHRY_SFLASH_ASYNC chry_sflash_init() starts a worker thread
+ * that runs queued transfers and signals their completion, the way an
+ * interrupt does on target. chry_sflash_deinit() drains and joins it.
+ */
+
+#define CHRY_SFLASH_LINUX_NOR_SFDP_SIZE (0x100U)
+
+struct chry_sflash_linux_nor_timing {
+    uint32_t page_program_us;
+    uint32_t sector_erase_us;  /* 4 KB  */
+    uint32_t block32_erase_us; /* 32 KB */
+    uint32_t block64_erase_us; /* 64 KB */
+    uint32_t chip_erase_us;
+    uint32_t suspend_us;         /* suspend until ready */
+    uint32_t suspend_interval_us; /* from a resume, a sooner suspend loses the progress made since */
+    uint32_t write_status_us;
+    uint32_t xfer_overhead_ns; /* controller setup and CS deselect per transfer */
+    uint32_t chain_overhead_ns; /* CS deselect only, for requests chained in a batch */
+    uint32_t max_freq;
+    uint32_t max_dtr_freq;     /* DTR reads above this are protocol errors */
+    uint32_t dtr_read_clocks;  /* mode and dummy clocks of the EDh read, any other count is a protocol error */
+};
+
+struct chry_sflash_linux_nor_stats {
+    uint64_t transfers;
+    uint64_t batches;
+    uint64_t bus_ns;            /* time spent clocking the bus */
+    uint64_t busy_polls;        /* status reads that saw WIP set */
+    uint64_t program_ops;
+    uint64_t erase_ops;
+    uint64_t suspends;
+    uint64_t ignored_busy;      /* commands dropped because WIP was set or program/erase while suspended */
+    uint64_t ignored_wel;       /* program/erase/write status without WREN */
+    uint64_t program_conflicts; /* page programs that tried to set a 0 bit */
+    uint64_t ignored_mode;      /* SPI opcode sent in QPI mode or the other way round */
+    uint64_t protocol_errors;   /* wrong lines, address size, DTR or unknown opcode */
+};
+
+struct chry_sflash_linux_nor {
+    int fd;
+    uint8_t *mem;
+    uint32_t size;
+    uint8_t sfdp[CHRY_SFLASH_LINUX_NOR_SFDP_SIZE];
+    uint8_t sr[3];
+    bool reset_enabled;
+    bool qpi;
+    bool chained;                        /* inside a batch, after its first transfer */
+    uint32_t freq;
+    uint64_t now_ns;
+    uint64_t busy_until_ns;
+    bool busy_suspendable;               /* erase or page program, not chip erase or status write */
+    bool suspended;
+    uint64_t suspended_left_ns;          /* of the suspended operation */
+    uint64_t resume_ns;
+    struct chry_sflash_linux_nor_timing timing;
+    struct chry_sflash_linux_nor_stats stats;
+    struct chry_sflash_linux_nor *bank2; /* dual-flash partner, NULL otherwise */
+    pthread_mutex_t bus_lock;            /* guards the fields below, the bus itself is the ticket */
+    pthread_cond_t bus_cond;
+    pthread_t bus_owner;
+    uint32_t bus_depth;
+    uint32_t bus_next;
+    uint32_t bus_serving;
+    bool bus_shared;                     /* some thread had to wait for the bus */
+#ifdef CONFIG_CHRY_SFLASH_ASYNC
+    pthread_mutex_t worker_lock;
+    pthread_cond_t worker_cond;
+    pthread_t worker;
+    struct chry_sflash_async_xfer *worker_xfer;
+    bool worker_running;
+    bool worker_stop;
+#endif
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* size is a power of two up to 16 MB, a new or resized file reads as erased */
+int chry_sflash_linux_nor_open(struct chry_sflash_linux_nor *nor, const char *path, uint32_t size);
+void chry_sflash_linux_nor_close(struct chry_sflash_linux_nor *nor);
+/* let virtual time pass, e.g. for work the host does between transfers */
+void chry_sflash_linux_nor_delay_us(struct chry_sflash_linux_nor *nor, uint32_t us);
+uint64_t chry_sflash_linux_nor_time_ns(struct chry_sflash_linux_nor *nor);
+/* publish a JESD216F basic parameter table that describes the EDh read, after open and before chry_sflash_init */
+void chry_sflash_linux_nor_set_dtr_read(struct chry_sflash_linux_nor *nor, uint8_t mode_clocks, uint8_t dummy_clocks);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
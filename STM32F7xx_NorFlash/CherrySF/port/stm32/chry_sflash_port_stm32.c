@@ -4,14 +4,31 @@
  *
  * SPDX-License-Identifier: Apache-2.0
  */
-#include "chry_sflash.h"
+#include "chry_sflash_port_stm32.h"
 #include "qspi.h"
 
+/* Short transfers such as status reads stay on the polled FIFO path */
+#define QSPI_DMA_MIN_LEN 32
+/* Clock cycles between two status reads in auto-polling mode */
+#define QSPI_POLL_INTERVAL 0x20
+/* Segments of one scatter-gather data phase */
+#define QSPI_MAX_SEGS 8
 
+/* Hosts sharing the QUADSPI, spi_idx selects BK1 or BK2 */
+#define QSPI_MAX_HOSTS 2
 
-void QSPI_SendCmd(uint32_t cmd,uint32_t cmdMode,uint32_t addr,uint32_t addrMode,uint32_t addrSize,uint32_t dataMode, uint32_t dummyCycles)
-{      
-	u8 DataMode,AddressSize,AddressMode,InstructionMode,dmcycle;
+static uint32_t tick_last_cycle;
+static uint32_t tick_cycle_acc;
+static uint32_t tick_ms;
+
+/* clock of each bank */
+static u32 qspi_host_freq[QSPI_MAX_HOSTS];
+/* host the controller is set up for */
+static struct chry_sflash_host *qspi_owner;
+
+static u16 QSPI_CmdMode(uint32_t cmdMode,uint32_t addrMode,uint32_t addrSize,uint32_t dataMode,bool dtr)
+{
+	u8 DataMode,AddressSize,AddressMode,InstructionMode;
 	
 	if(cmdMode == CHRY_SFLASH_CMDMODE_NONE){
 		InstructionMode = 0;
@@ -52,40 +69,117 @@ void QSPI_SendCmd(uint32_t cmd,uint32_t cmdMode,uint32_t addr,uint32_t addrMode,
         DataMode        = 3;   
 	}
 	
+	return ((dtr ? 1 : 0) << 8) | (DataMode << 6) | ((AddressSize) << 4) | (AddressMode << 2) | (InstructionMode << 0);
+}
+
+/* returns QSPI_Send_CMD's status, nonzero when the command never went out */
+u8 QSPI_SendCmd(uint32_t cmd,uint32_t cmdMode,uint32_t addr,uint32_t addrMode,uint32_t addrSize,uint32_t dataMode, uint32_t dummyCycles, bool dtr)
+{      
+	u8 dmcycle;
+	
 	dmcycle = dummyCycles * 8 / dataMode;
-	u8 mode = (DataMode << 6) | ((AddressSize) << 4) | (AddressMode << 2) | (InstructionMode << 0);
-    QSPI_Send_CMD(cmd,addr, mode,dmcycle);
- 
+	u16 mode = QSPI_CmdMode(cmdMode, addrMode, addrSize, dataMode, dtr);
+	return QSPI_Send_CMD(cmd,addr, mode,dmcycle);
 }
 
-int chry_sflash_init(struct chry_sflash_host *host)
+/* the banks share one controller, bring FSEL, DFM and the clock over to this host */
+static int chry_sflash_select(struct chry_sflash_host *host)
 {
-    QSPI_SendCmd(0x66, CHRY_SFLASH_CMDMODE_4LINES, 0, 0, 0, 0, 0);  // Enable Reset
-    QSPI_SendCmd(0x99, CHRY_SFLASH_CMDMODE_4LINES, 0, 0, 0, 0, 0);  // Execute Reset
+    if (qspi_owner == host) {
+        return 0;
+    }
+    /* BK2 on PE7~10 shares clock and chip select with BK1 in dual-flash mode */
+    if (QSPI_Set_Dual(host->dual_flash ? 1 : 0) != 0) {
+        return -CHRY_SFLASH_ERR_IO;
+    }
+    if (QSPI_Set_Flash(host->spi_idx) != 0) {
+        return -CHRY_SFLASH_ERR_IO;
+    }
+    if (!QSPI_Set_Speed(qspi_host_freq[host->spi_idx])) {
+        return -CHRY_SFLASH_ERR_IO;
+    }
+    qspi_owner = host;
     return 0;
 }
 
-int chry_sflash_set_frequency(struct chry_sflash_host *host, uint32_t freq)
+int chry_sflash_init(struct chry_sflash_host *host)
 {
+    u8 stat = 0;
 
-    return 0;
+    if ((host->spi_idx >= QSPI_MAX_HOSTS) || (host->dual_flash && (host->spi_idx != 0))) {
+        return -CHRY_SFLASH_ERR_INVAL;
+    }
+
+    /* SFDP is read at the clock QSPI_Init() starts with */
+    qspi_owner = NULL;
+    qspi_host_freq[host->spi_idx] = QSPI_INIT_SPEED;
+    if (chry_sflash_select(host) != 0) {
+        return -CHRY_SFLASH_ERR_IO;
+    }
+
+    /* reset on 4 lines first in case a previous session left the part in QPI */
+    stat |= QSPI_SendCmd(0x66, CHRY_SFLASH_CMDMODE_4LINES, 0, 0, 0, 0, 0, false);  // Enable Reset
+    stat |= QSPI_SendCmd(0x99, CHRY_SFLASH_CMDMODE_4LINES, 0, 0, 0, 0, 0, false);  // Execute Reset
+    stat |= QSPI_SendCmd(0x66, CHRY_SFLASH_CMDMODE_1LINES, 0, 0, 0, 0, 0, false);  // Enable Reset
+    stat |= QSPI_SendCmd(0x99, CHRY_SFLASH_CMDMODE_1LINES, 0, 0, 0, 0, 0, false);  // Execute Reset
+    return stat ? -CHRY_SFLASH_ERR_IO : 0;
+}
+
+int chry_sflash_set_frequency(struct chry_sflash_host *host, uint32_t freq)
+{
+    /* the prescaler rounds down to the nearest HCLK/n, capped at QSPI_MAX_SPEED */
+    if (freq == 0) {
+        return -CHRY_SFLASH_ERR_INVAL;
+    }
+    qspi_host_freq[host->spi_idx] = freq;
+    if (qspi_owner != host) {
+        return chry_sflash_select(host);
+    }
+    return QSPI_Set_Speed(freq) ? 0 : -CHRY_SFLASH_ERR_IO;
 }
 
 int chry_sflash_transfer(struct chry_sflash_host *host, struct chry_sflash_request *req)
 {
-    int stat = 0;
-    if (req->data_phase.direction == CHRY_SFLASH_DATA_READ) {
-		QSPI_SendCmd(req->cmd_phase.cmd,req->cmd_phase.cmd_mode,req->addr_phase.addr,req->addr_phase.addr_mode,req->addr_phase.addr_size,req->data_phase.data_mode,req->dummy_phase.dummy_bytes);
-		if(req->data_phase.buf != NULL && req->data_phase.len != 0){
-			QSPI_Receive(req->data_phase.buf,req->data_phase.len);
-		}
-	} else {
-		QSPI_SendCmd(req->cmd_phase.cmd,req->cmd_phase.cmd_mode,req->addr_phase.addr,req->addr_phase.addr_mode,req->addr_phase.addr_size,req->data_phase.data_mode,req->dummy_phase.dummy_bytes);
-		if(req->data_phase.buf != NULL && req->data_phase.len != 0){
-		    QSPI_Transmit(req->data_phase.buf,req->data_phase.len);
-		}
+    u8 stat = 0;
+    u8 *seg_buf[QSPI_MAX_SEGS];
+    u32 seg_len[QSPI_MAX_SEGS];
+    u8 seg_count = 1;
+    u32 len = chry_sflash_request_data_len(req);
+    bool dma = req->dma_enable && (len >= QSPI_DMA_MIN_LEN);
+
+    /* a segment list becomes one data phase, DMA is re-armed per segment while the controller holds the clock */
+    if (req->data_phase.seg_count != 0) {
+        if (req->data_phase.seg_count > QSPI_MAX_SEGS) {
+            return -CHRY_SFLASH_ERR_INVAL;
+        }
+        seg_count = req->data_phase.seg_count;
+        for (u8 i = 0; i < seg_count; i++) {
+            seg_buf[i] = req->data_phase.segs[i].buf;
+            seg_len[i] = req->data_phase.segs[i].len;
+        }
+    } else {
+        seg_buf[0] = req->data_phase.buf;
+        seg_len[0] = req->data_phase.len;
+        if (seg_buf[0] == NULL) {
+            len = 0;
+        }
     }
-    return stat;
+    if (chry_sflash_select(host) != 0) {
+        return -CHRY_SFLASH_ERR_IO;
+    }
+
+	/* the data phase would run on the previous command's CCR and AR */
+	if(QSPI_SendCmd(req->cmd_phase.cmd,req->cmd_phase.cmd_mode,req->addr_phase.addr,req->addr_phase.addr_mode,req->addr_phase.addr_size,req->data_phase.data_mode,req->dummy_phase.dummy_bytes,req->dtr_enable)){
+		return -CHRY_SFLASH_ERR_IO;
+	}
+	if(len != 0){
+		if (req->data_phase.direction == CHRY_SFLASH_DATA_READ) {
+			stat = dma ? QSPI_Receive_DMA_Seg(seg_buf,seg_len,seg_count) : QSPI_Receive_Seg(seg_buf,seg_len,seg_count);
+		} else {
+			stat = dma ? QSPI_Transmit_DMA_Seg(seg_buf,seg_len,seg_count) : QSPI_Transmit_Seg(seg_buf,seg_len,seg_count);
+		}
+	}
+    return stat ? -CHRY_SFLASH_ERR_IO : 0;
 }
 
 int chry_sflash_deinit(struct chry_sflash_host *host)
@@ -93,24 +187,243 @@ int chry_sflash_deinit(struct chry_sflash_host *host)
     return 0;
 }
 
+int chry_sflash_memory_map(struct chry_sflash_host *host, struct chry_sflash_request *req, void **addr)
+{
+	u16 mode = QSPI_CmdMode(req->cmd_phase.cmd_mode, req->addr_phase.addr_mode, req->addr_phase.addr_size, req->data_phase.data_mode, req->dtr_enable);
+	u8 dmcycle = req->dummy_phase.dummy_bytes * 8 / req->data_phase.data_mode;
 
+	if (chry_sflash_select(host) != 0) {
+		return -CHRY_SFLASH_ERR_IO;
+	}
+	if (QSPI_MemoryMapped(req->cmd_phase.cmd, mode, dmcycle) != 0) {
+		return -CHRY_SFLASH_ERR_IO;
+	}
+	*addr = (void *)QSPI_BASE;
+	return 0;
+}
 
+int chry_sflash_poll_status(struct chry_sflash_host *host, struct chry_sflash_request *req, uint8_t mask, uint8_t match, uint32_t timeout_ms)
+{
+	uint32_t start = chry_sflash_get_tick_ms(host);
+	u16 mode = QSPI_CmdMode(req->cmd_phase.cmd_mode, req->addr_phase.addr_mode, req->addr_phase.addr_size, req->data_phase.data_mode, false);
 
+	if (chry_sflash_select(host) != 0) {
+		return -CHRY_SFLASH_ERR_IO;
+	}
+	/* the controller reads the status register itself and stops on match */
+	if (QSPI_AutoPolling_Start(req->cmd_phase.cmd, req->addr_phase.addr, mode, mask, match, QSPI_POLL_INTERVAL) != 0) {
+		return -CHRY_SFLASH_ERR_IO;
+	}
+	while (QSPI_AutoPolling_Done(req->data_phase.buf) != 0) {
+		if ((chry_sflash_get_tick_ms(host) - start) > timeout_ms) {
+			QSPI_AutoPolling_Stop();
+			return -CHRY_SFLASH_ERR_TIMEOUT;
+		}
+	}
+	return 0;
+}
 
+int chry_sflash_transfer_batch(struct chry_sflash_host *host, struct chry_sflash_request *reqs, uint32_t n, uint32_t flags)
+{
+    struct chry_sflash_request *req;
+    int ret = 0;
 
+    /* each request is one CCR write after the previous one has finished, polls use the auto-polling mode */
+    for (uint32_t i = 0; (i < n) && (ret == 0); i++) {
+        req = &reqs[i];
+        if (((i == 0) && (flags & CHRY_SFLASH_BATCH_POLL_FIRST)) || ((i == n - 1) && (flags & CHRY_SFLASH_BATCH_POLL_LAST))) {
+            ret = chry_sflash_poll_status(host, req, req->poll_phase.mask, req->poll_phase.match, req->poll_phase.timeout_ms);
+        } else {
+            ret = chry_sflash_transfer(host, req);
+        }
+    }
+    return ret;
+}
 
+/* bare metal, an RTOS build puts a recursive mutex for the QUADSPI here */
+void chry_sflash_lock(struct chry_sflash_host *host)
+{
+}
 
+void chry_sflash_unlock(struct chry_sflash_host *host)
+{
+}
 
+uint32_t chry_sflash_get_tick_ms(struct chry_sflash_host *host)
+{
+    uint32_t now;
+    uint32_t ms;
+    uint32_t cycles_per_ms = SystemCoreClock / 1000;
+    uint32_t primask = __get_PRIMASK();
 
+    /* the async poll timeout reads it from the application's tick too */
+    __disable_irq();
+    /* DWT cycle counter is the timebase, enable it on first use */
+    if (!(DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk)) {
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+        tick_last_cycle = DWT->CYCCNT;
+    }
+    now = DWT->CYCCNT;
 
+    /* accumulate deltas so the counter survives CYCCNT wrap-around */
+    tick_cycle_acc += now - tick_last_cycle;
+    tick_last_cycle = now;
+    tick_ms += tick_cycle_acc / cycles_per_ms;
+    tick_cycle_acc %= cycles_per_ms;
+    ms = tick_ms;
+    __set_PRIMASK(primask);
 
+    return ms;
+}
 
+#ifdef CONFIG_CHRY_SFLASH_ASYNC
+/*
+ * DMA reads complete in the DMA2 stream 7 interrupt, DMA writes, commands
+ * without data and status polls in the QUADSPI interrupt. The CPU reads
+ * the partial cache lines at both ends of a DMA read, less than a line
+ * each. Segment lists, requests without dma_enable and reads without a
+ * whole cache line still run on the blocking path and return their
+ * result directly. The hardware poll has no timeout, the
+ * application's tick calls chry_sflash_async_tick() and that stops a poll
+ * once timeout_ms is up.
+ */
+static struct chry_sflash_async_xfer *async_xfer;
+static uint32_t async_primask;
+static uint32_t async_poll_start;
 
+/* DMA only writes whole cache lines, see QSPI_Receive_DMA_IT() */
+static bool chry_sflash_async_dma_read(const uint8_t *buf, uint32_t len)
+{
+    uint32_t head = (QSPI_DMA_LINE - ((uintptr_t)buf & (QSPI_DMA_LINE - 1))) & (QSPI_DMA_LINE - 1);
 
+    return len >= head + QSPI_DMA_LINE;
+}
 
+static void chry_sflash_async_irq_done(u8 status)
+{
+    struct chry_sflash_async_xfer *xfer;
+    uint32_t primask = __get_PRIMASK();
 
+    /* a poll the tick has timed out meanwhile is already completed */
+    __disable_irq();
+    xfer = async_xfer;
+    async_xfer = NULL;
+    __set_PRIMASK(primask);
+    if (xfer == NULL) {
+        return;
+    }
+    if (xfer->poll && (QSPI_AutoPolling_Done(xfer->req.data_phase.buf) != 0)) {
+        status = 1;
+    }
+    chry_sflash_async_complete(xfer->host, status ? -CHRY_SFLASH_ERR_IO : 0);
+}
 
+void chry_sflash_async_tick(void)
+{
+    struct chry_sflash_async_xfer *xfer;
+    uint32_t primask = __get_PRIMASK();
 
+    /* the match interrupt may complete the poll at the same time, only one of the two gets it */
+    __disable_irq();
+    xfer = async_xfer;
+    if ((xfer == NULL) || !xfer->poll ||
+        ((chry_sflash_get_tick_ms(xfer->host) - async_poll_start) <= xfer->timeout_ms)) {
+        __set_PRIMASK(primask);
+        return;
+    }
+    async_xfer = NULL;
+    QUADSPI->CR &= ~QUADSPI_CR_SMIE;
+    QSPI_AutoPolling_Stop();
+    NVIC_ClearPendingIRQ(QUADSPI_IRQn);
+    __set_PRIMASK(primask);
 
+    chry_sflash_async_complete(xfer->host, -CHRY_SFLASH_ERR_TIMEOUT);
+}
 
+int chry_sflash_async_start(struct chry_sflash_async_xfer *xfer)
+{
+    struct chry_sflash_request *req = &xfer->req;
+    u16 mode;
+    u8 stat;
 
+    if (chry_sflash_select(xfer->host) != 0) {
+        return -CHRY_SFLASH_ERR_IO;
+    }
+    QSPI_IT_Done = chry_sflash_async_irq_done;
+    async_xfer = xfer;
+
+    if (xfer->poll) {
+        mode = QSPI_CmdMode(req->cmd_phase.cmd_mode, req->addr_phase.addr_mode, req->addr_phase.addr_size, req->data_phase.data_mode, false);
+        async_poll_start = chry_sflash_get_tick_ms(xfer->host);
+        stat = QSPI_AutoPolling_Start_IT(req->cmd_phase.cmd, req->addr_phase.addr, mode, xfer->mask, xfer->match, QSPI_POLL_INTERVAL);
+    } else if (req->data_phase.len == 0) {
+        /* WREN, erase and the like, done when the controller has clocked them out */
+        mode = QSPI_CmdMode(req->cmd_phase.cmd_mode, req->addr_phase.addr_mode, req->addr_phase.addr_size, CHRY_SFLASH_DATAMODE_NONE, req->dtr_enable);
+        stat = QSPI_Send_CMD_IT(req->cmd_phase.cmd, req->addr_phase.addr, mode, 0);
+    } else if (req->dma_enable && req->data_phase.seg_count == 0 && req->data_phase.buf != NULL && req->data_phase.len <= 0xFFFF &&
+               ((req->data_phase.direction != CHRY_SFLASH_DATA_READ) || chry_sflash_async_dma_read(req->data_phase.buf, req->data_phase.len))) {
+        /* short ones too, the polled FIFO would spin here in interrupt context */
+        stat = QSPI_SendCmd(req->cmd_phase.cmd,req->cmd_phase.cmd_mode,req->addr_phase.addr,req->addr_phase.addr_mode,req->addr_phase.addr_size,req->data_phase.data_mode,req->dummy_phase.dummy_bytes,req->dtr_enable);
+        if ((stat == 0) && (req->data_phase.direction == CHRY_SFLASH_DATA_READ)) {
+            stat = QSPI_Receive_DMA_IT(req->data_phase.buf, req->data_phase.len);
+        } else if (stat == 0) {
+            stat = QSPI_Transmit_DMA_IT(req->data_phase.buf, req->data_phase.len);
+        }
+    } else {
+        async_xfer = NULL;
+        return chry_sflash_transfer(xfer->host, req);
+    }
+
+    if (stat != 0) {
+        async_xfer = NULL;
+        return -CHRY_SFLASH_ERR_IO;
+    }
+    return 1;
+}
+
+void chry_sflash_async_lock(struct chry_sflash_host *host)
+{
+    async_primask = __get_PRIMASK();
+    __disable_irq();
+}
+
+void chry_sflash_async_unlock(struct chry_sflash_host *host)
+{
+    __set_PRIMASK(async_primask);
+}
+#endif
+
+#ifdef CONFIG_CHRY_SFLASH_CRC32_HW
+/*
+ * CRC-32 on the CRC unit, default polynomial 0x04C11DB7 with reflected
+ * input and output gives the zlib compatible value. Words are fed with
+ * word reversal, the unaligned head and tail with byte reversal.
+ */
+uint32_t chry_sflash_crc32_update(uint32_t crc, const uint8_t *buf, uint32_t len)
+{
+    RCC->AHB1ENR |= RCC_AHB1ENR_CRCEN;
+
+    CRC->INIT = __RBIT(~crc);
+    CRC->CR = CRC_CR_REV_OUT | CRC_CR_REV_IN_0 | CRC_CR_RESET;
+
+    while (len && ((uintptr_t)buf & 3)) {
+        *(__IO uint8_t *)&CRC->DR = *buf++;
+        len--;
+    }
+
+    CRC->CR = CRC_CR_REV_OUT | CRC_CR_REV_IN;
+    while (len >= 4) {
+        CRC->DR = *(const uint32_t *)buf;
+        buf += 4;
+        len -= 4;
+    }
+
+    CRC->CR = CRC_CR_REV_OUT | CRC_CR_REV_IN_0;
+    while (len--) {
+        *(__IO uint8_t *)&CRC->DR = *buf++;
+    }
+
+    return ~CRC->DR;
+}
+#endif
@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2024, sakumisu
+ * Copyright (c) 2024, RCSN
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef CHRY_SFLASH_PORT_STM32_H
+#define CHRY_SFLASH_PORT_STM32_H
+
+#include "chry_sflash.h"
+
+/*
+ * STM32F7 QUADSPI port on HARDWARE/QSPI. spi_idx 0 and 1 are BK1 and BK2,
+ * dual_flash uses both from spi_idx 0.
+ *
+ * With CONFIG_CHRY_SFLASH_ASYNC the QUADSPI and DMA2 stream 7 interrupts
+ * complete transfers. The controller's status poll has no timeout of its
+ * own, the application calls chry_sflash_async_tick() from the tick it
+ * already has (SysTick_Handler, HAL_IncTick, an RTOS tick hook or a timer)
+ * and the port stops a poll that has run past its timeout_ms there. The
+ * timeout is only as fine as that tick, without it a poll never times out.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef CONFIG_CHRY_SFLASH_ASYNC
+/* call periodically, every millisecond or so, from interrupt or thread context */
+void chry_sflash_async_tick(void);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -5,6 +5,15 @@
 #define PORT_SPI_TX_DMA_REQ   HPM_DMA_SRC_SPI7_TX
 #define PORT_SPI_RX_DMA_CH    0
 #define PORT_SPI_TX_DMA_CH    1
+#define PORT_SPI_IRQ          IRQn_SPI7
+
+#ifdef CONFIG_CHRY_SFLASH_HPM_IRQ
+SDK_DECLARE_EXT_ISR_M(PORT_SPI_IRQ, port_spi_isr)
+void port_spi_isr(void)
+{
+    chry_sflash_hpm_spi_isr(PORT_SPI_BASE);
+}
+#endif
 
 static void spi_init_pins(hpm_spi_config_t *config)
 {
@@ -27,6 +36,9 @@ hpm_stat_t spi_host_init(hpm_spi_config_t *config)
     config->dma_control.tx_dma_req = PORT_SPI_TX_DMA_REQ;
     config->transfer_max_size = SPI_SOC_TRANSFER_COUNT_MAX;
     config->cs_pin = IOC_PAD_PF27;
+#ifdef CONFIG_CHRY_SFLASH_HPM_IRQ
+    config->irq = PORT_SPI_IRQ;
+#endif
 
     board_init_spi_clock(config->host_base);
     spi_init_pins(config);
@@ -8,20 +8,43 @@
 #include <stdio.h>
 #include "board.h"
 #include "chry_sflash_norflash.h"
+#include "chry_sflash_port_hpm.h"
 #include "hpm_l1c_drv.h"
 #include "hpm_mchtmr_drv.h"
 #include "hpm_gpio_drv.h"
+#include "hpm_csr_drv.h"
 
 struct chry_sflash_norflash flash;
 struct chry_sflash_host spi_host;
 
 #define TRANSFER_SIZE (8 * 1024U)
+#define READ_ROUNDS   (256U)
 
 ATTR_PLACE_AT_WITH_ALIGNMENT(".ahb_sram", HPM_L1C_CACHELINE_SIZE)
 uint8_t wbuff[TRANSFER_SIZE];
 ATTR_PLACE_AT_WITH_ALIGNMENT(".ahb_sram", HPM_L1C_CACHELINE_SIZE)
 uint8_t rbuff[TRANSFER_SIZE];
 
+/* the part of a sustained read the CPU spent waiting for the port, free for other work */
+static void read_idle_test(void)
+{
+    hpm_spi_config_t *config = (hpm_spi_config_t *)spi_host.user_data;
+    uint64_t start, wait_start, cycles, wait_cycles;
+    int ret = 0;
+
+    start = hpm_csr_get_core_mcycle();
+    wait_start = config->wait_cycles;
+    for (uint32_t i = 0; (i < READ_ROUNDS) && (ret == 0); i++) {
+        ret = chry_sflash_norflash_read(&flash, 0, rbuff, TRANSFER_SIZE);
+    }
+    cycles = hpm_csr_get_core_mcycle() - start;
+    wait_cycles = config->wait_cycles - wait_start;
+
+    printf("sustained read ret:%d, read_speed:%.2f KB/s, cpu idle:%.1f%%\n", ret,
+           (double)TRANSFER_SIZE * READ_ROUNDS * (clock_get_frequency(clock_cpu0) / 1000) / cycles,
+           100.0 * wait_cycles / cycles);
+}
+
 int main(void)
 {
     uint64_t elapsed = 0, now;
@@ -65,6 +88,15 @@ int main(void)
             while(1){}
         }
     }
+    /* neither end of the buffer on a cache line, the port bounces them */
+    memset(rbuff, 0, sizeof(rbuff));
+    ret = chry_sflash_norflash_read(&flash, 5, &rbuff[3], TRANSFER_SIZE - 70);
+    printf("unaligned read ret:%d\n", ret);
+    if ((ret < 0) || (memcmp(&rbuff[3], &wbuff[5], TRANSFER_SIZE - 70) != 0)) {
+        printf("unaligned read error\n");
+        while(1){}
+    }
+    read_idle_test();
     printf("done\r\n");
     while (1) {
     }
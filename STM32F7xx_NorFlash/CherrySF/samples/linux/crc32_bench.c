@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2024, sakumisu
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdlib.h>
+#include <time.h>
+#include "chry_sflash.h"
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#define BENCH_SIZE  (16 * 1024 * 1024)
+#define BENCH_LOOPS 4
+
+static uint32_t crc32_bitwise(uint32_t crc, const uint8_t *buf, uint32_t len)
+{
+    crc = ~crc;
+    while (len--) {
+        crc ^= *buf++;
+        for (int i = 0; i < 8; i++) {
+            crc = (crc >> 1) ^ ((crc & 1U) ? 0xEDB88320UL : 0U);
+        }
+    }
+    return ~crc;
+}
+
+#ifdef HAVE_ZLIB
+static uint32_t crc32_zlib(uint32_t crc, const uint8_t *buf, uint32_t len)
+{
+    return (uint32_t)crc32(crc, buf, len);
+}
+#endif
+
+static double now_s(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint32_t bench(const char *name, uint32_t (*fn)(uint32_t, const uint8_t *, uint32_t),
+                      const uint8_t *buf, uint32_t len, int loops)
+{
+    uint32_t crc = 0;
+    double start, elapsed;
+
+    start = now_s();
+    for (int i = 0; i < loops; i++) {
+        crc = fn(0, buf, len);
+    }
+    elapsed = now_s() - start;
+
+    printf("%-12s crc 0x%08x  %8.1f MB/s\r\n", name, crc, (double)len * loops / elapsed / 1e6);
+    return crc;
+}
+
+int main(void)
+{
+    uint8_t *buf;
+    uint32_t ref, crc;
+    int ret = 0;
+
+    buf = malloc(BENCH_SIZE);
+    if (buf == NULL) {
+        return 1;
+    }
+
+    srand(1);
+    for (uint32_t i = 0; i < BENCH_SIZE; i++) {
+        buf[i] = (uint8_t)rand();
+    }
+
+    /* "123456789" check value from the CRC catalogue */
+    crc = chry_sflash_crc32_update(0, (const uint8_t *)"123456789", 9);
+    if (crc != 0xCBF43926UL) {
+        printf("check value mismatch 0x%08x\r\n", crc);
+        ret = 1;
+    }
+
+    /* split updates must give the same result as one pass */
+    crc = chry_sflash_crc32_update(0, buf, 13);
+    crc = chry_sflash_crc32_update(crc, buf + 13, BENCH_SIZE - 13);
+
+    ref = bench("bitwise", crc32_bitwise, buf, BENCH_SIZE, 1);
+    if (bench("slice-by-8", chry_sflash_crc32_update, buf, BENCH_SIZE, BENCH_LOOPS) != ref || crc != ref) {
+        ret = 1;
+    }
+#ifdef HAVE_ZLIB
+    if (bench("zlib", crc32_zlib, buf, BENCH_SIZE, BENCH_LOOPS) != ref) {
+        ret = 1;
+    }
+#endif
+
+    free(buf);
+    printf("%s\r\n", ret ? "FAILED" : "OK");
+    return ret;
+}
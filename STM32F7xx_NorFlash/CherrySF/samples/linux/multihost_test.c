@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2024, sakumisu
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdlib.h>
+#include <pthread.h>
+#include "chry_sflash_norflash.h"
+#include "chry_sflash_port_linux.h"
+
+/*
+ * Two hosts on two device models, driven from three threads: two share
+ * bus 0 and work on separate regions, the third has bus 1 to itself.
+ * Every thread erases, programs and reads back its region a few times,
+ * the bus lock keeps the threads on bus 0 from splitting each other's
+ * command sequences.
+ *
+ *   multihost_test [image file]
+ *
+ * Bus 1 keeps its part in "<image file>.bus1".
+ */
+
+#define FLASH_SIZE   (16U * 1024U * 1024U)
+#define REGION_SIZE  (64U * 1024U)
+#define ROUNDS       (8U)
+#define THREAD_COUNT (3U)
+
+struct bus {
+    struct chry_sflash_linux_nor nor;
+    struct chry_sflash_host host;
+    struct chry_sflash_norflash flash;
+};
+
+struct worker {
+    struct bus *bus;
+    uint32_t addr;
+    uint32_t seed;
+    uint8_t wbuff[REGION_SIZE];
+    uint8_t rbuff[REGION_SIZE];
+    int ret;
+};
+
+static struct bus buses[2];
+static struct worker workers[THREAD_COUNT];
+
+static int bus_open(struct bus *bus, uint32_t spi_idx, const char *path)
+{
+    int ret;
+
+    ret = chry_sflash_linux_nor_open(&bus->nor, path, FLASH_SIZE);
+    if (ret < 0) {
+        printf("open %s ret:%d\r\n", path, ret);
+        return ret;
+    }
+
+    memset(&bus->host, 0, sizeof(bus->host));
+    bus->host.spi_idx = spi_idx;
+    bus->host.iomode = CHRY_SFLASH_IOMODE_QUAD;
+    bus->host.user_data = &bus->nor;
+    chry_sflash_init(&bus->host);
+
+    ret = chry_sflash_norflash_init(&bus->flash, &bus->host);
+    if (ret < 0) {
+        printf("bus %u norflash init ret:%d\r\n", spi_idx, ret);
+    }
+    return ret;
+}
+
+static void *worker_run(void *arg)
+{
+    struct worker *w = arg;
+    struct chry_sflash_norflash *flash = &w->bus->flash;
+
+    for (uint32_t round = 0; round < ROUNDS; round++) {
+        for (uint32_t i = 0; i < REGION_SIZE; i++) {
+            w->wbuff[i] = (uint8_t)rand_r(&w->seed);
+        }
+
+        w->ret = chry_sflash_norflash_erase(flash, w->addr, REGION_SIZE);
+        if (w->ret < 0) {
+            printf("worker 0x%08X erase ret:%d\r\n", w->addr, w->ret);
+            break;
+        }
+        /* pages are left programming between calls, the other thread on the bus has to wait for them */
+        for (uint32_t offset = 0; offset < REGION_SIZE; offset += 4096U) {
+            w->ret = chry_sflash_norflash_write_nowait(flash, w->addr + offset, &w->wbuff[offset], 4096U);
+            if (w->ret < 0) {
+                printf("worker 0x%08X write ret:%d\r\n", w->addr, w->ret);
+                return NULL;
+            }
+        }
+        memset(w->rbuff, 0, REGION_SIZE);
+        w->ret = chry_sflash_norflash_read(flash, w->addr, w->rbuff, REGION_SIZE);
+        if (w->ret < 0) {
+            printf("worker 0x%08X read ret:%d\r\n", w->addr, w->ret);
+            break;
+        }
+        if (memcmp(w->rbuff, w->wbuff, REGION_SIZE) != 0) {
+            printf("worker 0x%08X round %u: write read error\r\n", w->addr, round);
+            w->ret = -CHRY_SFLASH_ERR_IO;
+            break;
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = (argc > 1) ? argv[1] : "multihost.img";
+    pthread_t threads[THREAD_COUNT];
+    char path2[256];
+    int failed = 0;
+
+    snprintf(path2, sizeof(path2), "%s.bus1", path);
+    if ((bus_open(&buses[0], 0, path) < 0) || (bus_open(&buses[1], 1, path2) < 0)) {
+        return 1;
+    }
+
+    workers[0].bus = &buses[0];
+    workers[0].addr = 0;
+    workers[1].bus = &buses[0];
+    workers[1].addr = 4U * 1024U * 1024U;
+    workers[2].bus = &buses[1];
+    workers[2].addr = 0;
+
+    for (uint32_t i = 0; i < THREAD_COUNT; i++) {
+        workers[i].seed = i + 1;
+        if (pthread_create(&threads[i], NULL, worker_run, &workers[i]) != 0) {
+            printf("pthread_create failed\r\n");
+            return 1;
+        }
+    }
+    for (uint32_t i = 0; i < THREAD_COUNT; i++) {
+        pthread_join(threads[i], NULL);
+        failed |= (workers[i].ret < 0);
+    }
+
+    for (uint32_t i = 0; i < 2; i++) {
+        struct chry_sflash_linux_nor_stats *stats = &buses[i].nor.stats;
+
+        printf("bus %u: %.1f ms transfers:%llu ignored_busy:%llu ignored_wel:%llu conflicts:%llu protocol_errors:%llu\r\n", i,
+               chry_sflash_linux_nor_time_ns(&buses[i].nor) / 1e6, (unsigned long long)stats->transfers,
+               (unsigned long long)stats->ignored_busy, (unsigned long long)stats->ignored_wel,
+               (unsigned long long)stats->program_conflicts, (unsigned long long)stats->protocol_errors);
+        /* a command sequence split by the other thread shows up as a dropped command */
+        failed |= (stats->ignored_busy + stats->ignored_wel + stats->program_conflicts + stats->protocol_errors) != 0;
+
+        chry_sflash_norflash_deinit(&buses[i].flash);
+        chry_sflash_deinit(&buses[i].host);
+        chry_sflash_linux_nor_close(&buses[i].nor);
+    }
+
+    printf("%s\r\n", failed ? "failed" : "done");
+    return failed ? 1 : 0;
+}
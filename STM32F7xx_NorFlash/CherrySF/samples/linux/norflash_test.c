@@ -0,0 +1,382 @@
+/*
+ * Copyright (c) 2024, sakumisu
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdlib.h>
+#include <sched.h>
+#include <semaphore.h>
+#include "chry_sflash_norflash.h"
+#include "chry_sflash_port_linux.h"
+
+/*
+ * Runs the NOR core against the Linux port device model and prints the
+ * virtual time spent by a few command sequences.
+ *
+ *   norflash_test [image file]
+ *
+ * The dual-flash pass keeps the second part in "<image file>.bank2".
+ */
+
+#define FLASH_SIZE    (16U * 1024U * 1024U)
+#define TRANSFER_SIZE (256U * 1024U)
+#define ERASE_SIZE    (1024U * 1024U)
+#define BUFFER_SIZE   (4096U)  /* one FLM ProgramPage buffer */
+#define LINK_US       (4000U)  /* debugger download of one buffer, ~1 MB/s */
+#define LOOKUP_COUNT  (1000U)  /* small random reads, asset lookup pattern */
+#define LOOKUP_SIZE   (32U)
+
+struct chry_sflash_linux_nor nor;
+struct chry_sflash_linux_nor nor2;
+struct chry_sflash_norflash flash;
+struct chry_sflash_host spi_host;
+
+uint8_t wbuff[TRANSFER_SIZE];
+uint8_t rbuff[TRANSFER_SIZE];
+
+#ifdef CONFIG_CHRY_SFLASH_ASYNC
+static sem_t async_sem;
+static int async_status;
+
+static void async_done(struct chry_sflash_norflash *flash, int status, void *arg)
+{
+    async_status = status;
+    sem_post(&async_sem);
+}
+
+/* stand-in for the application's control loop, it runs until the flash operation calls back */
+static int async_wait(int ret, uint64_t *loops)
+{
+    if (ret < 0) {
+        return ret;
+    }
+    while (sem_trywait(&async_sem) != 0) {
+        (*loops)++;
+        sched_yield();
+    }
+    return async_status;
+}
+#endif
+
+static double elapsed_ms(uint64_t start)
+{
+    return (chry_sflash_linux_nor_time_ns(&nor) - start) / 1e6;
+}
+
+static const struct {
+    uint8_t iomode;
+    bool dtr;
+    bool qpi;
+} read_passes[] = {
+    { CHRY_SFLASH_IOMODE_SINGLE, false, false },
+    { CHRY_SFLASH_IOMODE_DUAL, false, false },
+    { CHRY_SFLASH_IOMODE_QUAD, false, false },
+    { CHRY_SFLASH_IOMODE_QUAD, true, false },
+    { CHRY_SFLASH_IOMODE_QUAD, false, true },
+};
+
+static int flash_open(uint8_t iomode, bool dtr, bool qpi)
+{
+    int ret;
+
+    memset(&spi_host, 0, sizeof(spi_host));
+    spi_host.spi_idx = 0;
+    spi_host.iomode = iomode;
+    spi_host.dtr_enable = dtr;
+    spi_host.qpi_enable = qpi;
+    spi_host.user_data = &nor;
+    chry_sflash_init(&spi_host);
+
+    ret = chry_sflash_norflash_init(&flash, &spi_host);
+    if (ret < 0) {
+        printf("norflash init ret:%d\r\n", ret);
+        return ret;
+    }
+
+    /* the core has already ramped the bus for the discovered read command */
+    return 0;
+}
+
+static int check_data(const char *name)
+{
+    if (memcmp(rbuff, wbuff, TRANSFER_SIZE) != 0) {
+        printf("%s: write read error\r\n", name);
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = (argc > 1) ? argv[1] : "norflash.img";
+    uint64_t start;
+    double erase_sector_ms, erase_block_ms, erase_odd_ms, write_ms, write_nowait_ms;
+    uint64_t erase_odd_ops;
+    double read_ms, lookup_us, dual_write_ms;
+    char path2[256];
+    int ret;
+
+    for (uint32_t i = 0; i < sizeof(wbuff); i++) {
+        wbuff[i] = (uint8_t)rand();
+    }
+
+    ret = chry_sflash_linux_nor_open(&nor, path, FLASH_SIZE);
+    if (ret < 0) {
+        printf("open %s ret:%d\r\n", path, ret);
+        return 1;
+    }
+
+    if (flash_open(CHRY_SFLASH_IOMODE_QUAD, false, false) < 0) {
+        return 1;
+    }
+    printf("size:%u KB sector:%u block:%u page:%u read_cmd:0x%02X pp_cmd:0x%02X\r\n",
+           flash.flash_size / 1024, flash.sector_size, flash.block_size, flash.page_size,
+           flash.read_cmd, flash.page_program_cmd);
+
+    /* erase: 4 KB sectors against the block erase the core picks for aligned ranges */
+    start = chry_sflash_linux_nor_time_ns(&nor);
+    for (uint32_t addr = 0; addr < ERASE_SIZE; addr += flash.sector_size) {
+        ret = chry_sflash_norflash_erase(&flash, addr, flash.sector_size);
+        if (ret < 0) {
+            printf("erase ret:%d\r\n", ret);
+            return 1;
+        }
+    }
+    erase_sector_ms = elapsed_ms(start);
+
+    start = chry_sflash_linux_nor_time_ns(&nor);
+    ret = chry_sflash_norflash_erase(&flash, 0, ERASE_SIZE);
+    if (ret < 0) {
+        printf("erase ret:%d\r\n", ret);
+        return 1;
+    }
+    erase_block_ms = elapsed_ms(start);
+
+    /* 1 MB one sector off alignment: 4 KB and 32 KB units at the edges, 64 KB blocks in between */
+    erase_odd_ops = nor.stats.erase_ops;
+    start = chry_sflash_linux_nor_time_ns(&nor);
+    ret = chry_sflash_norflash_erase(&flash, flash.sector_size, 1024U * 1024U);
+    if (ret < 0) {
+        printf("erase ret:%d\r\n", ret);
+        return 1;
+    }
+    erase_odd_ms = elapsed_ms(start);
+    erase_odd_ops = nor.stats.erase_ops - erase_odd_ops;
+
+    /* program the way the FLM does: one buffer per call, the debugger link in between */
+    start = chry_sflash_linux_nor_time_ns(&nor);
+    for (uint32_t addr = 0; addr < TRANSFER_SIZE; addr += BUFFER_SIZE) {
+        chry_sflash_linux_nor_delay_us(&nor, LINK_US);
+        ret = chry_sflash_norflash_write(&flash, addr, &wbuff[addr], BUFFER_SIZE);
+        if (ret < 0) {
+            printf("write ret:%d\r\n", ret);
+            return 1;
+        }
+    }
+    write_ms = elapsed_ms(start);
+
+    ret = chry_sflash_norflash_read(&flash, 0, rbuff, TRANSFER_SIZE);
+    if ((ret < 0) || (check_data("write") < 0)) {
+        return 1;
+    }
+
+    chry_sflash_norflash_erase(&flash, 0, TRANSFER_SIZE);
+    start = chry_sflash_linux_nor_time_ns(&nor);
+    for (uint32_t addr = 0; addr < TRANSFER_SIZE; addr += BUFFER_SIZE) {
+        chry_sflash_linux_nor_delay_us(&nor, LINK_US);
+        ret = chry_sflash_norflash_write_nowait(&flash, addr, &wbuff[addr], BUFFER_SIZE);
+        if (ret < 0) {
+            printf("write_nowait ret:%d\r\n", ret);
+            return 1;
+        }
+    }
+    ret = chry_sflash_norflash_wait_idle(&flash);
+    write_nowait_ms = elapsed_ms(start);
+
+    memset(rbuff, 0, sizeof(rbuff));
+    ret = chry_sflash_norflash_read(&flash, 0, rbuff, TRANSFER_SIZE);
+    if ((ret < 0) || (check_data("write_nowait") < 0)) {
+        return 1;
+    }
+
+#ifdef CONFIG_CHRY_SFLASH_ASYNC
+    /* the same erase, program and read back without blocking the caller */
+    {
+        double async_erase_ms, async_write_ms;
+        uint64_t loops = 0;
+
+        sem_init(&async_sem, 0, 0);
+        start = chry_sflash_linux_nor_time_ns(&nor);
+        /* the worker waits for the bus meanwhile, the erase is still in flight when the blocking read comes */
+        chry_sflash_lock(&spi_host);
+        ret = chry_sflash_norflash_erase_async(&flash, 0, ERASE_SIZE, async_done, NULL);
+        if ((ret == 0) && (chry_sflash_norflash_read(&flash, 0, rbuff, 16) != -CHRY_SFLASH_ERR_BUSY)) {
+            printf("read during erase_async not refused\r\n");
+            return 1;
+        }
+        chry_sflash_unlock(&spi_host);
+        ret = async_wait(ret, &loops);
+        if (ret < 0) {
+            printf("erase_async ret:%d\r\n", ret);
+            return 1;
+        }
+        async_erase_ms = elapsed_ms(start);
+
+        start = chry_sflash_linux_nor_time_ns(&nor);
+        ret = async_wait(chry_sflash_norflash_write_async(&flash, 0, wbuff, TRANSFER_SIZE, async_done, NULL), &loops);
+        if (ret < 0) {
+            printf("write_async ret:%d\r\n", ret);
+            return 1;
+        }
+        async_write_ms = elapsed_ms(start);
+
+        memset(rbuff, 0, sizeof(rbuff));
+        ret = async_wait(chry_sflash_norflash_read_async(&flash, 0, rbuff, TRANSFER_SIZE, async_done, NULL), &loops);
+        if ((ret < 0) || (check_data("async") < 0)) {
+            printf("read_async ret:%d\r\n", ret);
+            return 1;
+        }
+        sem_destroy(&async_sem);
+
+        printf("async erase %u KB %.1f ms, write %u KB %.1f ms, control loop ran %llu times meanwhile\r\n",
+               ERASE_SIZE / 1024, async_erase_ms, TRANSFER_SIZE / 1024, async_write_ms, (unsigned long long)loops);
+    }
+#endif
+
+    printf("erase %u KB: 4 KB sectors %.1f ms, block erase %.1f ms\r\n",
+           ERASE_SIZE / 1024, erase_sector_ms, erase_block_ms);
+    printf("erase 1024 KB at +%u KB: %llu commands %.1f ms\r\n",
+           flash.sector_size / 1024, (unsigned long long)erase_odd_ops, erase_odd_ms);
+    printf("program %u KB with %u us link per %u B buffer: write %.1f ms, write_nowait %.1f ms\r\n",
+           TRANSFER_SIZE / 1024, LINK_US, BUFFER_SIZE, write_ms, write_nowait_ms);
+
+    /* read throughput and small random read latency for each io mode, DTR and QPI last */
+    for (uint32_t i = 0; i < sizeof(read_passes) / sizeof(read_passes[0]); i++) {
+        if (flash_open(read_passes[i].iomode, read_passes[i].dtr, read_passes[i].qpi) < 0) {
+            return 1;
+        }
+        memset(rbuff, 0, sizeof(rbuff));
+        start = chry_sflash_linux_nor_time_ns(&nor);
+        ret = chry_sflash_norflash_read(&flash, 0, rbuff, TRANSFER_SIZE);
+        if ((ret < 0) || (check_data("read") < 0)) {
+            return 1;
+        }
+        read_ms = elapsed_ms(start);
+
+        srand(1);
+        start = chry_sflash_linux_nor_time_ns(&nor);
+        for (uint32_t n = 0; n < LOOKUP_COUNT; n++) {
+            uint32_t addr = (uint32_t)rand() % (TRANSFER_SIZE - LOOKUP_SIZE);
+
+            ret = chry_sflash_norflash_read(&flash, addr, rbuff, LOOKUP_SIZE);
+            if ((ret < 0) || (memcmp(rbuff, &wbuff[addr], LOOKUP_SIZE) != 0)) {
+                printf("lookup: read error\r\n");
+                return 1;
+            }
+        }
+        lookup_us = elapsed_ms(start) * 1000.0 / LOOKUP_COUNT;
+
+        printf("read iomode:%u%s cmd:0x%02X %u MHz %.2f KB/ms, %u B lookup %.2f us\r\n", spi_host.iomode,
+               (flash.cmd_mode == CHRY_SFLASH_CMDMODE_4LINES) ? " qpi" : (flash.read_dtr ? " dtr" : ""),
+               (flash.cmd_mode == CHRY_SFLASH_CMDMODE_4LINES) ? flash.qpi_read_cmd : flash.read_cmd,
+               nor.freq / 1000000U, TRANSFER_SIZE / 1024 / read_ms, LOOKUP_SIZE, lookup_us);
+    }
+
+    /* the part must come back to SPI mode for the next user */
+    ret = chry_sflash_norflash_deinit(&flash);
+    if ((ret < 0) || nor.qpi) {
+        printf("deinit ret:%d qpi:%u\r\n", ret, nor.qpi);
+        return 1;
+    }
+
+    /* a JESD216F table sets the DTR read clocks, an odd count can not be sent as dummy bytes and stays SDR */
+    for (uint8_t dummy_clocks = 4; dummy_clocks <= 5; dummy_clocks++) {
+        uint64_t protocol_errors = nor.stats.protocol_errors;
+
+        chry_sflash_linux_nor_set_dtr_read(&nor, 2, dummy_clocks);
+        if (flash_open(CHRY_SFLASH_IOMODE_QUAD, true, false) < 0) {
+            return 1;
+        }
+        memset(rbuff, 0, sizeof(rbuff));
+        ret = chry_sflash_norflash_read(&flash, 0, rbuff, TRANSFER_SIZE);
+        if ((ret < 0) || (check_data("dtr read") < 0) || (nor.stats.protocol_errors != protocol_errors) ||
+            (flash.read_dtr != ((dummy_clocks % 2U) == 0))) {
+            printf("dtr read with %u dummy clocks: ret:%d dtr:%u protocol_errors:%llu\r\n", dummy_clocks, ret,
+                   flash.read_dtr, (unsigned long long)(nor.stats.protocol_errors - protocol_errors));
+            return 1;
+        }
+        printf("dtr read with 2 mode %u dummy clocks: cmd:0x%02X%s\r\n", dummy_clocks, flash.read_cmd,
+               flash.read_dtr ? " dtr" : "");
+    }
+
+    /* the same FLM download onto two parts in dual-flash mode */
+    snprintf(path2, sizeof(path2), "%s.bank2", path);
+    ret = chry_sflash_linux_nor_open(&nor2, path2, FLASH_SIZE);
+    if (ret < 0) {
+        printf("open %s ret:%d\r\n", path2, ret);
+        return 1;
+    }
+    /* the same part as bank 1 */
+    chry_sflash_linux_nor_set_dtr_read(&nor2, 2, 5);
+    nor.bank2 = &nor2;
+    memset(&spi_host, 0, sizeof(spi_host));
+    spi_host.iomode = CHRY_SFLASH_IOMODE_QUAD;
+    spi_host.dual_flash = true;
+    spi_host.user_data = &nor;
+    chry_sflash_init(&spi_host);
+    ret = chry_sflash_norflash_init(&flash, &spi_host);
+    if (ret < 0) {
+        printf("dual norflash init ret:%d\r\n", ret);
+        return 1;
+    }
+
+    chry_sflash_norflash_erase(&flash, 0, TRANSFER_SIZE + flash.sector_size);
+    start = chry_sflash_linux_nor_time_ns(&nor);
+    for (uint32_t addr = 0; addr < TRANSFER_SIZE; addr += BUFFER_SIZE) {
+        chry_sflash_linux_nor_delay_us(&nor, LINK_US);
+        ret = chry_sflash_norflash_write_nowait(&flash, addr, &wbuff[addr], BUFFER_SIZE);
+        if (ret < 0) {
+            printf("dual write_nowait ret:%d\r\n", ret);
+            return 1;
+        }
+    }
+    ret = chry_sflash_norflash_wait_idle(&flash);
+    dual_write_ms = elapsed_ms(start);
+
+    memset(rbuff, 0, sizeof(rbuff));
+    start = chry_sflash_linux_nor_time_ns(&nor);
+    ret = chry_sflash_norflash_read(&flash, 0, rbuff, TRANSFER_SIZE);
+    if ((ret < 0) || (check_data("dual read") < 0)) {
+        return 1;
+    }
+    read_ms = elapsed_ms(start);
+
+    /* odd head and tail bytes are handled by the core */
+    ret = chry_sflash_norflash_read(&flash, 3, rbuff, 1001);
+    if ((ret < 0) || (memcmp(rbuff, &wbuff[3], 1001) != 0)) {
+        printf("dual unaligned read error\r\n");
+        return 1;
+    }
+    ret = chry_sflash_norflash_write(&flash, TRANSFER_SIZE + 3, wbuff, 5);
+    ret |= chry_sflash_norflash_read(&flash, TRANSFER_SIZE, rbuff, 10);
+    if ((ret < 0) || (rbuff[2] != 0xFF) || (memcmp(&rbuff[3], wbuff, 5) != 0) || (rbuff[8] != 0xFF)) {
+        printf("dual unaligned write error\r\n");
+        return 1;
+    }
+
+    printf("dual-flash size:%u KB sector:%u page:%u: program %u KB write_nowait %.1f ms (single %.1f ms), read %.2f KB/ms\r\n",
+           flash.flash_size / 1024, flash.sector_size, flash.page_size, TRANSFER_SIZE / 1024,
+           dual_write_ms, write_nowait_ms, TRANSFER_SIZE / 1024 / read_ms);
+
+    printf("transfers:%llu batches:%llu busy_polls:%llu ignored_busy:%llu ignored_wel:%llu ignored_mode:%llu conflicts:%llu protocol_errors:%llu\r\n",
+           (unsigned long long)nor.stats.transfers, (unsigned long long)nor.stats.batches, (unsigned long long)nor.stats.busy_polls,
+           (unsigned long long)nor.stats.ignored_busy, (unsigned long long)nor.stats.ignored_wel,
+           (unsigned long long)nor.stats.ignored_mode, (unsigned long long)nor.stats.program_conflicts,
+           (unsigned long long)(nor.stats.protocol_errors + nor2.stats.protocol_errors));
+
+    chry_sflash_deinit(&spi_host);
+    chry_sflash_linux_nor_close(&nor);
+    chry_sflash_linux_nor_close(&nor2);
+    printf("done\r\n");
+    return 0;
+}
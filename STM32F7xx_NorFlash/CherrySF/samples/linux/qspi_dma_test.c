@@ -0,0 +1,243 @@
+/*
+ * Copyright (c) 2024, sakumisu
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "qspi.h"
+
+/*
+ * Runs the DMA reads of HARDWARE/QSPI/qspi.c, QSPI_Receive_DMA_Seg and
+ * QSPI_Receive_DMA_IT with the DMA2 stream 7 interrupt, against the host
+ * model with the D-Cache on. Every offset within a cache line, lengths
+ * around the line size and one to three segments are tried. The data has
+ * to arrive, nothing outside the buffers may change, and every cache line
+ * the driver invalidates has to lie inside a buffer: invalidating a line
+ * shared with other variables drops whatever the CPU wrote there during
+ * the transfer. DMA has to carry the whole lines and only those.
+ *
+ *   qspi_dma_test
+ */
+
+#define TEST_ADDR   (0x1000U)
+#define GUARD       (64U)
+#define MAX_LEN     (4096U)
+#define MODE_DATA   (0X65U) /* 1-1-1, 24-bit address, data */
+#define AREA_SIZE   (MAX_LEN + 3U * QSPI_DMA_LINE + 2U * GUARD)
+#define AREA_HINT   (0X10000000UL)
+
+void DMA2_Stream7_IRQHandler(void);
+
+static const uint32_t lengths[] = {
+    1, 2, 3, 4, 5, 31, 32, 33, 34, 63, 64, 65, 66, 95, 96, 97, 100, 127, 128, 129, 255, 256, 257, 1000, MAX_LEN
+};
+
+static uint8_t *area;
+static uint8_t image[QSPI_MODEL_MEM_SIZE];
+static int it_status;
+static bool it_done;
+
+static void it_callback(u8 status)
+{
+    it_status = status;
+    it_done = true;
+}
+
+/* bytes a read into buf may take by DMA, the whole lines in it */
+static uint32_t dma_part(const uint8_t *buf, uint32_t len)
+{
+    uint32_t head = (QSPI_DMA_LINE - ((uintptr_t)buf & (QSPI_DMA_LINE - 1))) & (QSPI_DMA_LINE - 1);
+
+    if (head >= len) {
+        return 0;
+    }
+    return (len - head) & ~(QSPI_DMA_LINE - 1);
+}
+
+/* splits len into seg_count pieces, each placed one byte further along than a packed layout would put it */
+static void split(uint32_t align, uint32_t len, u8 seg_count, u8 **bufs, u32 *lens)
+{
+    uint32_t offset = GUARD + align;
+    uint32_t done = 0;
+
+    for (u8 i = 0; i < seg_count; i++) {
+        lens[i] = (i == seg_count - 1U) ? (len - done) : (len / seg_count);
+        bufs[i] = &area[offset];
+        offset += lens[i] + 1U;
+        done += lens[i];
+    }
+}
+
+static const char *check(uint8_t *const *bufs, const u32 *lens, u8 seg_count, uint32_t addr, uint64_t dma_bytes)
+{
+    uint32_t done = 0;
+    uint64_t dma_expected = 0;
+
+    for (u8 i = 0; i < seg_count; i++) {
+        if (memcmp(bufs[i], &image[addr + done], lens[i]) != 0) {
+            return "data error";
+        }
+        done += lens[i];
+        dma_expected += dma_part(bufs[i], lens[i]);
+    }
+    for (uint8_t *p = area; p < &area[AREA_SIZE]; p++) {
+        bool inside = false;
+
+        for (u8 i = 0; i < seg_count; i++) {
+            if ((p >= bufs[i]) && (p < bufs[i] + lens[i])) {
+                inside = true;
+            }
+        }
+        if (!inside && (*p != 0xA5)) {
+            return "wrote outside the buffers";
+        }
+    }
+    if (qspi_model_cache_ops > QSPI_MODEL_CACHE_LOG) {
+        return "too many cache operations to check";
+    }
+    for (uint32_t n = 0; n < qspi_model_cache_ops; n++) {
+        struct qspi_model_cache_op *op = &qspi_model_cache_log[n];
+        bool inside = false;
+
+        if (op->op == 0) {
+            continue;
+        }
+        for (u8 i = 0; i < seg_count; i++) {
+            if ((op->addr >= (uintptr_t)bufs[i]) && (op->addr + (uint32_t)op->size <= (uintptr_t)bufs[i] + lens[i])) {
+                inside = true;
+            }
+        }
+        if (!inside) {
+            return "invalidated a cache line shared with other data";
+        }
+    }
+    if (qspi_model_stats.dma_bytes - dma_bytes != dma_expected) {
+        return "DMA did not carry exactly the whole cache lines";
+    }
+    return NULL;
+}
+
+static int run_seg(uint32_t align, uint32_t len, u8 seg_count)
+{
+    u8 *bufs[3];
+    u32 lens[3];
+    uint64_t errors = qspi_model_stats.errors;
+    uint64_t dma_bytes = qspi_model_stats.dma_bytes;
+    const char *what;
+    u8 stat;
+
+    memset(area, 0xA5, AREA_SIZE);
+    split(align, len, seg_count, bufs, lens);
+    qspi_model_cache_ops = 0;
+    QSPI_Send_CMD(0X0B, TEST_ADDR + align, MODE_DATA, 8);
+    stat = QSPI_Receive_DMA_Seg(bufs, lens, seg_count);
+    if ((stat != 0) || (qspi_model_stats.errors != errors)) {
+        printf("seg align %u len %u segs %u: stat %u, %llu FIFO errors\r\n", align, len, seg_count, stat,
+               (unsigned long long)(qspi_model_stats.errors - errors));
+        return -1;
+    }
+    what = check(bufs, lens, seg_count, TEST_ADDR + align, dma_bytes);
+    if (what != NULL) {
+        printf("seg align %u len %u segs %u: %s\r\n", align, len, seg_count, what);
+        return -1;
+    }
+    return 0;
+}
+
+static int run_it(uint32_t align, uint32_t len)
+{
+    u8 *buf;
+    u32 buflen;
+    uint64_t errors = qspi_model_stats.errors;
+    uint64_t dma_bytes = qspi_model_stats.dma_bytes;
+    uint32_t wait = 0XFFFFFF;
+    const char *what;
+    u8 stat;
+
+    memset(area, 0xA5, AREA_SIZE);
+    split(align, len, 1, &buf, &buflen);
+    qspi_model_cache_ops = 0;
+    it_done = false;
+    QSPI_Send_CMD(0X0B, TEST_ADDR + align, MODE_DATA, 8);
+    stat = QSPI_Receive_DMA_IT(buf, buflen);
+    if (dma_part(buf, buflen) == 0) {
+        /* nothing for DMA, the caller reads it polled */
+        if ((stat == 0) || (qspi_model_cache_ops != 0)) {
+            printf("it align %u len %u: started without a whole cache line\r\n", align, len);
+            return -1;
+        }
+        return 0;
+    }
+    if (stat != 0) {
+        printf("it align %u len %u: not started\r\n", align, len);
+        return -1;
+    }
+    /* the interrupt comes once the stream is through */
+    while (wait && !(DMA2->HISR & (1 << 27))) {
+        wait--;
+    }
+    DMA2_Stream7_IRQHandler();
+    if (!it_done || (it_status != 0) || (qspi_model_stats.errors != errors)) {
+        printf("it align %u len %u: done %u status %d, %llu FIFO errors\r\n", align, len, it_done, it_status,
+               (unsigned long long)(qspi_model_stats.errors - errors));
+        return -1;
+    }
+    what = check(&buf, &buflen, 1, TEST_ADDR + align, dma_bytes);
+    if (what != NULL) {
+        printf("it align %u len %u: %s\r\n", align, len, what);
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t transfers = 0;
+
+    /* the driver hands DMA and the cache u32 addresses */
+    area = mmap((void *)AREA_HINT, AREA_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if ((area == MAP_FAILED) || ((uintptr_t)area + AREA_SIZE > 0XFFFFFFFFUL) || ((uintptr_t)area & (QSPI_DMA_LINE - 1))) {
+        printf("no cache line aligned buffer in the low 4 GB\r\n");
+        return 1;
+    }
+
+    qspi_model_reset(1);
+    if (QSPI_Init() != 0) {
+        printf("QSPI_Init failed\r\n");
+        return 1;
+    }
+    for (uint32_t i = 0; i < sizeof(image); i++) {
+        image[i] = (uint8_t)rand();
+    }
+    memcpy(qspi_model_mem, image, sizeof(image));
+    SCB->CCR |= SCB_CCR_DC_Msk;
+    QSPI_IT_Done = it_callback;
+
+    for (uint32_t align = 0; align < QSPI_DMA_LINE + 1U; align++) {
+        for (uint32_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+            for (u8 segs = 1; segs <= 3; segs++) {
+                if (lengths[i] < segs) {
+                    continue;
+                }
+                if (run_seg(align, lengths[i], segs) < 0) {
+                    return 1;
+                }
+                transfers++;
+            }
+            if (run_it(align, lengths[i]) < 0) {
+                return 1;
+            }
+            transfers++;
+        }
+    }
+    printf("%u transfers, %llu bytes by DMA, %llu word and %llu byte FIFO accesses, %llu FIFO errors\r\n", transfers,
+           (unsigned long long)qspi_model_stats.dma_bytes, (unsigned long long)qspi_model_stats.fifo_words,
+           (unsigned long long)qspi_model_stats.fifo_bytes, (unsigned long long)qspi_model_stats.errors);
+    munmap(area, AREA_SIZE);
+    printf("done\r\n");
+    return 0;
+}
@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2024, sakumisu
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "qspi.h"
+
+/*
+ * Runs the polled data path of HARDWARE/QSPI/qspi.c, QSPI_Receive_Seg and
+ * QSPI_Transmit_Seg, against the host model of the QUADSPI register block.
+ * Every buffer alignment, lengths around the word size and the FIFO, one
+ * to three segments and every FIFO threshold are tried with word access
+ * on and off. The data has to come out the same either way and no FIFO
+ * access may be one the FIFO could not take at that moment. The FIFO and
+ * register accesses of a 4 KB read are printed for both access widths,
+ * the cycles they cost on target are measured by FlashPrg.c built with
+ * QSPI_FIFO_BENCH.
+ *
+ *   qspi_fifo_test
+ */
+
+#define TEST_ADDR   (0x1000U)
+#define GUARD       (8U)
+#define MAX_LEN     (4096U)
+#define MODE_DATA   (0X65U) /* 1-1-1, 24-bit address, data */
+
+static const uint32_t lengths[] = {
+    1, 2, 3, 4, 5, 6, 7, 8, 9, 11, 12, 13, 15, 16, 17, 23, 31, 32, 33, 35,
+    36, 40, 47, 63, 64, 65, 67, 80, 255, 256, 257, 1023, 1024, MAX_LEN
+};
+
+static uint8_t buffer[MAX_LEN + 3U * 4U + 2U * GUARD];
+static uint8_t image[QSPI_MODEL_MEM_SIZE];
+
+static void set_threshold(uint32_t thres)
+{
+    QUADSPI->CR = (QUADSPI->CR & ~(0X1FUL << 8)) | ((thres - 1U) << 8);
+}
+
+/* splits len into seg_count pieces, each placed one byte further along than a packed layout would put it */
+static void split(uint32_t align, uint32_t len, u8 seg_count, u8 **bufs, u32 *lens)
+{
+    uint32_t offset = GUARD + align;
+    uint32_t done = 0;
+
+    for (u8 i = 0; i < seg_count; i++) {
+        lens[i] = (i == seg_count - 1U) ? (len - done) : (len / seg_count);
+        bufs[i] = &buffer[offset];
+        offset += lens[i] + 1U;
+        done += lens[i];
+    }
+}
+
+static int check_guard(uint8_t *const *bufs, const u32 *lens, u8 seg_count)
+{
+    for (uint8_t *p = buffer; p < &buffer[sizeof(buffer)]; p++) {
+        bool inside = false;
+
+        for (u8 i = 0; i < seg_count; i++) {
+            if ((p >= bufs[i]) && (p < bufs[i] + lens[i])) {
+                inside = true;
+            }
+        }
+        if (!inside && (*p != 0xA5)) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int run_read(uint32_t thres, uint32_t align, uint32_t len, u8 seg_count)
+{
+    u8 *bufs[3];
+    u32 lens[3];
+    uint32_t done = 0;
+    uint64_t errors = qspi_model_stats.errors;
+    u8 stat;
+
+    memset(buffer, 0xA5, sizeof(buffer));
+    split(align, len, seg_count, bufs, lens);
+    QSPI_Send_CMD(0X0B, TEST_ADDR + align, MODE_DATA, 8);
+    stat = QSPI_Receive_Seg(bufs, lens, seg_count);
+    if ((stat != 0) || (qspi_model_stats.errors != errors)) {
+        printf("read thres %u align %u len %u segs %u word %u: stat %u, %llu FIFO errors\r\n", thres, align, len, seg_count,
+               QSPI_FIFO_Word, stat, (unsigned long long)(qspi_model_stats.errors - errors));
+        return -1;
+    }
+    for (u8 i = 0; i < seg_count; i++) {
+        if (memcmp(bufs[i], &image[TEST_ADDR + align + done], lens[i]) != 0) {
+            printf("read thres %u align %u len %u segs %u word %u: data error in segment %u\r\n", thres, align, len, seg_count,
+                   QSPI_FIFO_Word, i);
+            return -1;
+        }
+        done += lens[i];
+    }
+    if (check_guard(bufs, lens, seg_count) < 0) {
+        printf("read thres %u align %u len %u segs %u word %u: wrote outside the buffers\r\n", thres, align, len, seg_count,
+               QSPI_FIFO_Word);
+        return -1;
+    }
+    return 0;
+}
+
+static int run_write(uint32_t thres, uint32_t align, uint32_t len, u8 seg_count)
+{
+    u8 *bufs[3];
+    u32 lens[3];
+    uint32_t done = 0;
+    uint64_t errors = qspi_model_stats.errors;
+    u8 stat;
+
+    memset(buffer, 0xA5, sizeof(buffer));
+    split(align, len, seg_count, bufs, lens);
+    for (u8 i = 0; i < seg_count; i++) {
+        for (uint32_t j = 0; j < lens[i]; j++) {
+            bufs[i][j] = (uint8_t)rand();
+        }
+    }
+    memset(qspi_model_mem, 0xFF, sizeof(qspi_model_mem));
+    QSPI_Send_CMD(0X02, TEST_ADDR + align, MODE_DATA, 0);
+    stat = QSPI_Transmit_Seg(bufs, lens, seg_count);
+    if ((stat != 0) || (qspi_model_stats.errors != errors)) {
+        printf("write thres %u align %u len %u segs %u word %u: stat %u, %llu FIFO errors\r\n", thres, align, len, seg_count,
+               QSPI_FIFO_Word, stat, (unsigned long long)(qspi_model_stats.errors - errors));
+        return -1;
+    }
+    for (u8 i = 0; i < seg_count; i++) {
+        if (memcmp(&qspi_model_mem[TEST_ADDR + align + done], bufs[i], lens[i]) != 0) {
+            printf("write thres %u align %u len %u segs %u word %u: data error in segment %u\r\n", thres, align, len, seg_count,
+                   QSPI_FIFO_Word, i);
+            return -1;
+        }
+        done += lens[i];
+    }
+    if ((qspi_model_mem[TEST_ADDR + align - 1U] != 0xFF) || (qspi_model_mem[TEST_ADDR + align + len] != 0xFF)) {
+        printf("write thres %u align %u len %u segs %u word %u: wrote outside the range\r\n", thres, align, len, seg_count,
+               QSPI_FIFO_Word);
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t transfers = 0;
+    uint64_t accesses;
+    uint64_t fifo;
+    u8 *buf = buffer;
+    u32 len = MAX_LEN;
+
+    qspi_model_reset(1);
+    if (QSPI_Init() != 0) {
+        printf("QSPI_Init failed\r\n");
+        return 1;
+    }
+    for (uint32_t i = 0; i < sizeof(image); i++) {
+        image[i] = (uint8_t)rand();
+    }
+
+    for (uint32_t thres = 1; thres <= QSPI_MODEL_FIFO_SIZE; thres++) {
+        set_threshold(thres);
+        for (QSPI_FIFO_Word = 0; QSPI_FIFO_Word < 2; QSPI_FIFO_Word++) {
+            for (uint32_t align = 0; align < 4; align++) {
+                for (uint32_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+                    for (u8 segs = 1; segs <= 3; segs++) {
+                        if (lengths[i] < segs) {
+                            continue;
+                        }
+                        memcpy(qspi_model_mem, image, sizeof(image));
+                        if ((run_read(thres, align, lengths[i], segs) < 0) || (run_write(thres, align, lengths[i], segs) < 0)) {
+                            return 1;
+                        }
+                        transfers += 2;
+                    }
+                }
+            }
+        }
+    }
+    printf("%u transfers, %llu word and %llu byte FIFO accesses, %llu FIFO errors\r\n", transfers,
+           (unsigned long long)qspi_model_stats.fifo_words, (unsigned long long)qspi_model_stats.fifo_bytes,
+           (unsigned long long)qspi_model_stats.errors);
+
+    /* one aligned 4 KB read, word access takes a quarter of the FIFO accesses */
+    memcpy(qspi_model_mem, image, sizeof(image));
+    set_threshold(QSPI_FIFO_THRESHOLD);
+    for (QSPI_FIFO_Word = 0; QSPI_FIFO_Word < 2; QSPI_FIFO_Word++) {
+        accesses = qspi_model_stats.accesses;
+        fifo = qspi_model_stats.fifo_words + qspi_model_stats.fifo_bytes;
+        QSPI_Send_CMD(0X0B, TEST_ADDR, MODE_DATA, 8);
+        if (QSPI_Receive_Seg(&buf, &len, 1) != 0) {
+            return 1;
+        }
+        printf("4 KB read, %s access: %llu FIFO accesses, %llu register accesses\r\n", QSPI_FIFO_Word ? "word" : "byte",
+               (unsigned long long)(qspi_model_stats.fifo_words + qspi_model_stats.fifo_bytes - fifo),
+               (unsigned long long)(qspi_model_stats.accesses - accesses));
+    }
+    QSPI_FIFO_Word = 1;
+    printf("done\r\n");
+    return 0;
+}
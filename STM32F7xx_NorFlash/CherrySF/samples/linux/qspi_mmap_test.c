@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2024, sakumisu
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "qspi.h"
+
+/*
+ * Walks HARDWARE/QSPI/qspi.c through the mode switches FlashPrg.c makes,
+ * against the host model of the QUADSPI register block: Verify maps the
+ * part, ProgramPage goes back to indirect commands, the next Verify maps
+ * it again and UnInit leaves it mapped. After each step the test checks
+ * QSPI_MMAP_Sta, FMODE and the command in CCR, BUSY, and how many aborts
+ * the driver issued. The model refuses a CCR write while the mapped read
+ * keeps the controller BUSY, so a switch that skips the abort fails.
+ *
+ *   qspi_mmap_test
+ */
+
+#define PAGE_ADDR    (0x2000U)
+#define PAGE_SIZE    (256U)
+#define MODE_1_4_4   (0X01U | (3U << 2) | (2U << 4) | (3U << 6)) /* EBh */
+#define MODE_1_1_4   (0X01U | (1U << 2) | (2U << 4) | (3U << 6)) /* 6Bh, 32h */
+#define MODE_1_1_1   (0X01U | (1U << 2) | (2U << 4) | (1U << 6)) /* 0Bh */
+#define MODE_CMD     (0X01U)
+#define MODE_STATUS  (0X01U | (1U << 6))
+
+static uint8_t image[QSPI_MODEL_MEM_SIZE];
+static uint8_t page[PAGE_SIZE];
+static uint8_t readback[PAGE_SIZE];
+
+static int expect(const char *step, bool mapped, uint8_t cmd, uint64_t aborts)
+{
+    uint32_t ccr = QUADSPI->CCR;
+
+    if (QSPI_MMAP_Sta != mapped) {
+        printf("%s: QSPI_MMAP_Sta %u\r\n", step, QSPI_MMAP_Sta);
+        return -1;
+    }
+    if (mapped && ((((ccr >> 26) & 3U) != 3U) || !qspi_model_mapped())) {
+        printf("%s: CCR FMODE %u, not mapped\r\n", step, (ccr >> 26) & 3U);
+        return -1;
+    }
+    /* out of the window the controller has to be free for the next command */
+    if (!mapped && (QUADSPI->SR & (1 << 5))) {
+        printf("%s: still BUSY\r\n", step);
+        return -1;
+    }
+    if ((ccr & 0XFFU) != cmd) {
+        printf("%s: CCR instruction %02Xh, expected %02Xh\r\n", step, ccr & 0XFFU, cmd);
+        return -1;
+    }
+    if (qspi_model_stats.aborts != aborts) {
+        printf("%s: %llu aborts, expected %llu\r\n", step, (unsigned long long)qspi_model_stats.aborts,
+               (unsigned long long)aborts);
+        return -1;
+    }
+    if (qspi_model_stats.errors != 0) {
+        printf("%s: %llu register errors\r\n", step, (unsigned long long)qspi_model_stats.errors);
+        return -1;
+    }
+    printf("%-36s %-8s CCR %08X, %llu aborts\r\n", step, mapped ? "mapped" : "indirect", ccr,
+           (unsigned long long)qspi_model_stats.aborts);
+    return 0;
+}
+
+/* Verify: compare through the window */
+static int verify(const char *step, u8 cmd, u16 mode, u8 dmcycle, uint64_t aborts)
+{
+    if (QSPI_MemoryMapped(cmd, mode, dmcycle) != 0) {
+        printf("%s: QSPI_MemoryMapped failed\r\n", step);
+        return -1;
+    }
+    if ((qspi_model_map_read(0, readback, sizeof(readback)) < 0) || (memcmp(readback, image, sizeof(readback)) != 0) ||
+        (qspi_model_map_read(PAGE_ADDR, readback, sizeof(readback)) < 0) ||
+        (memcmp(readback, &image[PAGE_ADDR], sizeof(readback)) != 0)) {
+        printf("%s: window reads wrong data\r\n", step);
+        return -1;
+    }
+    if ((QUADSPI->CR & (1 << 3)) != 0) {
+        printf("%s: timeout counter left on, nCS would drop between reads\r\n", step);
+        return -1;
+    }
+    return expect(step, true, cmd, aborts);
+}
+
+/* ProgramPage: WREN, 32h page program, poll WIP */
+static int program(const char *step, uint64_t aborts)
+{
+    u8 status = 0XFF;
+    char what[64];
+
+    QSPI_Send_CMD(0X06, 0, MODE_CMD, 0);
+    snprintf(what, sizeof(what), "%s, WREN", step);
+    if (expect(what, false, 0X06, aborts) < 0) {
+        return -1;
+    }
+    QSPI_Send_CMD(0X32, PAGE_ADDR, MODE_1_1_4, 0);
+    if (QSPI_Transmit(page, sizeof(page)) != 0) {
+        printf("%s: page program failed\r\n", step);
+        return -1;
+    }
+    memcpy(&image[PAGE_ADDR], page, sizeof(page));
+    if (memcmp(&qspi_model_mem[PAGE_ADDR], page, sizeof(page)) != 0) {
+        printf("%s: page not written\r\n", step);
+        return -1;
+    }
+    if ((QSPI_AutoPolling_Start(0X05, 0, MODE_STATUS, 0X01, 0X00, 16) != 0) || (QSPI_AutoPolling_Done(&status) != 0) ||
+        (status != 0)) {
+        printf("%s: status poll failed\r\n", step);
+        return -1;
+    }
+    snprintf(what, sizeof(what), "%s, poll", step);
+    return expect(what, false, 0X05, aborts);
+}
+
+int main(int argc, char **argv)
+{
+    qspi_model_reset(1);
+    if (QSPI_Init() != 0) {
+        printf("QSPI_Init failed\r\n");
+        return 1;
+    }
+    for (uint32_t i = 0; i < sizeof(image); i++) {
+        image[i] = (uint8_t)rand();
+    }
+    memset(&image[PAGE_ADDR], 0XFF, PAGE_SIZE);
+    memcpy(qspi_model_mem, image, sizeof(image));
+    for (uint32_t i = 0; i < sizeof(page); i++) {
+        page[i] = (uint8_t)rand();
+    }
+
+    /* with the timeout counter on nCS drops between two window reads, mapping has to turn it off */
+    QUADSPI->CR |= 1 << 3;
+    /* a second Verify with the same read keeps the mapping, no abort */
+    if ((verify("Verify", 0XEB, MODE_1_4_4, 6, 0) < 0) || (verify("Verify, same read", 0XEB, MODE_1_4_4, 6, 0) < 0)) {
+        return 1;
+    }
+    /* the first indirect command after a mapped read has to abort it, the controller is still BUSY */
+    if ((program("ProgramPage after Verify", 1) < 0) || (program("ProgramPage again", 1) < 0)) {
+        return 1;
+    }
+    if (verify("Verify after ProgramPage", 0XEB, MODE_1_4_4, 6, 1) < 0) {
+        return 1;
+    }
+    /* another read command remaps through an abort */
+    if (verify("Verify, other read", 0X6B, MODE_1_1_4, 8, 2) < 0) {
+        return 1;
+    }
+    /* a clock change in between leaves the window too */
+    if (QSPI_Set_Speed(QSPI_INIT_SPEED) == 0) {
+        printf("QSPI_Set_Speed failed\r\n");
+        return 1;
+    }
+    if (expect("QSPI_Set_Speed", false, 0X6B, 3) < 0) {
+        return 1;
+    }
+    /* indirect reads work again after the window */
+    if (verify("Verify", 0XEB, MODE_1_4_4, 6, 3) < 0) {
+        return 1;
+    }
+    QSPI_Send_CMD(0X0B, PAGE_ADDR, MODE_1_1_1, 8);
+    memset(readback, 0, sizeof(readback));
+    if ((QSPI_Receive(readback, sizeof(readback)) != 0) || (memcmp(readback, page, sizeof(readback)) != 0)) {
+        printf("indirect read after Verify failed\r\n");
+        return 1;
+    }
+    if (expect("indirect read after Verify", false, 0X0B, 4) < 0) {
+        return 1;
+    }
+    /* UnInit leaves the part mapped for the debugger */
+    if (verify("UnInit", 0XEB, MODE_1_4_4, 6, 4) < 0) {
+        return 1;
+    }
+
+    /* the model has to catch a switch without the abort, or the checks above prove nothing */
+    QUADSPI->CCR = (QUADSPI->CCR & ~(3UL << 26)) & ~0XFFUL;
+    (void)QUADSPI->SR;
+    if (qspi_model_stats.errors != 1) {
+        printf("CCR written while mapped and BUSY was taken\r\n");
+        return 1;
+    }
+    printf("done\r\n");
+    return 0;
+}
@@ -0,0 +1,397 @@
+/*
+ * Copyright (c) 2024, sakumisu
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <string.h>
+#include "sys.h"
+
+#define QSPI_SR_TEF    (1U << 0)
+#define QSPI_SR_TCF    (1U << 1)
+#define QSPI_SR_FTF    (1U << 2)
+#define QSPI_SR_SMF    (1U << 3)
+#define QSPI_SR_TOF    (1U << 4)
+#define QSPI_SR_BUSY   (1U << 5)
+#define QSPI_SR_STICKY (QSPI_SR_TEF | QSPI_SR_TCF | QSPI_SR_SMF | QSPI_SR_TOF)
+
+#define QSPI_CR_ABORT  (1U << 1)
+#define QSPI_CR_DMAEN  (1U << 2)
+#define QSPI_CR_TCEN   (1U << 3)
+
+#define DMA_SxCR_EN    (1U << 0)
+#define DMA_HISR_TCIF7 (1U << 27)
+
+#define QSPI_CCR_FMODE(ccr) (((ccr) >> 26) & 3U)
+#define QSPI_CCR_DMODE(ccr) (((ccr) >> 24) & 3U)
+
+enum qspi_model_state {
+    QSPI_MODEL_IDLE,
+    QSPI_MODEL_READ,
+    QSPI_MODEL_WRITE,
+    QSPI_MODEL_MAPPED,
+};
+
+struct qspi_model {
+    struct qspi_model_regs regs;
+    uint32_t ccr;              /* CCR as last seen, a different value is a new command */
+    enum qspi_model_state state;
+    uint32_t addr;
+    uint32_t total;            /* DLR + 1 of the running transfer */
+    uint32_t bus;              /* bytes moved between the FIFO and the flash */
+    uint32_t fifo_done;        /* bytes moved between the FIFO and the driver */
+    uint8_t fifo[QSPI_MODEL_FIFO_SIZE];
+    uint32_t fifo_head;
+    uint32_t level;
+    bool map_busy;             /* the window was read, nCS stays low until an abort */
+    bool dma_on;               /* stream 7 enabled */
+    uint32_t dma_done;         /* bytes written since it was enabled */
+    uint32_t seed;
+};
+
+static struct qspi_model model;
+
+uint8_t qspi_model_mem[QSPI_MODEL_MEM_SIZE];
+struct qspi_model_stats qspi_model_stats;
+struct qspi_model_cache_op qspi_model_cache_log[QSPI_MODEL_CACHE_LOG];
+uint32_t qspi_model_cache_ops;
+
+RCC_TypeDef host_rcc;
+GPIO_TypeDef host_gpio[9];
+DMA_TypeDef host_dma2;
+DMA_Stream_TypeDef host_dma2_stream7;
+SCB_Type host_scb;
+uint32_t SystemCoreClock = 208000000;
+
+void GPIO_Set(GPIO_TypeDef *GPIOx, u32 BITx, u32 MODE, u32 OTYPE, u32 OSPEED, u32 PUPD)
+{
+}
+
+void GPIO_AF_Set(GPIO_TypeDef *GPIOx, u8 BITx, u8 AFx)
+{
+}
+
+static uint32_t qspi_model_random(uint32_t range)
+{
+    model.seed = model.seed * 1103515245U + 12345U;
+    return (model.seed >> 16) % range;
+}
+
+static uint32_t qspi_model_threshold(void)
+{
+    return ((model.regs.CR >> 8) & 0x1FU) + 1U;
+}
+
+static void qspi_model_update_sr(void)
+{
+    uint32_t sr = model.regs.SR & QSPI_SR_STICKY;
+    uint32_t ccr = model.ccr;
+
+    switch (model.state) {
+        case QSPI_MODEL_READ:
+            if ((model.level >= qspi_model_threshold()) || ((model.bus == model.total) && model.level)) {
+                sr |= QSPI_SR_FTF;
+            }
+            sr |= QSPI_SR_BUSY;
+            break;
+        case QSPI_MODEL_WRITE:
+            if ((QSPI_MODEL_FIFO_SIZE - model.level) >= qspi_model_threshold()) {
+                sr |= QSPI_SR_FTF;
+            }
+            sr |= QSPI_SR_BUSY;
+            break;
+        case QSPI_MODEL_MAPPED:
+            if (model.map_busy) {
+                sr |= QSPI_SR_BUSY;
+            }
+            break;
+        default:
+            /* an indirect write waits for its first data with an empty FIFO */
+            if ((QSPI_CCR_FMODE(ccr) == 0) && QSPI_CCR_DMODE(ccr)) {
+                sr |= QSPI_SR_FTF;
+            }
+            break;
+    }
+    model.regs.SR = sr | (model.level << 8);
+}
+
+/* the flash side of an indirect read, up to n bytes into the FIFO */
+static void qspi_model_fill(uint32_t n)
+{
+    uint32_t room = QSPI_MODEL_FIFO_SIZE - model.level;
+    uint32_t tail;
+
+    if (n > room) {
+        n = room;
+    }
+    if (n > model.total - model.bus) {
+        n = model.total - model.bus;
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        tail = (model.fifo_head + model.level) % QSPI_MODEL_FIFO_SIZE;
+        model.fifo[tail] = qspi_model_mem[(model.addr + model.bus) % QSPI_MODEL_MEM_SIZE];
+        model.level++;
+        model.bus++;
+    }
+    if (n && (model.bus == model.total)) {
+        model.regs.SR |= QSPI_SR_TCF;
+    }
+}
+
+/* the flash side of an indirect write, up to n bytes out of the FIFO */
+static void qspi_model_drain(uint32_t n)
+{
+    if (n > model.level) {
+        n = model.level;
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        qspi_model_mem[(model.addr + model.bus) % QSPI_MODEL_MEM_SIZE] = model.fifo[model.fifo_head];
+        model.fifo_head = (model.fifo_head + 1U) % QSPI_MODEL_FIFO_SIZE;
+        model.level--;
+        model.bus++;
+    }
+    if (model.bus == model.total) {
+        model.regs.SR |= QSPI_SR_TCF;
+        model.state = QSPI_MODEL_IDLE;
+    }
+}
+
+/* the bus moves between two register accesses, never behind the back of a driver working off one FLEVEL */
+static void qspi_model_clock(void)
+{
+    if (model.state == QSPI_MODEL_READ) {
+        qspi_model_fill(qspi_model_random(QSPI_MODEL_FIFO_SIZE + 1U));
+    } else if (model.state == QSPI_MODEL_WRITE) {
+        qspi_model_drain(qspi_model_random(QSPI_MODEL_FIFO_SIZE + 1U));
+    }
+}
+
+static void qspi_model_start(uint32_t fmode)
+{
+    model.state = QSPI_MODEL_IDLE;
+    model.addr = model.regs.AR;
+    model.total = model.regs.DLR + 1U;
+    model.bus = 0;
+    model.fifo_done = 0;
+    model.fifo_head = 0;
+    model.level = 0;
+    if (fmode == 1U) {
+        model.state = QSPI_MODEL_READ;
+    } else if (fmode == 0U) {
+        model.state = QSPI_MODEL_WRITE;
+    }
+}
+
+static void qspi_model_command(void)
+{
+    uint32_t ccr = model.regs.CCR;
+
+    if ((model.state == QSPI_MODEL_READ) || (model.state == QSPI_MODEL_WRITE) || model.map_busy) {
+        /* the hardware ignores CCR while BUSY, the driver has to wait or abort first */
+        qspi_model_stats.errors++;
+        model.regs.CCR = model.ccr;
+        return;
+    }
+    model.ccr = ccr;
+    if (QSPI_CCR_FMODE(ccr) == 3U) {
+        model.state = QSPI_MODEL_MAPPED;
+        model.map_busy = false;
+        qspi_model_stats.maps++;
+    } else if (QSPI_CCR_FMODE(ccr) == 2U) {
+        /* automatic polling, the status matches on the first read and APMS stops it */
+        model.state = QSPI_MODEL_IDLE;
+        model.regs.DR = model.regs.PSMAR;
+        model.regs.SR |= QSPI_SR_SMF;
+        qspi_model_stats.polls++;
+    } else if (QSPI_CCR_FMODE(ccr) == 1U) {
+        qspi_model_start(1U);
+    } else if ((QSPI_CCR_FMODE(ccr) == 0U) && !QSPI_CCR_DMODE(ccr)) {
+        /* instruction and address only, done by the time anyone looks */
+        model.state = QSPI_MODEL_IDLE;
+        model.regs.SR |= QSPI_SR_TCF;
+        qspi_model_stats.commands++;
+    } else {
+        /* an indirect write waits for its data */
+        model.state = QSPI_MODEL_IDLE;
+    }
+}
+
+void qspi_model_reset(uint32_t seed)
+{
+    memset(&model, 0, sizeof(model));
+    memset(&qspi_model_stats, 0, sizeof(qspi_model_stats));
+    memset(&host_dma2, 0, sizeof(host_dma2));
+    memset(&host_dma2_stream7, 0, sizeof(host_dma2_stream7));
+    qspi_model_cache_ops = 0;
+    model.seed = seed;
+}
+
+static void qspi_model_abort(void)
+{
+    model.regs.CR &= ~QSPI_CR_ABORT;
+    /* CCR is kept, with FMODE 3 the next CPU read would map again */
+    model.state = (QSPI_CCR_FMODE(model.ccr) == 3U) ? QSPI_MODEL_MAPPED : QSPI_MODEL_IDLE;
+    model.map_busy = false;
+    model.fifo_head = 0;
+    model.level = 0;
+    model.regs.SR |= QSPI_SR_TCF;
+    qspi_model_stats.aborts++;
+}
+
+/* DMA2 stream 7 serving the QUADSPI request of an indirect read, what the FIFO holds at this moment */
+static void qspi_model_dma(void)
+{
+    DMA_Stream_TypeDef *stream = &host_dma2_stream7;
+    uint8_t *dst = (uint8_t *)(uintptr_t)stream->M0AR;
+    uint32_t width = (((stream->CR >> 11) & 3U) == 2U) ? 4U : 1U;
+
+    if (host_dma2.HIFCR) {
+        host_dma2.HISR &= ~host_dma2.HIFCR;
+        host_dma2.HIFCR = 0;
+    }
+    if (!(stream->CR & DMA_SxCR_EN)) {
+        model.dma_on = false;
+        return;
+    }
+    if (!model.dma_on) {
+        model.dma_on = true;
+        model.dma_done = 0;
+    }
+    if (!(model.regs.CR & QSPI_CR_DMAEN) || (model.state != QSPI_MODEL_READ) || (((stream->CR >> 6) & 3U) != 0)) {
+        return;
+    }
+    while (stream->NDTR && (model.level >= width)) {
+        for (uint32_t i = 0; i < width; i++) {
+            dst[model.dma_done++] = model.fifo[model.fifo_head];
+            model.fifo_head = (model.fifo_head + 1U) % QSPI_MODEL_FIFO_SIZE;
+            model.level--;
+        }
+        model.fifo_done += width;
+        qspi_model_stats.dma_bytes += width;
+        stream->NDTR--;
+    }
+    if (model.fifo_done == model.total) {
+        model.state = QSPI_MODEL_IDLE;
+    }
+    if (stream->NDTR == 0) {
+        stream->CR &= ~DMA_SxCR_EN;
+        host_dma2.HISR |= DMA_HISR_TCIF7;
+        model.dma_on = false;
+    }
+}
+
+struct qspi_model_regs *qspi_model_sync(void)
+{
+    qspi_model_stats.accesses++;
+    if (model.regs.CR & QSPI_CR_ABORT) {
+        qspi_model_abort();
+    }
+    if (model.regs.FCR) {
+        model.regs.SR &= ~(model.regs.FCR & QSPI_SR_STICKY);
+        model.regs.FCR = 0;
+    }
+    if (model.regs.CCR != model.ccr) {
+        qspi_model_command();
+    }
+    qspi_model_clock();
+    qspi_model_dma();
+    qspi_model_update_sr();
+    return &model.regs;
+}
+
+DMA_TypeDef *qspi_model_dma2(void)
+{
+    qspi_model_sync();
+    return &host_dma2;
+}
+
+DMA_Stream_TypeDef *qspi_model_dma2_stream7(void)
+{
+    qspi_model_sync();
+    return &host_dma2_stream7;
+}
+
+void qspi_model_cache(uint8_t op, uint32_t *addr, int32_t size)
+{
+    if (qspi_model_cache_ops < QSPI_MODEL_CACHE_LOG) {
+        qspi_model_cache_log[qspi_model_cache_ops].op = op;
+        qspi_model_cache_log[qspi_model_cache_ops].addr = (uintptr_t)addr;
+        qspi_model_cache_log[qspi_model_cache_ops].size = size;
+    }
+    qspi_model_cache_ops++;
+}
+
+bool qspi_model_mapped(void)
+{
+    return model.state == QSPI_MODEL_MAPPED;
+}
+
+int qspi_model_map_read(uint32_t addr, void *buf, uint32_t len)
+{
+    /* the window is on the same bus, what the driver wrote last applies first */
+    qspi_model_sync();
+    if ((model.state != QSPI_MODEL_MAPPED) || (addr + len > QSPI_MODEL_MEM_SIZE)) {
+        qspi_model_stats.errors++;
+        return -1;
+    }
+    memcpy(buf, &qspi_model_mem[addr], len);
+    /* with the timeout counter off the controller keeps the read going, BUSY until an abort */
+    model.map_busy = !(model.regs.CR & QSPI_CR_TCEN);
+    qspi_model_update_sr();
+    return 0;
+}
+
+uint32_t qspi_model_fifo_read(uint8_t width)
+{
+    uint32_t value = 0;
+
+    if ((model.state != QSPI_MODEL_READ) || (model.level < width) || (model.fifo_done + width > model.total)) {
+        qspi_model_stats.errors++;
+        return 0;
+    }
+    for (uint8_t i = 0; i < width; i++) {
+        value |= (uint32_t)model.fifo[model.fifo_head] << (8U * i);
+        model.fifo_head = (model.fifo_head + 1U) % QSPI_MODEL_FIFO_SIZE;
+        model.level--;
+    }
+    model.fifo_done += width;
+    if (width == 4U) {
+        qspi_model_stats.fifo_words++;
+    } else {
+        qspi_model_stats.fifo_bytes++;
+    }
+    if (model.fifo_done == model.total) {
+        model.state = QSPI_MODEL_IDLE;
+    }
+    qspi_model_update_sr();
+    return value;
+}
+
+void qspi_model_fifo_write(uint32_t value, uint8_t width)
+{
+    uint32_t tail;
+
+    if ((model.state == QSPI_MODEL_IDLE) && (QSPI_CCR_FMODE(model.ccr) == 0U) && QSPI_CCR_DMODE(model.ccr)) {
+        qspi_model_start(0U);
+    }
+    if ((model.state != QSPI_MODEL_WRITE) || (model.level + width > QSPI_MODEL_FIFO_SIZE) ||
+        (model.fifo_done + width > model.total)) {
+        qspi_model_stats.errors++;
+        return;
+    }
+    for (uint8_t i = 0; i < width; i++) {
+        tail = (model.fifo_head + model.level) % QSPI_MODEL_FIFO_SIZE;
+        model.fifo[tail] = (uint8_t)(value >> (8U * i));
+        model.level++;
+    }
+    model.fifo_done += width;
+    if (width == 4U) {
+        qspi_model_stats.fifo_words++;
+    } else {
+        qspi_model_stats.fifo_bytes++;
+    }
+    /* the last byte in lets the controller finish on its own */
+    if (model.fifo_done == model.total) {
+        qspi_model_drain(model.level);
+    }
+    qspi_model_update_sr();
+}
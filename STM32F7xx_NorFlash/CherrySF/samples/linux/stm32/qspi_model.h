@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2024, sakumisu
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef QSPI_MODEL_H
+#define QSPI_MODEL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Host model of the STM32F7 QUADSPI register block, enough to run
+ * HARDWARE/QSPI/qspi.c unmodified on Linux. The stub stm32f7xx.h next to
+ * this file turns every QUADSPI-> access into a call to qspi_model_sync(),
+ * which applies what the driver wrote since the previous access before
+ * handing out the registers again:
+ *
+ * - FCR clears the flags it names and reads back as 0.
+ * - a new CCR value starts the command it describes. Writing the same
+ *   value again is not seen, as the model only compares against the last
+ *   one; the driver never repeats a CCR between two transfers that need it.
+ * - an indirect read fetches DLR+1 bytes from qspi_model_mem at AR into the
+ *   32-byte FIFO, a random number of them on each register access.
+ * - an indirect write with a data phase starts on its first FIFO write and
+ *   drains a random number of bytes into qspi_model_mem on each register
+ *   access, all of them once the last byte is in.
+ * - FMODE 3 maps qspi_model_mem, qspi_model_map_read() stands in for the
+ *   CPU reading 0x90000000. After a read the controller stays BUSY while
+ *   the timeout counter (TCEN) is off, as it does to keep nCS low for the
+ *   next access. ABORT ends that read, a CCR with another FMODE ends
+ *   memory-mapped mode.
+ * - FMODE 2 matches on the first status read: SMF is set and DR holds
+ *   PSMAR.
+ * - ABORT in CR stops whatever runs, empties the FIFO, sets TCF and reads
+ *   back as 0 on the next access. CCR keeps its value.
+ * - a CCR written while BUSY is refused and counted as an error.
+ *
+ * - DMA2 stream 7, reached through DMA2 and DMA2_Stream7, empties the
+ *   FIFO of an indirect read into memory at M0AR while it is enabled and
+ *   DMAEN is set in CR, a word or a byte per NDTR as the peripheral width
+ *   says. At NDTR 0 it sets TCIF7 and turns itself off, HIFCR clears the
+ *   flags. The driver keeps addresses in u32, so DMA buffers have to lie
+ *   in the low 4 GB of the host.
+ * - cache maintenance is not simulated, every clean or invalidate is
+ *   logged in qspi_model_cache_log for the test to check the range.
+ *
+ * SR reports FLEVEL, FTF, TCF and BUSY from that state and FTHRES in CR.
+ * The FIFO itself is reached through the QSPI_FIFO_* hooks of qspi.c, a
+ * word or byte access the FIFO cannot take at that moment (reading more
+ * than FLEVEL, writing past 32 bytes or past DLR) is counted in
+ * qspi_model_stats.errors rather than stalling as the hardware would.
+ */
+
+#define QSPI_MODEL_MEM_SIZE (64U * 1024U)
+#define QSPI_MODEL_FIFO_SIZE (32U)
+#define QSPI_MODEL_CACHE_LOG (64U)
+
+struct qspi_model_regs {
+    volatile uint32_t CR;
+    volatile uint32_t DCR;
+    volatile uint32_t SR;
+    volatile uint32_t FCR;
+    volatile uint32_t DLR;
+    volatile uint32_t CCR;
+    volatile uint32_t AR;
+    volatile uint32_t ABR;
+    volatile uint32_t DR;
+    volatile uint32_t PSMKR;
+    volatile uint32_t PSMAR;
+    volatile uint32_t PIR;
+    volatile uint32_t LPTR;
+};
+
+struct qspi_model_stats {
+    uint64_t accesses;   /* register accesses, SR polls included */
+    uint64_t fifo_words;
+    uint64_t fifo_bytes;
+    uint64_t commands;   /* indirect commands without a data phase */
+    uint64_t polls;      /* automatic polling commands */
+    uint64_t maps;       /* CCR writes that entered memory-mapped mode */
+    uint64_t aborts;
+    uint64_t dma_bytes;  /* moved out of the FIFO by DMA */
+    uint64_t errors;
+};
+
+/* one SCB_*DCache_by_Addr call: 0 clean, 1 clean and invalidate, 2 invalidate, as QSPI_DMA_Cache() */
+struct qspi_model_cache_op {
+    uint8_t op;
+    uintptr_t addr;
+    int32_t size;
+};
+
+extern uint8_t qspi_model_mem[QSPI_MODEL_MEM_SIZE];
+extern struct qspi_model_stats qspi_model_stats;
+extern struct qspi_model_cache_op qspi_model_cache_log[QSPI_MODEL_CACHE_LOG];
+extern uint32_t qspi_model_cache_ops; /* logged since the test last cleared it, the log keeps the first ones */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* registers to their reset values, FIFO empty, stats cleared; seed drives the FIFO pace */
+void qspi_model_reset(uint32_t seed);
+struct qspi_model_regs *qspi_model_sync(void);
+/* true while CCR has the controller in memory-mapped mode, aborted or not */
+bool qspi_model_mapped(void);
+/* a CPU read of the memory-mapped window, fails unless mapped */
+int qspi_model_map_read(uint32_t addr, void *buf, uint32_t len);
+uint32_t qspi_model_fifo_read(uint8_t width);
+void qspi_model_fifo_write(uint32_t value, uint8_t width);
+void qspi_model_cache(uint8_t op, uint32_t *addr, int32_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2024, sakumisu
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef __SYS_H
+#define __SYS_H
+
+#include <stdint.h>
+#include "qspi_model.h"
+
+/*
+ * Stands in for HARDWARE/sys/sys.h and the CMSIS device header when
+ * HARDWARE/QSPI/qspi.c is built on the host. QUADSPI and its FIFO, DMA2
+ * stream 7 and the cache maintenance calls go to qspi_model.c, the clock
+ * and GPIO registers are plain memory nobody looks at.
+ */
+
+typedef uint32_t u32;
+typedef uint16_t u16;
+typedef uint8_t u8;
+
+typedef volatile uint32_t vu32;
+typedef volatile uint16_t vu16;
+typedef volatile uint8_t vu8;
+
+typedef enum {
+    DMA2_Stream7_IRQn = 70,
+    QUADSPI_IRQn = 92,
+} IRQn_Type;
+
+typedef struct {
+    volatile uint32_t AHB1ENR;
+    volatile uint32_t AHB3ENR;
+    volatile uint32_t AHB3RSTR;
+} RCC_TypeDef;
+
+typedef struct {
+    volatile uint32_t MODER;
+    volatile uint32_t OTYPER;
+    volatile uint32_t OSPEEDR;
+    volatile uint32_t PUPDR;
+    volatile uint32_t AFR[2];
+} GPIO_TypeDef;
+
+typedef struct {
+    volatile uint32_t LISR;
+    volatile uint32_t HISR;
+    volatile uint32_t LIFCR;
+    volatile uint32_t HIFCR;
+} DMA_TypeDef;
+
+typedef struct {
+    volatile uint32_t CR;
+    volatile uint32_t NDTR;
+    volatile uint32_t PAR;
+    volatile uint32_t M0AR;
+    volatile uint32_t M1AR;
+    volatile uint32_t FCR;
+} DMA_Stream_TypeDef;
+
+typedef struct {
+    volatile uint32_t CCR;
+} SCB_Type;
+
+typedef struct qspi_model_regs QUADSPI_TypeDef;
+
+extern RCC_TypeDef host_rcc;
+extern GPIO_TypeDef host_gpio[9];
+extern DMA_TypeDef host_dma2;
+extern DMA_Stream_TypeDef host_dma2_stream7;
+extern SCB_Type host_scb;
+extern uint32_t SystemCoreClock;
+
+DMA_TypeDef *qspi_model_dma2(void);
+DMA_Stream_TypeDef *qspi_model_dma2_stream7(void);
+
+#define RCC          (&host_rcc)
+#define GPIOA        (&host_gpio[0])
+#define GPIOB        (&host_gpio[1])
+#define GPIOC        (&host_gpio[2])
+#define GPIOD        (&host_gpio[3])
+#define GPIOE        (&host_gpio[4])
+#define GPIOF        (&host_gpio[5])
+#define DMA2         (qspi_model_dma2())
+#define DMA2_Stream7 (qspi_model_dma2_stream7())
+#define SCB          (&host_scb)
+#define QUADSPI      (qspi_model_sync())
+
+#define SCB_CCR_DC_Msk (1UL << 16)
+
+#define GPIO_MODE_AF    2
+#define GPIO_SPEED_100M 3
+#define GPIO_PUPD_PU    1
+#define GPIO_OTYPE_PP   0
+
+#define QSPI_FIFO_RD32(reg)     ((void)(reg), qspi_model_fifo_read(4))
+#define QSPI_FIFO_RD8(reg)      ((void)(reg), (uint8_t)qspi_model_fifo_read(1))
+#define QSPI_FIFO_WR32(reg, v)  ((void)(reg), qspi_model_fifo_write((v), 4))
+#define QSPI_FIFO_WR8(reg, v)   ((void)(reg), qspi_model_fifo_write((v), 1))
+
+void GPIO_AF_Set(GPIO_TypeDef *GPIOx, u8 BITx, u8 AFx);
+void GPIO_Set(GPIO_TypeDef *GPIOx, u32 BITx, u32 MODE, u32 OTYPE, u32 OSPEED, u32 PUPD);
+
+static inline void NVIC_EnableIRQ(IRQn_Type irq)
+{
+    (void)irq;
+}
+
+static inline void SCB_CleanDCache_by_Addr(uint32_t *addr, int32_t size)
+{
+    qspi_model_cache(0, addr, size);
+}
+
+static inline void SCB_CleanInvalidateDCache_by_Addr(uint32_t *addr, int32_t size)
+{
+    qspi_model_cache(1, addr, size);
+}
+
+static inline void SCB_InvalidateDCache_by_Addr(uint32_t *addr, int32_t size)
+{
+    qspi_model_cache(2, addr, size);
+}
+
+#endif
@@ -0,0 +1,239 @@
+/*
+ * Copyright (c) 2024, sakumisu
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdlib.h>
+#include <pthread.h>
+#include "chry_sflash_norflash.h"
+#include "chry_sflash_port_linux.h"
+
+/*
+ * One thread keeps erasing 64 KB blocks while another reads small
+ * records from a different region of the same part, every millisecond
+ * or so. The run is done twice, once waiting every read out behind the
+ * erase and once suspending the erase for it, and prints the virtual
+ * read latency and the time the erases took. A last run reads 64 KB
+ * back to back with the erase timeout cut below erase plus read time,
+ * time spent suspended must not count against it.
+ *
+ *   suspend_test [image file]
+ */
+
+#define FLASH_SIZE   (16U * 1024U * 1024U)
+#define ERASE_ADDR   (0U)
+#define ERASE_SIZE   (64U * 1024U)
+#define ERASE_COUNT  (8U)
+#define READ_ADDR    (8U * 1024U * 1024U)
+#define READ_SIZE    (256U)
+#define READ_SPAN    (64U * 1024U)
+#define THINK_US     (1000U)  /* application work between two reads */
+
+struct chry_sflash_linux_nor nor;
+struct chry_sflash_norflash flash;
+struct chry_sflash_host spi_host;
+
+uint8_t pattern[READ_SPAN];
+
+static volatile bool erase_done;
+static int erase_ret;
+static uint64_t erase_ns;
+static uint64_t erase_worst_ns;
+static uint32_t read_size;
+static uint32_t read_think_us;
+
+struct read_result {
+    uint64_t count;
+    uint64_t total_ns;
+    uint64_t worst_ns;
+    int ret;
+};
+
+static uint64_t now_ns(void)
+{
+    uint64_t ns;
+
+    chry_sflash_lock(&spi_host);
+    ns = nor.now_ns;
+    chry_sflash_unlock(&spi_host);
+    return ns;
+}
+
+static void *eraser_run(void *arg)
+{
+    uint64_t start = now_ns();
+    uint64_t one;
+
+    erase_worst_ns = 0;
+    for (uint32_t i = 0; i < ERASE_COUNT; i++) {
+        one = now_ns();
+        erase_ret = chry_sflash_norflash_erase(&flash, ERASE_ADDR + (i % 4U) * ERASE_SIZE, ERASE_SIZE);
+        if (erase_ret < 0) {
+            printf("erase ret:%d\r\n", erase_ret);
+            break;
+        }
+        one = now_ns() - one;
+        if (one > erase_worst_ns) {
+            erase_worst_ns = one;
+        }
+    }
+    erase_ns = now_ns() - start;
+    erase_done = true;
+    return NULL;
+}
+
+static void *reader_run(void *arg)
+{
+    struct read_result *result = arg;
+    static uint8_t rbuff[READ_SPAN];
+    uint32_t offset = 0;
+    uint64_t arrival;
+    uint64_t done;
+    uint64_t ns;
+
+    /*
+     * The clock only moves with bus traffic, mostly the eraser's. The reader stays queued on the
+     * bus lock while it waits for its next read, the ticket lock then lets the eraser at most one
+     * turn between two looks at the clock, as a thread woken by a timer would be.
+     */
+    arrival = now_ns() + read_think_us * 1000U;
+    while (!erase_done) {
+        chry_sflash_lock(&spi_host);
+        if (nor.now_ns < arrival) {
+            chry_sflash_unlock(&spi_host);
+            continue;
+        }
+        result->ret = chry_sflash_norflash_read(&flash, READ_ADDR + offset, rbuff, read_size);
+        done = nor.now_ns;
+        chry_sflash_unlock(&spi_host);
+
+        ns = done - arrival;
+        arrival = done + read_think_us * 1000U;
+        if (result->ret < 0) {
+            printf("read ret:%d\r\n", result->ret);
+            break;
+        }
+        if (memcmp(rbuff, &pattern[offset], read_size) != 0) {
+            printf("read 0x%08X: data error\r\n", READ_ADDR + offset);
+            result->ret = -CHRY_SFLASH_ERR_IO;
+            break;
+        }
+        result->count++;
+        result->total_ns += ns;
+        if (ns > result->worst_ns) {
+            result->worst_ns = ns;
+        }
+        offset = (offset + read_size) % READ_SPAN;
+    }
+    return NULL;
+}
+
+static int run(bool suspend, uint32_t size, uint32_t think_us)
+{
+    struct read_result result = { 0 };
+    pthread_t eraser;
+    pthread_t reader;
+    uint64_t suspends = nor.stats.suspends;
+    uint8_t check[256];
+
+    flash.suspend_enable = suspend;
+    read_size = size;
+    read_think_us = think_us;
+    erase_done = false;
+    pthread_create(&reader, NULL, reader_run, &result);
+    pthread_create(&eraser, NULL, eraser_run, NULL);
+    pthread_join(eraser, NULL);
+    pthread_join(reader, NULL);
+
+    if ((erase_ret < 0) || (result.ret < 0) || (result.count == 0)) {
+        return -1;
+    }
+    /* the erases still have to have happened in full */
+    for (uint32_t addr = ERASE_ADDR; addr < ERASE_ADDR + 4U * ERASE_SIZE; addr += sizeof(check)) {
+        chry_sflash_norflash_read(&flash, addr, check, sizeof(check));
+        for (uint32_t i = 0; i < sizeof(check); i++) {
+            if (check[i] != 0xFF) {
+                printf("erase 0x%08X: not erased\r\n", addr + i);
+                return -1;
+            }
+        }
+    }
+
+    printf("suspend %s: %llu reads of %u B, latency avg %.1f us worst %.1f us, %u erases %.1f ms worst %.1f ms, %llu suspends\r\n",
+           suspend ? "on " : "off", (unsigned long long)result.count, size,
+           (double)result.total_ns / (double)result.count / 1000.0, (double)result.worst_ns / 1000.0,
+           ERASE_COUNT, (double)erase_ns / 1000000.0, (double)erase_worst_ns / 1000000.0,
+           (unsigned long long)(nor.stats.suspends - suspends));
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = (argc > 1) ? argv[1] : "suspend.img";
+    bool can_suspend;
+    uint32_t timeout_ms = 0;
+    int ret;
+
+    ret = chry_sflash_linux_nor_open(&nor, path, FLASH_SIZE);
+    if (ret < 0) {
+        printf("open %s ret:%d\r\n", path, ret);
+        return 1;
+    }
+
+    memset(&spi_host, 0, sizeof(spi_host));
+    spi_host.iomode = CHRY_SFLASH_IOMODE_QUAD;
+    spi_host.user_data = &nor;
+    chry_sflash_init(&spi_host);
+
+    ret = chry_sflash_norflash_init(&flash, &spi_host);
+    if (ret < 0) {
+        printf("norflash init ret:%d\r\n", ret);
+        return 1;
+    }
+    can_suspend = flash.suspend_enable;
+    printf("erase suspend %02Xh resume %02Xh latency %u us interval %u us, program latency %u us interval %u us\r\n",
+           flash.suspend[0].suspend_cmd, flash.suspend[0].resume_cmd, flash.suspend[0].latency_us,
+           flash.suspend[0].interval_us, flash.suspend[1].latency_us, flash.suspend[1].interval_us);
+    if (!can_suspend) {
+        printf("suspend not available\r\n");
+        return 1;
+    }
+
+    for (uint32_t i = 0; i < READ_SPAN; i++) {
+        pattern[i] = (uint8_t)rand();
+    }
+    ret = chry_sflash_norflash_erase(&flash, READ_ADDR, READ_SPAN);
+    if (ret == 0) {
+        ret = chry_sflash_norflash_write(&flash, READ_ADDR, pattern, READ_SPAN);
+    }
+    if (ret < 0) {
+        printf("prepare ret:%d\r\n", ret);
+        return 1;
+    }
+
+    if ((run(false, READ_SIZE, THINK_US) < 0) || (run(true, READ_SIZE, THINK_US) < 0)) {
+        return 1;
+    }
+
+    /* the reader keeps the erase suspended for longer than its timeout leaves on top of the erase itself */
+    for (uint32_t i = 0; i < flash.erase_type_count; i++) {
+        if (flash.erase_types[i].size == ERASE_SIZE) {
+            timeout_ms = nor.timing.block64_erase_us / 1000U * 3U / 2U;
+            flash.erase_types[i].timeout_ms = timeout_ms;
+        }
+    }
+    if (run(true, READ_SPAN, 0) < 0) {
+        return 1;
+    }
+    if (erase_worst_ns <= timeout_ms * 1000000ULL) {
+        printf("erase %.1f ms did not outlast its %u ms timeout\r\n", (double)erase_worst_ns / 1000000.0, timeout_ms);
+        return 1;
+    }
+
+    printf("ignored_busy:%llu ignored_wel:%llu protocol_errors:%llu\r\n",
+           (unsigned long long)nor.stats.ignored_busy, (unsigned long long)nor.stats.ignored_wel,
+           (unsigned long long)nor.stats.protocol_errors);
+    chry_sflash_linux_nor_close(&nor);
+    printf("done\r\n");
+    return 0;
+}
@@ -24,20 +24,48 @@
  
 #include "FlashOS.H"        // FlashOS Structures
 
+/*
+   Define FLM_BLOCK_ERASE (C/C++ -> Define) to build the block erase variant.
+   Its sector table comes from FlashLayout.h, generated by
+   tools/gen_flashlayout.py from the part's SFDP erase types.
+
+   Define FLM_DUAL for two parts on BK1/BK2 in dual-flash mode: size and
+   sectors are those of the pair (use gen_flashlayout.py --dual).
+ */
+#ifdef FLM_BLOCK_ERASE
+#include "FlashLayout.h"
+#endif
+
 
 struct FlashDevice const FlashDevice  =  {
    FLASH_DRV_VERS,             // Driver Version, do not modify!
+#ifdef FLM_BLOCK_ERASE
+   FLASH_LAYOUT_NAME,          // Device Name
+#else
    "STM32F7_NORFLASH",   		// Device Name 
+#endif
    EXTSPI,                     // Device Type
    0x90000000,                 // Device Start Address
+#ifdef FLM_BLOCK_ERASE
+   FLASH_LAYOUT_SIZE,          // Device Size in Bytes
+#elif defined(FLM_DUAL)
+   0x02000000,                 // Device Size in Bytes (2 x 16M)
+#else
    0x01000000,                 // Device Size in Bytes (16M)
+#endif
    4096,                       // Programming Page Size
    0,                          // Reserved, must be 0
    0xFF,                       // Initial Content of Erased Memory
    1000,                        // Program Page Timeout 100 mSec
-   3000,                       // Erase Sector Timeout 3000 mSec
+   200000,                     // Erase Sector/Chip Timeout 200 Sec (W25Q128 tCE max)
 
 // Specify Size and Address of Sectors
+#ifdef FLM_BLOCK_ERASE
+   FLASH_LAYOUT_SECTORS
+#elif defined(FLM_DUAL)
+   0x002000, 0x000000,         // Sector Size  8kB (4kB in each part)
+#else
    0x001000, 0x000000,         // Sector Size  4kB (8 Sectors)
+#endif
    SECTOR_END
 };
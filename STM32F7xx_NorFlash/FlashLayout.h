@@ -0,0 +1,15 @@
+/*
+ * Generated by tools/gen_flashlayout.py, do not edit.
+ * Erase types: 4KB(0x20) 32KB(0x52) 64KB(0xD8)
+ */
+#ifndef FLASH_LAYOUT_H
+#define FLASH_LAYOUT_H
+
+#define FLASH_LAYOUT_NAME      "STM32F7_NORFLASH_BLOCK"
+#define FLASH_LAYOUT_SIZE      0x01000000
+
+#define FLASH_LAYOUT_SECTORS \
+   0x001000, 0x000000,         /* 16 x 4KB, erase 0x20 */ \
+   0x010000, 0x010000,         /* 255 x 64KB, erase 0xD8 */
+
+#endif
@@ -23,11 +23,19 @@
  */
  
 #include "FlashOS.H"        // FlashOS Structures
+#include <stddef.h>
 #include "sys.h"
 #include "qspi.h"
 #include "chry_sflash_norflash.h"
 
 #define PAGE_SIZE            4096
+#ifdef FLM_DUAL
+#define AUX_BUF_SIZE         (PAGE_SIZE * 2)   /* one 8 KB sector of the pair */
+#else
+#define AUX_BUF_SIZE         PAGE_SIZE
+#endif
+
+extern struct FlashDevice const FlashDevice;   // FlashDev.c
 /* 
    Mandatory Flash Programming Functions (Called by FlashOS):
                 int Init        (unsigned long adr,   // Initialize Flash
@@ -61,21 +69,178 @@
  *                    fnc:  Function Code (1 - Erase, 2 - Program, 3 - Verify)
  *    Return Value:   0 - OK,  1 - Failed
  */
-uint8_t aux_buf[PAGE_SIZE] ;
+uint8_t aux_buf[AUX_BUF_SIZE] __attribute__((aligned(4)));
 uint32_t base_adr;
 static struct chry_sflash_norflash   flash;
 static struct chry_sflash_host spi_host;
+
+#ifdef FLM_DIFFERENTIAL
+/* Differential mode statistics, watch them in the debugger after a download */
+volatile uint32_t diff_skipped_sectors;
+volatile uint32_t diff_programmed_sectors;
+volatile uint32_t diff_erased_sectors;
+#endif
+
+#ifdef QSPI_FIFO_BENCH
+/*
+ * Polled FIFO benchmark: Init reads aux_buf from the start of the part
+ * without DMA, byte and word FIFO access at each threshold, and leaves
+ * the DWT cycle counts here for the debugger ([i][0] byte, [i][1] word).
+ */
+static const uint8_t fifo_bench_thres[] = { 1, 4, 8, 16, 32 };
+volatile uint32_t fifo_bench_cycles[sizeof(fifo_bench_thres)][2];
+
+static void fifo_bench (void) {
+    struct chry_sflash_request req = { 0 };
+    uint32_t start;
+
+    /* the read chry_sflash_norflash_read issues, minus the DMA it asks for at this length */
+    req.addr_phase.addr_size = flash.addr_size;
+    if (flash.cmd_mode == CHRY_SFLASH_CMDMODE_4LINES) {
+        req.cmd_phase.cmd = flash.qpi_read_cmd;
+        req.cmd_phase.cmd_mode = CHRY_SFLASH_CMDMODE_4LINES;
+        req.addr_phase.addr_mode = CHRY_SFLASH_ADDRMODE_4LINES;
+        req.dummy_phase.dummy_bytes = flash.qpi_read_dummy_bytes;
+        req.data_phase.data_mode = CHRY_SFLASH_DATAMODE_4LINES;
+    } else {
+        req.cmd_phase.cmd = flash.read_cmd;
+        req.cmd_phase.cmd_mode = CHRY_SFLASH_CMDMODE_1LINES;
+        req.addr_phase.addr_mode = flash.read_addr_mode;
+        req.dtr_enable = flash.read_dtr;
+        req.dummy_phase.dummy_bytes = flash.read_dummy_bytes;
+        req.data_phase.data_mode = flash.read_data_mode;
+    }
+    req.data_phase.direction = CHRY_SFLASH_DATA_READ;
+    req.data_phase.buf = aux_buf;
+    req.data_phase.len = sizeof(aux_buf);
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    for (uint32_t i = 0; i < sizeof(fifo_bench_thres); i++) {
+        QSPI_Wait_Flag(1<<5,0,0XFFFF);
+        QUADSPI->CR = (QUADSPI->CR & ~(0X1FUL << 8)) | ((uint32_t)(fifo_bench_thres[i] - 1) << 8);
+        for (uint8_t word = 0; word < 2; word++) {
+            QSPI_FIFO_Word = word;
+            start = DWT->CYCCNT;
+            if (chry_sflash_transfer(&spi_host, &req) < 0) {
+                start = DWT->CYCCNT;                   /* 0 marks a failed read */
+            }
+            fifo_bench_cycles[i][word] = DWT->CYCCNT - start;
+        }
+    }
+    QSPI_FIFO_Word = 1;
+    QSPI_Wait_Flag(1<<5,0,0XFFFF);
+    QUADSPI->CR = (QUADSPI->CR & ~(0X1FUL << 8)) | ((uint32_t)(QSPI_FIFO_THRESHOLD - 1) << 8);
+}
+#endif
+
+/*
+ * Keil calls Init/UnInit once per phase (erase, program, verify). The
+ * parsed SFDP parameters are kept in RAM between phases and reused as long
+ * as the signature, checksum and JEDEC ID still match.
+ */
+#define FLASH_CACHE_SIGNATURE   0x464C4D43UL           /* "CMLF" */
+
+struct flash_cache {
+    uint32_t signature;
+    uint8_t jedec_id[4];
+    struct chry_sflash_norflash flash;
+    uint32_t checksum;
+};
+
+static struct flash_cache flash_cache;
+
+static uint32_t flash_cache_checksum (void) {
+    const uint8_t *p = (const uint8_t *)&flash_cache;
+    uint32_t sum = 0;
+    uint32_t i;
+
+    for (i = 0; i < offsetof(struct flash_cache, checksum); i++) {
+        sum = (sum << 1 | sum >> 31) + p[i];
+    }
+    return sum;
+}
+
+static int flash_cache_restore (void) {
+    uint8_t jedec_id[4] = { 0 };
+
+    if (flash_cache.signature != FLASH_CACHE_SIGNATURE ||
+        flash_cache.checksum != flash_cache_checksum()) {
+        return -1;
+    }
+
+    flash = flash_cache.flash;
+    flash.host = &spi_host;
+
+    /* make sure the same part is still attached */
+    if (chry_sflash_norflash_read_jedec_id(&flash, jedec_id, 3) < 0 ||
+        memcmp(jedec_id, flash_cache.jedec_id, sizeof(jedec_id)) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+static void flash_cache_store (void) {
+    memset(&flash_cache, 0, sizeof(flash_cache));
+    if (chry_sflash_norflash_read_jedec_id(&flash, flash_cache.jedec_id, 3) < 0) {
+        return;
+    }
+    flash_cache.flash = flash;
+    flash_cache.signature = FLASH_CACHE_SIGNATURE;
+    flash_cache.checksum = flash_cache_checksum();
+}
+
 int Init (unsigned long adr, unsigned long clk, unsigned long fnc) {
 	base_adr = adr;	
-	if(fnc == 1){
-		memset(&flash,0,sizeof(flash));
-		memset(&spi_host,0,sizeof(spi_host));		
-		spi_host.spi_idx = 0;
-		spi_host.iomode = CHRY_SFLASH_IOMODE_QUAD;
-		QSPI_Init();	
-		chry_sflash_init(&spi_host);
-		chry_sflash_norflash_init(&flash, &spi_host);	
+#ifdef FLM_DIFFERENTIAL
+	if (fnc == 2) {
+		diff_skipped_sectors = 0;
+		diff_programmed_sectors = 0;
+		diff_erased_sectors = 0;
+	}
+#endif
+	memset(&spi_host,0,sizeof(spi_host));		
+	spi_host.spi_idx = 0;
+	spi_host.iomode = CHRY_SFLASH_IOMODE_QUAD;
+#ifdef FLM_DTR
+	/* EDh reads for Verify; many parts flag DTR clocking in SFDP without implementing it, so opt in */
+	spi_host.dtr_enable = true;
+#endif
+#ifdef FLM_QPI
+	/* 4-4-4 commands for the small ProgramPage/status transfers; UnInit drops back to SPI */
+	spi_host.qpi_enable = true;
+#endif
+#ifdef FLM_DUAL
+	/* two W25Q on BK1/BK2, FlashDev.c describes the 32 MB pair */
+	spi_host.dual_flash = true;
+#endif
+	if (Sys_Clock_Set(208,8,2,9) != 0) {          // 208 MHz from HSI, QSPI runs at HCLK/2 = 104 MHz
+		return (1);                                // PLL or overdrive failed, still on 16 MHz HSI
+	}
+	QSPI_Init();	
+	QSPI_Set_Dual(spi_host.dual_flash);           // chry_sflash_init sets it too, the cache restore path skips that
+
+	if (flash_cache_restore() == 0) {
+		if (chry_sflash_set_frequency(&spi_host, flash.max_frequency) < 0 ||
+		    chry_sflash_norflash_enter_qpi(&flash) < 0) {
+			return (1);
+		}
+#ifdef QSPI_FIFO_BENCH
+		fifo_bench();
+#endif
+		return (0);                                // Reuse SFDP parameters of previous phase
+	}
+
+	memset(&flash,0,sizeof(flash));
+	chry_sflash_init(&spi_host);
+	if (chry_sflash_norflash_init(&flash, &spi_host) < 0) {
+		flash_cache.signature = 0;
+		return (1);
 	}
+	flash_cache_store();
+#ifdef QSPI_FIFO_BENCH
+	fifo_bench();
+#endif
   return (0);                                  // Finished without Errors
 }
 
@@ -87,9 +252,21 @@ int Init (unsigned long adr, unsigned long clk, unsigned long fnc) {
  */
 
 int UnInit (unsigned long fnc) {
+  void *map;
 
+  /* Finish a page program left running by ProgramPage and leave QPI */
+  if (chry_sflash_norflash_deinit(&flash) < 0) {
+    return (1);
+  }
+  /* Next phase finds the part back in SPI mode */
+  if (flash_cache.signature == FLASH_CACHE_SIGNATURE) {
+    flash_cache_store();
+  }
 
-  /* Add your Code */
+  /* Leave the part memory mapped so the debugger can read it */
+  if (chry_sflash_norflash_memory_map(&flash, &map) < 0) {
+    return (1);
+  }
   return (0);                                  // Finished without Errors
 }
 
@@ -101,11 +278,30 @@ int UnInit (unsigned long fnc) {
 
 int EraseChip (void) {
 
-  /* Add your Code */
+  if (chry_sflash_norflash_erase_chip(&flash) < 0) {
+    return (1);                                // Timeout or transfer error
+  }
   return (0);                                  // Finished without Errors
 }
 
 
+/*
+ *  Size of the sector starting at offset, as described in FlashDev.c
+ */
+
+static unsigned long SectorSize (unsigned long offset) {
+  const struct FlashSectors *s = FlashDevice.sectors;
+  unsigned long size = s->szSector;
+
+  /* Sector table is sorted, the last region starting at or below offset wins */
+  while (s->szSector != 0xFFFFFFFF && s->AddrSector <= offset) {
+    size = s->szSector;
+    s++;
+  }
+  return size;
+}
+
+
 /*
  *  Erase Sector in Flash Memory
  *    Parameter:      adr:  Sector Address
@@ -113,9 +309,12 @@ int EraseChip (void) {
  */
 
 int EraseSector (unsigned long adr) {
+  unsigned long offset = adr - base_adr;
 
-  /* Add your Code */
-	chry_sflash_norflash_erase(&flash,adr - base_adr, PAGE_SIZE);
+  /* Erase as much as FlashDev.c describes, a 64 KB region uses block erase */
+  if (chry_sflash_norflash_erase(&flash, offset, SectorSize(offset)) < 0) {
+    return (1);
+  }
   return (0);                                  // Finished without Errors
 }
 /*
@@ -127,8 +326,34 @@ int EraseSector (unsigned long adr) {
  */
 
 int BlankCheck (unsigned long adr, unsigned long sz, unsigned char pat) {
+    uint32_t i;
+    uint32_t *word = (uint32_t *)aux_buf;
+    uint32_t pattern = pat * 0x01010101UL;
+    uint32_t offset = adr - base_adr;
 
-	return (1);                                        /* Always Force Erase */
+    while (sz) {
+        uint32_t chunk = sz > sizeof(aux_buf) ? sizeof(aux_buf) : sz;
+
+        if (chry_sflash_norflash_read(&flash, offset, aux_buf, chunk) < 0) {
+            return (1);                                /* Force Erase on read error */
+        }
+
+        for (i = 0; i < chunk / 4; i++) {
+            if (word[i] != pattern) {
+                return (1);                            /* Not blank, erase needed */
+            }
+        }
+        for (i = chunk & ~3UL; i < chunk; i++) {
+            if (aux_buf[i] != pat) {
+                return (1);
+            }
+        }
+
+        offset += chunk;
+        sz -= chunk;
+    }
+
+    return (0);                                        /* Blank, skip Erase */
 }
 
 /*
@@ -139,8 +364,80 @@ int BlankCheck (unsigned long adr, unsigned long sz, unsigned char pat) {
  *    Return Value:   0 - OK,  1 - Failed
  */
 
+#ifdef FLM_DIFFERENTIAL
+/*
+   Differential mode, use with "Do not Erase" in the download options.
+   Every sector touched by ProgramPage is read back first:
+     - same content           -> skipped, no erase and no program
+     - only 1 -> 0 changes    -> programmed without erase
+     - anything else          -> merged in aux_buf, erased and reprogrammed
+   The counters in diff_* are reset when the program phase starts.
+ */
+
+static int ProgramSectorDiff (uint32_t offset, uint32_t n, const unsigned char *buf) {
+    uint32_t sector = offset - offset % flash.sector_size;
+    uint32_t in = offset - sector;
+    uint32_t i;
+
+    if (flash.sector_size > sizeof(aux_buf)) {
+        return -1;
+    }
+    if (chry_sflash_norflash_read(&flash, sector, aux_buf, flash.sector_size) < 0) {
+        return -1;
+    }
+
+    if (memcmp(&aux_buf[in], buf, n) == 0) {
+        diff_skipped_sectors++;
+        return 0;
+    }
+
+    for (i = 0; i < n; i++) {
+        if ((aux_buf[in + i] & buf[i]) != buf[i]) {
+            break;
+        }
+    }
+    if (i == n) {
+        diff_programmed_sectors++;
+        return chry_sflash_norflash_write_nowait(&flash, offset, (uint8_t *)buf, n);
+    }
+
+    /* keep the rest of the sector, only the new bytes change */
+    memcpy(&aux_buf[in], buf, n);
+    if (chry_sflash_norflash_erase(&flash, sector, flash.sector_size) < 0) {
+        return -1;
+    }
+    diff_erased_sectors++;
+    return chry_sflash_norflash_write_nowait(&flash, sector, aux_buf, flash.sector_size);
+}
+#endif
+
 int ProgramPage (unsigned long adr, unsigned long sz, unsigned char *buf) {
-   chry_sflash_norflash_write(&flash, adr - base_adr,buf , sz);
+
+#ifdef FLM_DIFFERENTIAL
+  uint32_t offset = adr - base_adr;
+
+  while (sz) {
+    uint32_t n = flash.sector_size - offset % flash.sector_size;
+
+    if (n > sz) {
+      n = sz;
+    }
+    if (ProgramSectorDiff(offset, n, buf) < 0) {
+      return (1);
+    }
+    offset += n;
+    buf += n;
+    sz -= n;
+  }
+#else
+  /*
+     The last page is left programming while the debugger downloads the next
+     buffer, the busy wait happens at the start of the next flash access.
+   */
+  if (chry_sflash_norflash_write_nowait(&flash, adr - base_adr, buf, sz) < 0) {
+    return (1);
+  }
+#endif
   return (0);                                  // Finished without Errors
 }
 /*  
@@ -152,29 +449,35 @@ int ProgramPage (unsigned long adr, unsigned long sz, unsigned char *buf) {
  */
 
 /*
-   Verify function is obsolete because all other function leave 
-    the SPIFI in memory mode so a memory compare could be used.
+   Verify compares directly against the memory mapped QUADSPI window,
+    no copy through aux_buf is needed.
  */
 unsigned long Verify (unsigned long adr, unsigned long sz, unsigned char *buf) {
-    uint32_t i;
+    void *map;
+    const uint8_t *mem;
 
-    uint32_t offset = adr - base_adr;
-
-    while (sz) {
-        uint32_t chunk = sz > PAGE_SIZE ? PAGE_SIZE : sz;
-
-        chry_sflash_norflash_read(&flash, offset,aux_buf, chunk);  
+    if (chry_sflash_norflash_memory_map(&flash, &map) < 0) {
+        return (adr);
+    }
+    mem = (const uint8_t *)map + (adr - base_adr);
 
-        for (i = 0; i < chunk; i++) {
-            if (aux_buf[i] != buf[i]) {
-                return adr + i;  
-            }
+    if ((((uintptr_t)mem | (uintptr_t)buf) & 3) == 0) {
+        while (sz >= 4 && *(const uint32_t *)mem == *(const uint32_t *)buf) {
+            mem += 4;
+            buf += 4;
+            adr += 4;
+            sz -= 4;
         }
+    }
 
-        offset += chunk;
-        buf += chunk;
-        adr += chunk;
-        sz -= chunk;
+    while (sz) {
+        if (*mem != *buf) {
+            return adr;
+        }
+        mem++;
+        buf++;
+        adr++;
+        sz--;
     }
 
     return (adr);  
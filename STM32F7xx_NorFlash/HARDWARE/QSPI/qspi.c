@@ -1,23 +1,38 @@
 #include "qspi.h"
 //////////////////////////////////////////////////////////////////////////////////	 
-//ֻѧϰʹãδɣκ;
-//ALIENTEK STM32 
-//QSPI 	   
-//ԭ@ALIENTEK
-//̳:www.openedv.com
-//:2016/7/18
-//汾V1.0
-//ȨУؾ
-//Copyright(C) ӿƼ޹˾ 2014-2024
+//本程序只供学习使用，未经作者许可，不得用于其它任何用途
+//ALIENTEK STM32开发板 
+//QSPI 驱动代码	   
+//正点原子@ALIENTEK
+//技术论坛:www.openedv.com
+//创建日期:2016/7/18
+//版本：V1.0
+//版权所有，盗版必究。
+//Copyright(C) 广州市星翼电子科技有限公司 2014-2024
 //All rights reserved									  
 ////////////////////////////////////////////////////////////////////////////////// 	 
 
-//ȴ״̬־
-//flag:Ҫȴı־λ
-//sta:Ҫȴ״̬
-//wtime:ȴʱ
-//ֵ:0,ȴɹ.
-//	     1,ȴʧ.
+u8 QSPI_MMAP_Sta=0;		//内存映射模式状态;0,间接模式;1,内存映射模式
+
+#ifdef QSPI_FIFO_BENCH
+u8 QSPI_FIFO_Word=1;		//查询方式的FIFO访问宽度,见qspi.h
+#endif
+
+//查询方式访问FIFO(DR寄存器),reg为DR的地址
+//主机上的寄存器模型在包含本文件前重新定义它们
+#ifndef QSPI_FIFO_RD32
+#define QSPI_FIFO_RD32(reg)		(*(reg))
+#define QSPI_FIFO_RD8(reg)		(*(vu8 *)(reg))
+#define QSPI_FIFO_WR32(reg,v)	(*(reg)=(v))
+#define QSPI_FIFO_WR8(reg,v)	(*(vu8 *)(reg)=(v))
+#endif
+
+//等待状态标志
+//flag:需要等待的标志位
+//sta:需要等待的状态
+//wtime:等待时间
+//返回值:0,等待成功.
+//	     1,等待失败.
 u8 QSPI_Wait_Flag(u32 flag,u8 sta,u32 wtime)
 {
 	u8 flagsta=0;
@@ -31,18 +46,18 @@ u8 QSPI_Wait_Flag(u32 flag,u8 sta,u32 wtime)
 	else return 1;
 }
 
-//ʼQSPIӿ
-//ֵ:0,ɹ;
-//       1,ʧ;
+//初始化QSPI接口
+//返回值:0,成功;
+//       1,失败;
 u8 QSPI_Init(void)
 {
 	u32 tempreg=0;
-	RCC->AHB1ENR|=1<<1;    		//ʹPORTBʱ	   
-	RCC->AHB1ENR|=1<<5;    		//ʹPORTFʱ	   
-	RCC->AHB3ENR|=1<<1;   		//QSPIʱʹ
-	GPIO_Set(GPIOB,1<<2,GPIO_MODE_AF,GPIO_OTYPE_PP,GPIO_SPEED_100M,GPIO_PUPD_PU);	//PB2ù	
-	GPIO_Set(GPIOB,1<<6,GPIO_MODE_AF,GPIO_OTYPE_PP,GPIO_SPEED_100M,GPIO_PUPD_PU);	//PB6ù	
-	GPIO_Set(GPIOF,0XF<<6,GPIO_MODE_AF,GPIO_OTYPE_PP,GPIO_SPEED_100M,GPIO_PUPD_PU);	//PF6~9ù	
+	RCC->AHB1ENR|=1<<1;    		//使能PORTB时钟	   
+	RCC->AHB1ENR|=1<<5;    		//使能PORTF时钟	   
+	RCC->AHB3ENR|=1<<1;   		//QSPI时钟使能
+	GPIO_Set(GPIOB,1<<2,GPIO_MODE_AF,GPIO_OTYPE_PP,GPIO_SPEED_100M,GPIO_PUPD_PU);	//PB2复用功能输出	
+	GPIO_Set(GPIOB,1<<6,GPIO_MODE_AF,GPIO_OTYPE_PP,GPIO_SPEED_100M,GPIO_PUPD_PU);	//PB6复用功能输出	
+	GPIO_Set(GPIOF,0XF<<6,GPIO_MODE_AF,GPIO_OTYPE_PP,GPIO_SPEED_100M,GPIO_PUPD_PU);	//PF6~9复用功能输出	
    	GPIO_AF_Set(GPIOB,2,9);		//PB2,AF9
  	GPIO_AF_Set(GPIOB,6,10);	//PB6,AF10
  	GPIO_AF_Set(GPIOF,6,9);		//PF6,AF9 
@@ -50,159 +65,800 @@ u8 QSPI_Init(void)
  	GPIO_AF_Set(GPIOF,8,10);	//PF8,AF10
  	GPIO_AF_Set(GPIOF,9,10);	//PF9,AF10
 	
-	RCC->AHB3RSTR|=1<<1;		//λQSPI
-	RCC->AHB3RSTR&=~(1<<1);		//ֹͣλQSPI
-	if(QSPI_Wait_Flag(1<<5,0,0XFFFF)==0)//ȴBUSY
-	{
-		tempreg=(1-1)<<24;		//QSPIʱΪAHBʱӵ1,16M/1=16Mhz
-		tempreg|=(4-1)<<8;		//FIFOֵΪ4ֽ(Ϊ31,ʾ32ֽ)
-		tempreg|=0<<7;			//ѡFLASH1
-		tempreg|=0<<6;			//ֹ˫ģʽ
-		tempreg|=1<<4;			//λ(DDRģʽ,Ϊ0)
-		QUADSPI->CR=tempreg;	//CRĴ
-		tempreg=(24-1)<<16;		//FLASHСΪ2^24=16MB
-		tempreg|=(4-1)<<8;		//ƬѡߵƽʱΪ4ʱ(13.8*4=55.2ns),ֲtSHSL
-		tempreg|=1<<0;			//Mode3,ʱCLKΪߵƽ
-		QUADSPI->DCR=tempreg;	//DCRĴ
-		QUADSPI->CR|=1<<0;		//ʹQSPI
+	RCC->AHB3RSTR|=1<<1;		//复位QSPI
+	RCC->AHB3RSTR&=~(1<<1);		//停止复位QSPI
+	QSPI_MMAP_Sta=0;			//复位后处于间接模式
+	if(QSPI_Wait_Flag(1<<5,0,0XFFFF)==0)//等待BUSY空闲
+	{
+		tempreg=(QSPI_FIFO_THRESHOLD-1)<<8;	//设置FIFO阈值,见QSPI_FIFO_THRESHOLD
+		tempreg|=0<<7;			//选择FLASH1
+		tempreg|=0<<6;			//禁止双闪存模式,需要时由QSPI_Set_Dual开启
+		QUADSPI->CR=tempreg;	//设置CR寄存器
+		tempreg=(24-1)<<16;		//设置FLASH大小为2^24=16MB
+		tempreg|=1<<0;			//Mode3,空闲时CLK为高电平
+		QUADSPI->DCR=tempreg;	//设置DCR寄存器
+		QSPI_Set_Speed(QSPI_INIT_SPEED);//分频,采样移位和片选高电平时间
+		QUADSPI->CR|=1<<0;		//使能QSPI
 	}else return 1;
 	return 0;
 }
 
-//QSPI
-//cmd:Ҫ͵ָ
-//addr:͵Ŀĵַ
-//mode:ģʽ,ϸλ:
-//	mode[1:0]:ָģʽ;00,ָ;01,ߴָ;10,˫ߴָ;11,ߴָ.
-//	mode[3:2]:ַģʽ;00,޵ַ;01,ߴַ;10,˫ߴַ;11,ߴַ.
-//	mode[5:4]:ַ;00,8λַ;01,16λַ;10,24λַ;11,32λַ.
-//	mode[7:6]:ģʽ;00,;01,ߴ;10,˫ߴ;11,ߴ.
-//dmcycle:ָ
-void QSPI_Send_CMD(u8 cmd,u32 addr,u8 mode,u8 dmcycle)
+//设置QSPI时钟,取不超过freq的最高频率(QSPI时钟=HCLK/分频)
+//同时按新频率设置采样移位和片选高电平时间(tSHSL)
+//freq:目标频率(Hz)
+//返回值:实际频率,0表示设置失败
+u32 QSPI_Set_Speed(u32 freq)
+{
+	u32 div,csht,tempreg;
+	if(freq==0)return 0;
+	if(freq>QSPI_MAX_SPEED)freq=QSPI_MAX_SPEED;
+	div=(SystemCoreClock+freq-1)/freq;		//向上取整,保证不超过目标频率
+	if(div==0)div=1;
+	if(div>256)div=256;
+	freq=SystemCoreClock/div;
+	csht=((freq/1000000)*QSPI_CS_HIGH_NS+999)/1000;//片选高电平时间折算成时钟数
+	if(csht==0)csht=1;
+	if(csht>8)csht=8;
+	if(QSPI_MMAP_Sta)QSPI_Exit_MemoryMapped();	//内存映射模式下需先退出
+	if(QSPI_Wait_Flag(1<<5,0,0XFFFF))return 0;	//等待BUSY空闲
+	tempreg=QUADSPI->CR;
+	tempreg&=~(0XFFUL<<24);
+	tempreg|=(div-1)<<24;					//设置分频系数
+	tempreg|=1<<4;							//采样移位半个周期(DDR模式下,必须设置为0)
+	QUADSPI->CR=tempreg;
+	tempreg=QUADSPI->DCR;
+	tempreg&=~(7<<8);
+	tempreg|=(csht-1)<<8;					//设置片选高电平时间
+	QUADSPI->DCR=tempreg;
+	return freq;
+}
+
+//设置双闪存模式(DFM),两片FLASH并联,偶地址字节在FLASH1(BK1),奇地址字节在FLASH2(BK2)
+//两片共用CLK和片选(BK1_NCS),每片收到的地址为AR/2
+//en:0,单闪存模式;1,双闪存模式
+//返回值:0,成功;
+//       1,失败;
+u8 QSPI_Set_Dual(u8 en)
+{
+	u32 tempreg;
+	if(en)
+	{
+		RCC->AHB1ENR|=1<<4;    		//使能PORTE时钟
+		GPIO_Set(GPIOE,0XF<<7,GPIO_MODE_AF,GPIO_OTYPE_PP,GPIO_SPEED_100M,GPIO_PUPD_PU);	//PE7~10复用功能输出
+		GPIO_AF_Set(GPIOE,7,10);	//PE7,AF10,BK2_IO0
+		GPIO_AF_Set(GPIOE,8,10);	//PE8,AF10,BK2_IO1
+		GPIO_AF_Set(GPIOE,9,10);	//PE9,AF10,BK2_IO2
+		GPIO_AF_Set(GPIOE,10,10);	//PE10,AF10,BK2_IO3
+	}
+	if(QSPI_MMAP_Sta)QSPI_Exit_MemoryMapped();	//内存映射模式下需先退出
+	if(QSPI_Wait_Flag(1<<5,0,0XFFFF))return 1;	//等待BUSY空闲
+	QUADSPI->CR&=~(1<<0);					//修改DFM前先关闭QSPI
+	tempreg=QUADSPI->CR;
+	tempreg&=~(1<<6);
+	tempreg|=(u32)(en?1:0)<<6;				//设置双闪存模式
+	QUADSPI->CR=tempreg;
+	tempreg=QUADSPI->DCR;
+	tempreg&=~(0X1F<<16);
+	tempreg|=(u32)((en?25:24)-1)<<16;		//FLASH大小为两片之和,2^25=32MB
+	QUADSPI->DCR=tempreg;
+	QUADSPI->CR|=1<<0;						//使能QSPI
+	return 0;
+}
+
+//选择单闪存模式下访问的FLASH(FSEL),双闪存模式下无效
+//BK2的IO0~3为PE7~10,片选为PC11(BK2_NCS)
+//fsel:0,FLASH1(BK1);1,FLASH2(BK2)
+//返回值:0,成功;
+//       1,失败;
+u8 QSPI_Set_Flash(u8 fsel)
+{
+	u32 tempreg;
+	if(fsel)
+	{
+		RCC->AHB1ENR|=1<<2;    		//使能PORTC时钟
+		RCC->AHB1ENR|=1<<4;    		//使能PORTE时钟
+		GPIO_Set(GPIOC,1<<11,GPIO_MODE_AF,GPIO_OTYPE_PP,GPIO_SPEED_100M,GPIO_PUPD_PU);	//PC11复用功能输出
+		GPIO_Set(GPIOE,0XF<<7,GPIO_MODE_AF,GPIO_OTYPE_PP,GPIO_SPEED_100M,GPIO_PUPD_PU);	//PE7~10复用功能输出
+		GPIO_AF_Set(GPIOC,11,9);	//PC11,AF9,BK2_NCS
+		GPIO_AF_Set(GPIOE,7,10);	//PE7,AF10,BK2_IO0
+		GPIO_AF_Set(GPIOE,8,10);	//PE8,AF10,BK2_IO1
+		GPIO_AF_Set(GPIOE,9,10);	//PE9,AF10,BK2_IO2
+		GPIO_AF_Set(GPIOE,10,10);	//PE10,AF10,BK2_IO3
+	}
+	if(QSPI_MMAP_Sta)QSPI_Exit_MemoryMapped();	//内存映射模式下需先退出
+	if(QSPI_Wait_Flag(1<<5,0,0XFFFF))return 1;	//等待BUSY空闲
+	tempreg=QUADSPI->CR;
+	tempreg&=~(1<<7);
+	tempreg|=(u32)(fsel?1:0)<<7;			//选择FLASH
+	QUADSPI->CR=tempreg;
+	return 0;
+}
+
+//按DDR/SDR设置采样移位,调用前QSPI必须空闲
+//mode:定义同QSPI_Send_CMD,只看mode[8]
+static void QSPI_Set_DDR(u16 mode)
+{
+	if(mode&0X100)QUADSPI->CR&=~(1<<4);		//DDR模式下,采样移位必须设置为0
+	else QUADSPI->CR|=1<<4;					//SDR模式下采样移位半个周期
+}
+
+//写CCR/AR开始一次间接写模式的命令,不等待完成,参数同QSPI_Send_CMD
+//返回值:0,已开始
+//    其他,错误代码
+static u8 QSPI_Start_CMD(u8 cmd,u32 addr,u16 mode,u8 dmcycle)
 {
 	u32 tempreg=0;	
+	if(QSPI_MMAP_Sta)QSPI_Exit_MemoryMapped();	//内存映射模式下需先退出
+	if(QSPI_Wait_Flag(1<<5,0,0XFFFF))return 1;	//等待BUSY空闲
+	QSPI_Set_DDR(mode);
+	tempreg=((u32)(mode>>8)&0X01)<<31;	//设置DDR模式
+	tempreg|=((u32)(mode>>8)&0X01)<<30;	//DDR模式下数据输出延迟1/4周期(DHHC)
+	tempreg|=0<<28;						//每次都发送指令
+	tempreg|=0<<26;						//间接写模式
+	tempreg|=((u32)(mode>>6)&0X03)<<24;	//设置数据模式
+	tempreg|=(u32)dmcycle<<18;			//设置空指令周期数
+	tempreg|=((u32)(mode>>4)&0X03)<<12;	//设置地址长度
+	tempreg|=((u32)(mode>>2)&0X03)<<10;	//设置地址模式
+	tempreg|=((u32)(mode>>0)&0X03)<<8;	//设置指令模式
+	tempreg|=cmd;						//设置指令
+	QUADSPI->CCR=tempreg;				//设置CCR寄存器
+	if(mode&0X0C)						//有指令+地址要发送
+	{
+		QUADSPI->AR=addr;				//设置地址寄存器
+	} 
+	return 0;
+}
+
+//QSPI发送命令
+//cmd:要发送的指令
+//addr:发送到的目的地址
+//mode:模式,详细位定义如下:
+//	mode[1:0]:指令模式;00,无指令;01,单线传输指令;10,双线传输指令;11,四线传输指令.
+//	mode[3:2]:地址模式;00,无地址;01,单线传输地址;10,双线传输地址;11,四线传输地址.
+//	mode[5:4]:地址长度;00,8位地址;01,16位地址;10,24位地址;11,32位地址.
+//	mode[7:6]:数据模式;00,无数据;01,单线传输数据;10,双线传输数据;11,四线传输数据.
+//	mode[8]:DDR模式;0,SDR;1,地址/空周期/数据在双沿传输(指令仍为单沿).
+//dmcycle:空指令周期数
+//返回值:0,成功(有数据时为命令已开始,接着收发数据)
+//    其他,错误代码(BUSY或TCF等待超时,命令未发出,不能再收发数据)
+u8 QSPI_Send_CMD(u8 cmd,u32 addr,u16 mode,u8 dmcycle)
+{
 	u8 status;
-	if(QSPI_Wait_Flag(1<<5,0,0XFFFF)==0)	//ȴBUSY
-	{
-		tempreg=0<<31;						//ֹDDRģʽ
-		tempreg|=0<<28;						//ÿζָ
-		tempreg|=0<<26;						//дģʽ
-		tempreg|=((u32)mode>>6)<<24;		//ģʽ
-		tempreg|=(u32)dmcycle<<18;			//ÿָ
-		tempreg|=((u32)(mode>>4)&0X03)<<12;	//õַ
-		tempreg|=((u32)(mode>>2)&0X03)<<10;	//õַģʽ
-		tempreg|=((u32)(mode>>0)&0X03)<<8;	//ָģʽ
-		tempreg|=cmd;						//ָ
-		QUADSPI->CCR=tempreg;				//CCRĴ
-		if(mode&0X0C)						//ָ+ַҪ
-		{
-			QUADSPI->AR=addr;				//õַĴ
-		} 
-		if((mode&0XC0)==0)					//ݴ,ȴָ
+	status=QSPI_Start_CMD(cmd,addr,mode,dmcycle);
+	if(status)return status;
+	if((mode&0XC0)==0)						//无数据传输,等待指令发送完成
+	{
+		status=QSPI_Wait_Flag(1<<1,1,0XFFFF);//等待TCF,即传输完成
+		if(status==0)
 		{
-			status=QSPI_Wait_Flag(1<<1,1,0XFFFF);//ȴTCF,
-			if(status==0)
-			{
-				QUADSPI->FCR|=1<<1;			//TCF־λ 
-			}
+			QUADSPI->FCR|=1<<1;				//清除TCF标志位 
 		}
-	}	
+	}
+	return status;
 }
 
-//QSPIָȵ
-//buf:ݻ׵ַ
-//datalen:Ҫݳ
-//ֵ:0,
-//    ,
-u8 QSPI_Receive(u8* buf,u32 datalen)
+//QSPI进入内存映射模式,之后可直接从0X90000000读取FLASH内容
+//cmd:读指令
+//mode:模式,定义同QSPI_Send_CMD
+//dmcycle:空指令周期数
+//返回值:0,正常
+//    其他,错误代码
+u8 QSPI_MemoryMapped(u8 cmd,u16 mode,u8 dmcycle)
+{
+	u32 tempreg=0;	
+	tempreg=((u32)(mode>>8)&0X01)<<31;		//设置DDR模式
+	tempreg|=((u32)(mode>>8)&0X01)<<30;		//DDR模式下数据输出延迟1/4周期(DHHC)
+	tempreg|=0<<28;							//每次都发送指令
+	tempreg|=3<<26;							//内存映射模式
+	tempreg|=((u32)(mode>>6)&0X03)<<24;		//设置数据模式
+	tempreg|=(u32)dmcycle<<18;				//设置空指令周期数
+	tempreg|=((u32)(mode>>4)&0X03)<<12;		//设置地址长度
+	tempreg|=((u32)(mode>>2)&0X03)<<10;		//设置地址模式
+	tempreg|=((u32)(mode>>0)&0X03)<<8;		//设置指令模式
+	tempreg|=cmd;							//设置指令
+	if(QSPI_MMAP_Sta&&QUADSPI->CCR==tempreg)return 0;//已处于相同配置的内存映射模式
+	if(QSPI_MMAP_Sta)QSPI_Exit_MemoryMapped();//配置不同,先退出
+	if(QSPI_Wait_Flag(1<<5,0,0XFFFF))return 1;//等待BUSY空闲
+	QSPI_Set_DDR(mode);
+	QUADSPI->CR&=~(1<<3);					//禁止超时计数,保持片选有效以便连续读
+	QUADSPI->CCR=tempreg;					//设置CCR寄存器,进入内存映射模式
+	QSPI_MMAP_Sta=1;
+	return 0;
+}
+
+//QSPI退出内存映射模式,回到间接模式
+//返回值:0,正常
+//    其他,错误代码
+u8 QSPI_Exit_MemoryMapped(void)
+{
+	QUADSPI->CR|=1<<1;						//终止当前操作(ABORT)
+	while(QUADSPI->CR&(1<<1));				//等待ABORT完成
+	QSPI_MMAP_Sta=0;
+	return QSPI_Wait_Flag(1<<5,0,0XFFFF);	//等待BUSY位清零
+}
+
+//QSPI接收多段数据,各段在同一次传输中连续读取,不重新发送指令和地址
+//buf:各段缓冲区首地址
+//len:各段长度,总长度不能为0
+//cnt:段数
+//返回值:0,正常
+//    其他,错误代码
+u8 QSPI_Receive_Seg(u8* const* buf,const u32* len,u8 cnt)
 {
 	u32 tempreg=QUADSPI->CCR;
 	u32 addrreg=QUADSPI->AR; 	
-	u8 status;
+	u8 status=0;
+	u32 level,total=0,datalen;
+	u8 *dst;
+	u8 seg;
 	vu32 *data_reg=&QUADSPI->DR;
-	QUADSPI->DLR=datalen-1;					//ݴ䳤
-	tempreg&=~(3<<26);						//FMODEԭ
-	tempreg|=1<<26;							//FMODEΪӶȡģʽ
-	QUADSPI->FCR|=1<<1;						//TCF־λ
-	QUADSPI->CCR=tempreg;					//дCCRĴ
-	QUADSPI->AR=addrreg;					//дARĴ,
-	while(datalen)
+	for(seg=0;seg<cnt;seg++)total+=len[seg];
+	if(total==0)return 1;
+	seg=0;
+	dst=buf[0];
+	datalen=len[0];
+	QUADSPI->DLR=total-1;					//设置数据传输长度
+	tempreg&=~(3<<26);						//清除FMODE原来的设置
+	tempreg|=1<<26;							//设置FMODE为间接读取模式
+	QUADSPI->FCR|=1<<1;						//清除TCF标志位
+	QUADSPI->CCR=tempreg;					//回写CCR寄存器
+	QUADSPI->AR=addrreg;					//回写AR寄存器,触发传输
+	while(total)
 	{
-		status=QSPI_Wait_Flag(3<<1,1,0XFFFF);//ȵFTFTCF,յ
-		if(status==0)						//ȴɹ
+		status=QSPI_Wait_Flag(3<<1,1,0XFFFF);//等到FTF和TCF,即接收到了数据
+		if(status)break;					//等待失败
+		level=(QUADSPI->SR>>8)&0X3F;		//FIFO中已有的字节数
+		if(level==0)						//传输已完成但数据不够,出错
+		{
+			status=1;
+			break;
+		}
+		while(level&&total)
 		{
-			*buf++=*(vu8 *)data_reg;
-			datalen--;
-		}else break;
+			if(datalen==0)					//本段已满,切换到下一段
+			{
+				seg++;
+				dst=buf[seg];
+				datalen=len[seg];
+				continue;
+			}
+			if(QSPI_FIFO_Word&&level>=4&&datalen>=4&&((u32)dst&3)==0)//按字读取,未对齐的头尾按字节读取
+			{
+				*(u32 *)dst=QSPI_FIFO_RD32(data_reg);
+				dst+=4;
+				datalen-=4;
+				total-=4;
+				level-=4;
+			}else
+			{
+				*dst++=QSPI_FIFO_RD8(data_reg);
+				datalen--;
+				total--;
+				level--;
+			}
+		}
 	}
 	if(status==0)
 	{
-		QUADSPI->CR|=1<<2;							//ֹ 
-		status=QSPI_Wait_Flag(1<<1,1,0XFFFF);		//ȴTCF,ݴ
+		QUADSPI->CR&=~(1<<2);						//关闭DMA请求,与DMA传输结束后的状态一致
+		status=QSPI_Wait_Flag(1<<1,1,0XFFFF);		//等待TCF,即数据传输完成
 		if(status==0)
 		{
-			QUADSPI->FCR|=1<<1;						//TCF־λ 
-			status=QSPI_Wait_Flag(1<<5,0,0XFFFF);	//ȴBUSYλ
+			QUADSPI->FCR|=1<<1;						//清除TCF标志位 
+			status=QSPI_Wait_Flag(1<<5,0,0XFFFF);	//等待BUSY位清零
 		}
 	}
 	return status;
 } 
 
-//QSPIָȵ
-//buf:ݻ׵ַ
-//datalen:Ҫݳ
-//ֵ:0,
-//    ,
-u8 QSPI_Transmit(u8* buf,u32 datalen)
+//QSPI接收指定长度的数据
+//buf:接收数据缓冲区首地址
+//datalen:要传输的数据长度
+//返回值:0,正常
+//    其他,错误代码
+u8 QSPI_Receive(u8* buf,u32 datalen)
+{
+	return QSPI_Receive_Seg(&buf,&datalen,1);
+}
+
+//QSPI发送多段数据,各段在同一次传输中连续写入,不重新发送指令和地址
+//buf:各段缓冲区首地址
+//len:各段长度,总长度不能为0
+//cnt:段数
+//返回值:0,正常
+//    其他,错误代码
+u8 QSPI_Transmit_Seg(u8* const* buf,const u32* len,u8 cnt)
 {
 	u32 tempreg=QUADSPI->CCR;
-	u32 addrreg=QUADSPI->AR; 
-	u8 status;
+	u8 status=0;
+	u32 space,total=0,datalen;
+	u8 *src;
+	u8 seg;
 	vu32 *data_reg=&QUADSPI->DR;
-	QUADSPI->DLR=datalen-1;					//ݴ䳤
-	tempreg&=~(3<<26);						//FMODEԭ
-	tempreg|=0<<26;							//FMODEΪдģʽ
-	QUADSPI->FCR|=1<<1;						//TCF־λ
-	QUADSPI->CCR=tempreg;					//дCCRĴ 
-	while(datalen)
+	for(seg=0;seg<cnt;seg++)total+=len[seg];
+	if(total==0)return 1;
+	seg=0;
+	src=buf[0];
+	datalen=len[0];
+	QUADSPI->DLR=total-1;					//设置数据传输长度
+	tempreg&=~(3<<26);						//清除FMODE原来的设置
+	tempreg|=0<<26;							//设置FMODE为间接写入模式
+	QUADSPI->FCR|=1<<1;						//清除TCF标志位
+	QUADSPI->CCR=tempreg;					//回写CCR寄存器 
+	while(total)
 	{
-		status=QSPI_Wait_Flag(1<<2,1,0XFFFF);//ȵFTF
-		if(status!=0)						//ȴɹ
+		status=QSPI_Wait_Flag(1<<2,1,0XFFFF);//等到FTF
+		if(status!=0)						//等待失败
 		{
 			break;
 		}
-		*(vu8 *)data_reg=*buf++;
-		datalen--;
+		space=32-((QUADSPI->SR>>8)&0X3F);	//FIFO中的空闲字节数
+		while(space&&total)
+		{
+			if(datalen==0)					//本段已发完,切换到下一段
+			{
+				seg++;
+				src=buf[seg];
+				datalen=len[seg];
+				continue;
+			}
+			if(QSPI_FIFO_Word&&space>=4&&datalen>=4&&((u32)src&3)==0)//按字写入,未对齐的头尾按字节写入
+			{
+				QSPI_FIFO_WR32(data_reg,*(u32 *)src);
+				src+=4;
+				datalen-=4;
+				total-=4;
+				space-=4;
+			}else
+			{
+				QSPI_FIFO_WR8(data_reg,*src++);
+				datalen--;
+				total--;
+				space--;
+			}
+		}
 	}
 	if(status==0)
 	{
-		QUADSPI->CR|=1<<2;							//ֹ 
-		status=QSPI_Wait_Flag(1<<1,1,0XFFFF);		//ȴTCF,ݴ
+		QUADSPI->CR&=~(1<<2);						//关闭DMA请求,与DMA传输结束后的状态一致
+		status=QSPI_Wait_Flag(1<<1,1,0XFFFF);		//等待TCF,即数据传输完成
 		if(status==0)
 		{
-			QUADSPI->FCR|=1<<1;						//TCF־λ 
-			status=QSPI_Wait_Flag(1<<5,0,0XFFFF);	//ȴBUSYλ
+			QUADSPI->FCR|=1<<1;						//清除TCF标志位 
+			status=QSPI_Wait_Flag(1<<5,0,0XFFFF);	//等待BUSY位清零
 		}
 	}
 	return status;
 }
 
+//QSPI发送指定长度的数据
+//buf:发送数据缓冲区首地址
+//datalen:要传输的数据长度
+//返回值:0,正常
+//    其他,错误代码
+u8 QSPI_Transmit(u8* buf,u32 datalen)
+{
+	return QSPI_Transmit_Seg(&buf,&datalen,1);
+}
+
+//QSPI的DMA请求固定在DMA2数据流7,通道3
+//buf:存储器地址
+//datalen:传输长度(字节)
+//dir:0,外设到存储器(读);1,存储器到外设(写)
+//数据长度为4的整数倍时外设端按字访问DR,否则按字节访问
+static void QSPI_DMA_Config(u8* buf,u32 datalen,u8 dir)
+{
+	u32 tempreg=0;
+	RCC->AHB1ENR|=1<<22;					//DMA2时钟使能
+	DMA2_Stream7->CR&=~(1<<0);				//关闭数据流
+	while(DMA2_Stream7->CR&(1<<0));			//等待数据流可配置
+	DMA2->HIFCR=0X3D<<22;					//清除数据流7所有中断标志
+	DMA2_Stream7->PAR=(u32)&QUADSPI->DR;	//外设地址
+	DMA2_Stream7->M0AR=(u32)buf;			//存储器地址
+	tempreg=3<<25;							//通道3
+	tempreg|=2<<16;							//高优先级
+	tempreg|=1<<10;							//存储器地址递增
+	tempreg|=(u32)dir<<6;					//传输方向
+	if((datalen&3)==0)
+	{
+		DMA2_Stream7->NDTR=datalen/4;		//按字传输的次数
+		tempreg|=2<<11;						//外设数据宽度32位,存储器8位
+		DMA2_Stream7->FCR=(1<<2)|(3<<0);	//使能FIFO做位宽转换,阈值为满FIFO
+	}else
+	{
+		DMA2_Stream7->NDTR=datalen;			//按字节传输的次数
+		DMA2_Stream7->FCR=0;				//直接模式
+	}
+	DMA2_Stream7->CR=tempreg;
+}
+
+//等待DMA2数据流7传输完成
+//返回值:0,成功
+//    其他,错误代码
+static u8 QSPI_DMA_Wait(void)
+{
+	u32 wtime=0XFFFFFF;
+	while(wtime)
+	{
+		if(DMA2->HISR&(1<<25))break;		//传输错误
+		if(DMA2->HISR&(1<<27))break;		//传输完成
+		wtime--;
+	}
+	if(DMA2->HISR&(1<<27))return 0;
+	DMA2_Stream7->CR&=~(1<<0);				//出错或超时,关闭数据流
+	return 1;
+}
+
+//DMA传输结束,等待QSPI完成并关闭DMA请求
+//status:DMA传输的结果
+//返回值:0,正常
+//    其他,错误代码
+static u8 QSPI_DMA_Finish(u8 status)
+{
+	if(status==0)
+	{
+		status=QSPI_Wait_Flag(1<<1,1,0XFFFF);	//等待TCF,即数据传输完成
+		if(status==0)QUADSPI->FCR|=1<<1;		//清除TCF标志位
+	}
+	if(status)
+	{
+		QUADSPI->CR|=1<<1;						//出错,终止当前操作(ABORT)
+		while(QUADSPI->CR&(1<<1));
+	}
+	QUADSPI->CR&=~(1<<2);						//关闭QSPI的DMA请求
+	DMA2->HIFCR=0X3D<<22;						//清除数据流7所有中断标志
+	if(status)return status;
+	return QSPI_Wait_Flag(1<<5,0,0XFFFF);		//等待BUSY位清零
+}
 
+//D-Cache使能时,对buf所在的cache行做维护
+//op:0,写回(DMA读取存储器前);1,写回并无效(DMA写入存储器前);2,无效(DMA写入存储器后)
+//op为1和2时buf和datalen必须按QSPI_DMA_LINE对齐,否则会丢掉行内其他变量的改动
+static void QSPI_DMA_Cache(u8* buf,u32 datalen,u8 op)
+{
+	u32 start=(u32)buf&~(QSPI_DMA_LINE-1UL);
+	int32_t size=(int32_t)((((u32)buf+datalen+QSPI_DMA_LINE-1)&~(QSPI_DMA_LINE-1UL))-start);
+	if((SCB->CCR&SCB_CCR_DC_Msk)==0)return;	//D-Cache未开启
+	if(op==0)SCB_CleanDCache_by_Addr((u32*)start,size);
+	else if(op==1)SCB_CleanInvalidateDCache_by_Addr((u32*)start,size);
+	else SCB_InvalidateDCache_by_Addr((u32*)start,size);
+}
 
+//把接收缓冲区分成三部分,DMA只写中间对齐的整行
+//part[0]:头部不满一行的字节数;part[1]:整行的字节数;part[2]:尾部不满一行的字节数
+static void QSPI_DMA_Split(u8* buf,u32 datalen,u32* part)
+{
+	part[0]=(QSPI_DMA_LINE-((u32)buf&(QSPI_DMA_LINE-1)))&(QSPI_DMA_LINE-1);
+	if(part[0]>datalen)part[0]=datalen;
+	part[1]=(datalen-part[0])&~(QSPI_DMA_LINE-1UL);
+	part[2]=datalen-part[0]-part[1];
+}
 
+//在进行中的间接读取里,由CPU从FIFO读取datalen个字节,此时DMA请求须关闭
+//用于DMA接收时首尾不满一行的部分,每部分少于QSPI_DMA_LINE字节
+//返回值:0,正常
+//    其他,错误代码
+static u8 QSPI_FIFO_Read(u8* buf,u32 datalen)
+{
+	vu32 *data_reg=&QUADSPI->DR;
+	while(datalen)
+	{
+		if(QSPI_Wait_Flag(1<<2,1,0XFFFF))return 1;	//等待FTF,FIFO中有数据
+		*buf++=QSPI_FIFO_RD8(data_reg);
+		datalen--;
+	}
+	return 0;
+}
 
+//检查分段DMA的各段长度,每段1~0XFFFF字节
+//返回值:0,可以用DMA;1,需要用查询方式
+static u8 QSPI_DMA_Seg_Check(const u32* len,u8 cnt)
+{
+	u8 i;
+	for(i=0;i<cnt;i++)
+	{
+		if(len[i]==0||len[i]>0XFFFF)return 1;
+	}
+	return cnt==0;
+}
 
+//依次搬运各段数据,一段完成后重新配置DMA接着下一段
+//读时QSPI在FIFO满时暂停时钟,写时在FIFO空时暂停时钟,段间不会丢失数据
+//返回值:0,正常
+//    其他,错误代码
+static u8 QSPI_DMA_Chain(u8* const* buf,const u32* len,u8 cnt,u8 dir)
+{
+	u8 i=0;
+	u8 status;
+	while(1)
+	{
+		status=QSPI_DMA_Wait();
+		if(status||++i==cnt)break;
+		QSPI_DMA_Config(buf[i],len[i],dir);
+		DMA2_Stream7->CR|=1<<0;				//开启数据流,继续下一段
+	}
+	return QSPI_DMA_Finish(status);
+}
 
+//QSPI通过DMA接收多段数据,各段在同一次传输中连续读取
+//每段的整行由DMA写入,首尾不满一行的部分由CPU读取,QSPI在FIFO满时暂停时钟,切换时不会丢失数据
+//buf:各段缓冲区首地址
+//len:各段长度
+//cnt:段数
+//返回值:0,正常
+//    其他,错误代码
+u8 QSPI_Receive_DMA_Seg(u8* const* buf,const u32* len,u8 cnt)
+{
+	u32 tempreg=QUADSPI->CCR;
+	u32 addrreg=QUADSPI->AR; 	
+	u32 total=0;
+	u32 part[3];
+	u8 status=0,i;
+	if(QSPI_DMA_Seg_Check(len,cnt))return QSPI_Receive_Seg(buf,len,cnt);//超过NDTR范围,使用查询方式
+	for(i=0;i<cnt;i++)total+=len[i];
+	QUADSPI->DLR=total-1;					//设置数据传输长度
+	tempreg&=~(3<<26);						//清除FMODE原来的设置
+	tempreg|=1<<26;							//设置FMODE为间接读取模式
+	QUADSPI->FCR|=1<<1;						//清除TCF标志位
+	QUADSPI->CCR=tempreg;					//回写CCR寄存器
+	QUADSPI->AR=addrreg;					//回写AR寄存器,触发传输
+	for(i=0;i<cnt&&status==0;i++)
+	{
+		QSPI_DMA_Split(buf[i],len[i],part);
+		status=QSPI_FIFO_Read(buf[i],part[0]);	//头部
+		if(status==0&&part[1])
+		{
+			QSPI_DMA_Cache(buf[i]+part[0],part[1],1);//防止脏cache行在DMA期间写回覆盖数据
+			QSPI_DMA_Config(buf[i]+part[0],part[1],0);//外设到存储器
+			DMA2_Stream7->CR|=1<<0;			//开启数据流
+			QUADSPI->CR|=1<<2;				//使能QSPI的DMA请求
+			status=QSPI_DMA_Wait();
+			QUADSPI->CR&=~(1<<2);			//关闭DMA请求,尾部由CPU读取
+			QSPI_DMA_Cache(buf[i]+part[0],part[1],2);//丢弃DMA期间预取的旧数据
+		}
+		if(status==0)status=QSPI_FIFO_Read(buf[i]+part[0]+part[1],part[2]);//尾部
+	}
+	return QSPI_DMA_Finish(status);
+}
 
+//QSPI通过DMA接收指定长度的数据
+//buf:接收数据缓冲区首地址
+//datalen:要传输的数据长度
+//返回值:0,正常
+//    其他,错误代码
+u8 QSPI_Receive_DMA(u8* buf,u32 datalen)
+{
+	return QSPI_Receive_DMA_Seg(&buf,&datalen,1);
+}
 
+//QSPI通过DMA发送多段数据,各段在同一次传输中连续写入
+//buf:各段缓冲区首地址
+//len:各段长度
+//cnt:段数
+//返回值:0,正常
+//    其他,错误代码
+u8 QSPI_Transmit_DMA_Seg(u8* const* buf,const u32* len,u8 cnt)
+{
+	u32 tempreg=QUADSPI->CCR;
+	u32 total=0;
+	u8 i;
+	if(QSPI_DMA_Seg_Check(len,cnt))return QSPI_Transmit_Seg(buf,len,cnt);//超过NDTR范围,使用查询方式
+	for(i=0;i<cnt;i++)
+	{
+		QSPI_DMA_Cache(buf[i],len[i],0);	//把cache中的数据写回SRAM
+		total+=len[i];
+	}
+	QSPI_DMA_Config(buf[0],len[0],1);		//存储器到外设
+	QUADSPI->DLR=total-1;					//设置数据传输长度
+	tempreg&=~(3<<26);						//清除FMODE原来的设置
+	tempreg|=0<<26;							//设置FMODE为间接写入模式
+	QUADSPI->FCR|=1<<1;						//清除TCF标志位
+	QUADSPI->CCR=tempreg;					//回写CCR寄存器 
+	DMA2_Stream7->CR|=1<<0;					//开启数据流
+	QUADSPI->CR|=1<<2;						//使能QSPI的DMA请求,开始搬运数据
+	return QSPI_DMA_Chain(buf,len,cnt,1);
+}
 
+//QSPI通过DMA发送指定长度的数据
+//buf:发送数据缓冲区首地址
+//datalen:要传输的数据长度
+//返回值:0,正常
+//    其他,错误代码
+u8 QSPI_Transmit_DMA(u8* buf,u32 datalen)
+{
+	return QSPI_Transmit_DMA_Seg(&buf,&datalen,1);
+}
 
+//QSPI启动自动轮询模式,由硬件周期性读取状态寄存器,直到(状态&mask)==match
+//cmd:读状态指令
+//addr:状态寄存器地址(无地址时忽略)
+//mode:模式,定义同QSPI_Send_CMD,数据为1个字节
+//mask:状态屏蔽位
+//match:状态匹配值
+//interval:两次读取之间的时钟周期数
+//返回值:0,正常
+//    其他,错误代码
+u8 QSPI_AutoPolling_Start(u8 cmd,u32 addr,u16 mode,u8 mask,u8 match,u16 interval)
+{
+	u32 tempreg=0;
+	if(QSPI_MMAP_Sta)QSPI_Exit_MemoryMapped();	//内存映射模式下需先退出
+	if(QSPI_Wait_Flag(1<<5,0,0XFFFF))return 1;	//等待BUSY空闲
+	QSPI_Set_DDR(0);						//状态寄存器按SDR读取
+	if(QUADSPI->CR&(1<<6))					//双闪存模式,两片各返回1个字节
+	{
+		QUADSPI->DLR=1;						//每次读取2个字节
+		QUADSPI->PSMKR=((u32)mask<<8)|mask;	//两片状态用同样的屏蔽
+		QUADSPI->PSMAR=((u32)match<<8)|match;//两片都匹配才算匹配(AND模式)
+	}else
+	{
+		QUADSPI->DLR=0;						//每次读取1个字节
+		QUADSPI->PSMKR=mask;				//设置屏蔽寄存器
+		QUADSPI->PSMAR=match;				//设置匹配寄存器
+	}
+	QUADSPI->PIR=interval;					//设置轮询间隔
+	tempreg=QUADSPI->CR;
+	tempreg&=~(1<<23);						//AND匹配模式
+	tempreg|=1<<22;							//匹配后自动停止
+	QUADSPI->CR=tempreg;
+	QUADSPI->FCR|=1<<3;						//清除SMF标志位
+	tempreg=0<<31;							//禁止DDR模式
+	tempreg|=0<<28;							//每次都发送指令
+	tempreg|=2<<26;							//自动轮询模式
+	tempreg|=((u32)(mode>>6)&0X03)<<24;		//设置数据模式
+	tempreg|=((u32)(mode>>4)&0X03)<<12;		//设置地址长度
+	tempreg|=((u32)(mode>>2)&0X03)<<10;		//设置地址模式
+	tempreg|=((u32)(mode>>0)&0X03)<<8;		//设置指令模式
+	tempreg|=cmd;							//设置指令
+	QUADSPI->CCR=tempreg;					//设置CCR寄存器,无地址时开始轮询
+	if(mode&0X0C)QUADSPI->AR=addr;			//有地址时,写AR开始轮询
+	return 0;
+}
 
+//查询自动轮询是否已匹配
+//status:匹配时最后读到的状态值,可为NULL
+//返回值:0,已匹配,轮询已停止
+//    其他,尚未匹配
+u8 QSPI_AutoPolling_Done(u8 *status)
+{
+	if((QUADSPI->SR&(1<<3))==0)return 1;	//SMF未置位
+	if(status)*status=*(vu8 *)&QUADSPI->DR;	//最后一次读到的状态,双闪存模式下为FLASH1的状态
+	QUADSPI->FCR|=1<<3;						//清除SMF标志位
+	return QSPI_Wait_Flag(1<<5,0,0XFFFF);	//等待BUSY位清零
+}
 
+//终止自动轮询(超时等情况)
+void QSPI_AutoPolling_Stop(void)
+{
+	QUADSPI->CR|=1<<1;						//终止当前操作(ABORT)
+	while(QUADSPI->CR&(1<<1));				//等待ABORT完成
+	QUADSPI->FCR|=1<<3;						//清除SMF标志位
+}
 
+//中断方式传输完成回调,status:0,成功;其他,错误
+//在QUADSPI或DMA2数据流7中断里调用
+void (*QSPI_IT_Done)(u8 status)=0;
+static u8* QSPI_IT_Buf;						//中断方式DMA接收的缓冲区
+static u32 QSPI_IT_Part[3];					//中断方式DMA接收的三部分,见QSPI_DMA_Split
 
+//QSPI通过DMA接收指定长度的数据,不等待完成
+//头部不满一行的部分在这里由CPU读取,整行由DMA写入,尾部在DMA传输完成中断里读取,
+//之后调用QSPI_IT_Done.CPU读取的部分都少于QSPI_DMA_LINE字节
+//buf:接收数据缓冲区首地址
+//datalen:要传输的数据长度,1~0XFFFF,且至少含一个完整的cache行
+//返回值:0,已启动
+//    其他,错误代码
+u8 QSPI_Receive_DMA_IT(u8* buf,u32 datalen)
+{
+	u32 tempreg=QUADSPI->CCR;
+	u32 addrreg=QUADSPI->AR;
+	u32 *part=QSPI_IT_Part;
+	if(datalen==0||datalen>0XFFFF)return 1;
+	QSPI_DMA_Split(buf,datalen,part);
+	if(part[1]==0)return 1;					//没有完整的cache行,用查询方式
+	QSPI_IT_Buf=buf;
+	QUADSPI->DLR=datalen-1;					//设置数据传输长度
+	tempreg&=~(3<<26);						//清除FMODE原来的设置
+	tempreg|=1<<26;							//设置FMODE为间接读取模式
+	QUADSPI->FCR|=1<<1;						//清除TCF标志位
+	QUADSPI->CCR=tempreg;					//回写CCR寄存器
+	QUADSPI->AR=addrreg;					//回写AR寄存器,触发传输
+	if(QSPI_FIFO_Read(buf,part[0]))return QSPI_DMA_Finish(1);//头部,出错则终止传输
+	QSPI_DMA_Cache(buf+part[0],part[1],1);	//防止脏cache行在DMA期间写回覆盖数据
+	QSPI_DMA_Config(buf+part[0],part[1],0);	//外设到存储器
+	DMA2_Stream7->CR|=(1<<4)|(1<<2);		//使能传输完成和传输错误中断
+	NVIC_EnableIRQ(DMA2_Stream7_IRQn);
+	DMA2_Stream7->CR|=1<<0;					//开启数据流
+	QUADSPI->CR|=1<<2;						//使能QSPI的DMA请求
+	return 0;
+}
 
+//QSPI通过DMA发送指定长度的数据,不等待完成
+//数据全部移出后在QSPI传输完成中断里调用QSPI_IT_Done
+//buf:发送数据缓冲区首地址
+//datalen:要传输的数据长度,1~0XFFFF
+//返回值:0,已启动
+//    其他,错误代码
+u8 QSPI_Transmit_DMA_IT(u8* buf,u32 datalen)
+{
+	u32 tempreg=QUADSPI->CCR;
+	if(datalen==0||datalen>0XFFFF)return 1;
+	QSPI_IT_Buf=0;
+	QSPI_DMA_Cache(buf,datalen,0);			//把cache中的数据写回SRAM
+	QSPI_DMA_Config(buf,datalen,1);			//存储器到外设
+	QUADSPI->DLR=datalen-1;					//设置数据传输长度
+	tempreg&=~(3<<26);						//清除FMODE原来的设置
+	tempreg|=0<<26;							//设置FMODE为间接写入模式
+	QUADSPI->FCR|=(1<<1)|(1<<0);			//清除TCF和TEF标志位
+	QUADSPI->CCR=tempreg;					//回写CCR寄存器
+	QUADSPI->CR|=(1<<17)|(1<<16);			//使能传输完成和传输错误中断
+	NVIC_EnableIRQ(QUADSPI_IRQn);
+	DMA2_Stream7->CR|=1<<0;					//开启数据流
+	QUADSPI->CR|=1<<2;						//使能QSPI的DMA请求,开始搬运数据
+	return 0;
+}
 
+//QSPI发送无数据的命令(如写使能、擦除),不等待完成
+//指令发送完成后在QSPI传输完成中断里调用QSPI_IT_Done
+//参数同QSPI_Send_CMD,mode[7:6]必须为0
+//返回值:0,已启动
+//    其他,错误代码
+u8 QSPI_Send_CMD_IT(u8 cmd,u32 addr,u16 mode,u8 dmcycle)
+{
+	if(mode&0XC0)return 1;					//有数据阶段的用DMA中断方式
+	if(QSPI_MMAP_Sta)QSPI_Exit_MemoryMapped();	//ABORT会置位TCF,先退出再清标志
+	QSPI_IT_Buf=0;
+	QUADSPI->FCR|=(1<<1)|(1<<0);			//清除TCF和TEF标志位
+	if(QSPI_Start_CMD(cmd,addr,mode,dmcycle))return 1;
+	QUADSPI->CR|=(1<<17)|(1<<16);			//使能传输完成和传输错误中断,已完成也会立即进入中断
+	NVIC_EnableIRQ(QUADSPI_IRQn);
+	return 0;
+}
 
+//启动自动轮询,匹配后在QSPI中断里调用QSPI_IT_Done
+//参数同QSPI_AutoPolling_Start,回调里用QSPI_AutoPolling_Done读取状态
+//返回值:0,已启动
+//    其他,错误代码
+u8 QSPI_AutoPolling_Start_IT(u8 cmd,u32 addr,u16 mode,u8 mask,u8 match,u16 interval)
+{
+	if(QSPI_AutoPolling_Start(cmd,addr,mode,mask,match,interval))return 1;
+	NVIC_EnableIRQ(QUADSPI_IRQn);
+	QUADSPI->CR|=1<<19;						//使能状态匹配中断,启动后已匹配也会立即进入中断
+	return 0;
+}
 
+//DMA2数据流7中断,只有中断方式接收使能了它的中断
+void DMA2_Stream7_IRQHandler(void)
+{
+	u8 status;
+	u32 *part=QSPI_IT_Part;
+	status=(DMA2->HISR&(1<<27))?0:1;		//传输完成或传输错误
+	DMA2_Stream7->CR&=~((1<<4)|(1<<2));		//关闭中断
+	if(status)DMA2_Stream7->CR&=~(1<<0);	//出错,关闭数据流
+	QUADSPI->CR&=~(1<<2);					//关闭DMA请求,尾部由CPU读取
+	QSPI_DMA_Cache(QSPI_IT_Buf+part[0],part[1],2);//丢弃DMA期间预取的旧数据
+	if(status==0)status=QSPI_FIFO_Read(QSPI_IT_Buf+part[0]+part[1],part[2]);//尾部
+	status=QSPI_DMA_Finish(status);
+	if(QSPI_IT_Done)QSPI_IT_Done(status);
+}
 
+//QUADSPI中断,处理中断方式发送、无数据命令和自动轮询
+void QUADSPI_IRQHandler(void)
+{
+	u32 cr=QUADSPI->CR;
+	u32 sr=QUADSPI->SR;
+	if((cr&(1<<19))&&(sr&(1<<3)))			//状态匹配
+	{
+		QUADSPI->CR&=~(1<<19);				//关闭中断,SMF由QSPI_AutoPolling_Done清除
+		if(QSPI_IT_Done)QSPI_IT_Done(0);
+	}
+	if((cr&(3<<16))&&(sr&3))				//发送完成或传输错误
+	{
+		QUADSPI->CR&=~(3<<16);				//关闭中断
+		if(sr&(1<<0))
+		{
+			QUADSPI->FCR|=1<<0;				//清除TEF标志位
+			DMA2_Stream7->CR&=~(1<<0);		//关闭数据流
+		}
+		if(QSPI_IT_Done)QSPI_IT_Done(QSPI_DMA_Finish((sr&(1<<0))?1:0));
+	}
+}
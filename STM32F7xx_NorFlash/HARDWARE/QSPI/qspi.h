@@ -2,25 +2,69 @@
 #define __QSPI_H
 #include "sys.h"
 //////////////////////////////////////////////////////////////////////////////////	 
-//ֻѧϰʹãδɣκ;
-//ALIENTEK STM32 
-//QSPI 	   
-//ԭ@ALIENTEK
-//̳:www.openedv.com
-//:2016/7/18
-//汾V1.0
-//ȨУؾ
-//Copyright(C) ӿƼ޹˾ 2014-2024
+//本程序只供学习使用，未经作者许可，不得用于其它任何用途
+//ALIENTEK STM32开发板 
+//QSPI 驱动代码	   
+//正点原子@ALIENTEK
+//技术论坛:www.openedv.com
+//创建日期:2016/7/18
+//版本：V1.0
+//版权所有，盗版必究。
+//Copyright(C) 广州市星翼电子科技有限公司 2014-2024
 //All rights reserved									  
 ////////////////////////////////////////////////////////////////////////////////// 	 
  
 
+//FIFO阈值(字节),范围1~32.
+//查询方式下每次FTF置位后按FIFO中的字节数成字搬运,阈值越大查询标志的次数越少
+#define QSPI_FIFO_THRESHOLD		16
 
-u8 QSPI_Wait_Flag(u32 flag,u8 sta,u32 wtime);					//QSPIȴĳ״̬
-u8 QSPI_Init(void);												//ʼQSPI
-void QSPI_Send_CMD(u8 cmd,u32 addr,u8 mode,u8 dmcycle);			//QSPI
-u8 QSPI_Receive(u8* buf,u32 datalen);							//QSPI
-u8 QSPI_Transmit(u8* buf,u32 datalen);							//QSPI
+//定义QSPI_FIFO_BENCH时可用QSPI_FIFO_Word切换查询方式的FIFO访问宽度,用于测速
+//1,FIFO中够4字节且地址对齐时按字访问;0,全部按字节访问
+#ifdef QSPI_FIFO_BENCH
+extern u8 QSPI_FIFO_Word;
+#else
+#define QSPI_FIFO_Word			1
+#endif
+
+//D-Cache行大小(字节).DMA接收只写入对齐的整行,DMA后丢弃的只是这些行;
+//缓冲区首尾不满一行的部分由CPU从FIFO读取,旁边的变量在传输期间照常可写
+#define QSPI_DMA_LINE			32
+
+//QSPI时钟上限(Hz),SDR模式下为108Mhz
+#define QSPI_MAX_SPEED			108000000
+//QSPI_Init后的时钟(Hz),读SFDP等操作在此频率下进行
+#define QSPI_INIT_SPEED			10000000
+//片选高电平时间(ns),即FLASH手册里面的tSHSL参数
+#define QSPI_CS_HIGH_NS			50
+
+extern u8 QSPI_MMAP_Sta;											//内存映射模式状态
+
+u8 QSPI_Wait_Flag(u32 flag,u8 sta,u32 wtime);					//QSPI等待某个状态
+u8 QSPI_Init(void);												//初始化QSPI
+u32 QSPI_Set_Speed(u32 freq);									//设置QSPI时钟
+u8 QSPI_Set_Dual(u8 en);										//设置双闪存模式
+u8 QSPI_Set_Flash(u8 fsel);										//选择FLASH1或FLASH2
+u8 QSPI_Send_CMD(u8 cmd,u32 addr,u16 mode,u8 dmcycle);				//QSPI发送命令
+u8 QSPI_Receive(u8* buf,u32 datalen);							//QSPI接收数据
+u8 QSPI_Transmit(u8* buf,u32 datalen);							//QSPI发送数据
+u8 QSPI_Receive_DMA(u8* buf,u32 datalen);						//QSPI通过DMA接收数据
+u8 QSPI_Transmit_DMA(u8* buf,u32 datalen);						//QSPI通过DMA发送数据
+u8 QSPI_Receive_Seg(u8* const* buf,const u32* len,u8 cnt);		//QSPI连续接收多段数据
+u8 QSPI_Transmit_Seg(u8* const* buf,const u32* len,u8 cnt);		//QSPI连续发送多段数据
+u8 QSPI_Receive_DMA_Seg(u8* const* buf,const u32* len,u8 cnt);	//QSPI通过DMA连续接收多段数据
+u8 QSPI_Transmit_DMA_Seg(u8* const* buf,const u32* len,u8 cnt);	//QSPI通过DMA连续发送多段数据
+u8 QSPI_MemoryMapped(u8 cmd,u16 mode,u8 dmcycle);					//QSPI进入内存映射模式
+u8 QSPI_Exit_MemoryMapped(void);								//QSPI退出内存映射模式
+u8 QSPI_AutoPolling_Start(u8 cmd,u32 addr,u16 mode,u8 mask,u8 match,u16 interval);//QSPI启动自动轮询
+u8 QSPI_AutoPolling_Done(u8 *status);							//QSPI查询自动轮询是否匹配
+void QSPI_AutoPolling_Stop(void);								//QSPI终止自动轮询
+
+extern void (*QSPI_IT_Done)(u8 status);								//中断方式传输完成回调
+u8 QSPI_Receive_DMA_IT(u8* buf,u32 datalen);					//QSPI通过DMA接收数据,中断方式,至少含一个完整的cache行
+u8 QSPI_Transmit_DMA_IT(u8* buf,u32 datalen);					//QSPI通过DMA发送数据,中断方式
+u8 QSPI_Send_CMD_IT(u8 cmd,u32 addr,u16 mode,u8 dmcycle);		//QSPI发送无数据的命令,中断方式
+u8 QSPI_AutoPolling_Start_IT(u8 cmd,u32 addr,u16 mode,u8 mask,u8 match,u16 interval);//QSPI启动自动轮询,中断方式
 
 #endif
 
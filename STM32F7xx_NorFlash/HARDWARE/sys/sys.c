@@ -1,33 +1,34 @@
 #include "sys.h"  
 //////////////////////////////////////////////////////////////////////////////////	 
-//ֻѧϰʹãδɣκ;
-//ALIENTEK STM32
-//ϵͳʱӳʼ	
-//ʱ/жϹ/GPIOõ
-//ԭ@ALIENTEK
-//̳:www.openedv.com
-//:2016/7/8
-//汾V1.3
-//ȨУؾ
-//Copyright(C) ӿƼ޹˾ 2014-2024
+//本程序只供学习使用，未经作者许可，不得用于其它任何用途
+//ALIENTEK STM32开发板
+//系统时钟初始化	
+//包括时钟设置/中断管理/GPIO设置等
+//正点原子@ALIENTEK
+//技术论坛:www.openedv.com
+//创建日期:2016/7/8
+//版本：V1.3
+//版权所有，盗版必究。
+//Copyright(C) 广州市星翼电子科技有限公司 2014-2024
 //All rights reserved
 //********************************************************************************
-//޸˵
+//修改说明
 //V1.1 20160708 
-//ֲF429,F7Ӧ޸
+//移植自F429的例程,针对F7做了相应修改
 //V1.2 20160814
-//޸Sys_Clock_Set,PWR->CR1λ17,羭ʼɹbug,
+//修改Sys_Clock_Set,新增对PWR->CR1位17的设置,解决网络经常初始化不成功的bug,
 //V1.3 20160922
-//1,޸cacheƴд.
-//2,pllnȡֵΧμӢİ,STM32F7xxοֲᣩ
+//1,修改cache的拼写错误.
+//2,改正plln的取值范围（参见英文版,STM32F7xx参考手册）
 //////////////////////////////////////////////////////////////////////////////////  
 
+u32 SystemCoreClock=16000000;	//内核时钟频率,复位后默认使用HSI,即16Mhz
 
-//GPIO
+//GPIO复用设置
 //GPIOx:GPIOA~GPIOI.
-//BITx:0~15,IOű.
-//AFx:0~15,AF0~AF15.
-//AF0~15(гõ,ϸ429/746ֲ,Table 12):
+//BITx:0~15,代表IO引脚编号.
+//AFx:0~15,代表AF0~AF15.
+//AF0~15设置情况(这里仅是列出常用的,详细的请见429/746数据手册,Table 12):
 //AF0:MCO/SWD/SWCLK/RTC   		AF1:TIM1/TIM2;            		AF2:TIM3~5;               		AF3:TIM8~11
 //AF4:I2C1~I2C4;          		AF5:SPI1~SPI6;            		AF6:SPI3/SAI1;            	 	AF7:SPI2/3/USART1~3/UART5/SPDIFRX;
 //AF8:USART4~8/SPDIFRX/SAI2; 	AF9;CAN1~2/TIM12~14/LCD/QSPI; 	AF10:USB_OTG/USB_HS/SAI2/QSPI  	AF11:ETH
@@ -37,52 +38,107 @@ void GPIO_AF_Set(GPIO_TypeDef* GPIOx,u8 BITx,u8 AFx)
 	GPIOx->AFR[BITx>>3]&=~(0X0F<<((BITx&0X07)*4));
 	GPIOx->AFR[BITx>>3]|=(u32)AFx<<((BITx&0X07)*4);
 }   
-//GPIOͨ 
+//GPIO通用设置 
 //GPIOx:GPIOA~GPIOI.
-//BITx:0X0000~0XFFFF,λ,ÿλһIO,0λPx0,1λPx1,.0X0101,ͬʱPx0Px8.
-//MODE:0~3;ģʽѡ,0,(ϵͳλĬ״̬);1,ͨ;2,ù;3,ģ.
-//OTYPE:0/1;ѡ,0,;1,©.
-//OSPEED:0~3;ٶ,0,;1,;2,;3,. 
-//PUPD:0~3:,0,;1,;2,;3,.
-//ע:ģʽ(ͨ/ģ),OTYPEOSPEEDЧ!!
+//BITx:0X0000~0XFFFF,位设置,每个位代表一个IO,第0位代表Px0,第1位代表Px1,依次类推.比如0X0101,代表同时设置Px0和Px8.
+//MODE:0~3;模式选择,0,输入(系统复位默认状态);1,普通输出;2,复用功能;3,模拟输入.
+//OTYPE:0/1;输出类型选择,0,推挽输出;1,开漏输出.
+//OSPEED:0~3;输出速度设置,0,低速;1,中速;2,快速;3,高速. 
+//PUPD:0~3:上下拉设置,0,不带上下拉;1,上拉;2,下拉;3,保留.
+//注意:在输入模式(普通输入/模拟输入)下,OTYPE和OSPEED参数无效!!
 void GPIO_Set(GPIO_TypeDef* GPIOx,u32 BITx,u32 MODE,u32 OTYPE,u32 OSPEED,u32 PUPD)
 {  
 	u32 pinpos=0,pos=0,curpin=0;
 	for(pinpos=0;pinpos<16;pinpos++)
 	{
-		pos=1<<pinpos;	//һλ 
-		curpin=BITx&pos;//ǷҪ
-		if(curpin==pos)	//Ҫ
+		pos=1<<pinpos;	//一个个位检查 
+		curpin=BITx&pos;//检查引脚是否要设置
+		if(curpin==pos)	//需要设置
 		{
-			GPIOx->MODER&=~(3<<(pinpos*2));	//ԭ
-			GPIOx->MODER|=MODE<<(pinpos*2);	//µģʽ 
-			if((MODE==0X01)||(MODE==0X02))	//ģʽ/ùģʽ
+			GPIOx->MODER&=~(3<<(pinpos*2));	//先清除原来的设置
+			GPIOx->MODER|=MODE<<(pinpos*2);	//设置新的模式 
+			if((MODE==0X01)||(MODE==0X02))	//如果是输出模式/复用功能模式
 			{  
-				GPIOx->OSPEEDR&=~(3<<(pinpos*2));	//ԭ
-				GPIOx->OSPEEDR|=(OSPEED<<(pinpos*2));//µٶֵ  
-				GPIOx->OTYPER&=~(1<<pinpos) ;		//ԭ
-				GPIOx->OTYPER|=OTYPE<<pinpos;		//µģʽ
+				GPIOx->OSPEEDR&=~(3<<(pinpos*2));	//清除原来的设置
+				GPIOx->OSPEEDR|=(OSPEED<<(pinpos*2));//设置新的速度值  
+				GPIOx->OTYPER&=~(1<<pinpos) ;		//清除原来的设置
+				GPIOx->OTYPER|=OTYPE<<pinpos;		//设置新的输出模式
 			}  
-			GPIOx->PUPDR&=~(3<<(pinpos*2));	//ԭ
-			GPIOx->PUPDR|=PUPD<<(pinpos*2);	//µ
+			GPIOx->PUPDR&=~(3<<(pinpos*2));	//先清除原来的设置
+			GPIOx->PUPDR|=PUPD<<(pinpos*2);	//设置新的上下拉
 		}
 	}
 } 
-//GPIOĳŵ״̬
+//设置GPIO某个引脚的输出状态
 //GPIOx:GPIOA~GPIOI.
-//pinx:ű,Χ:0~15
-//status:״̬(λЧ),0,͵ƽ;1,ߵƽ
+//pinx:引脚编号,范围:0~15
+//status:引脚状态(仅最低位有效),0,输出低电平;1,输出高电平
 void GPIO_Pin_Set(GPIO_TypeDef* GPIOx,u16 pinx,u8 status)
 {
-	if(status&0X01)GPIOx->BSRR=pinx;	//GPIOxpinxΪ1
-	else GPIOx->BSRR=pinx<<16;			//GPIOxpinxΪ0
+	if(status&0X01)GPIOx->BSRR=pinx;	//设置GPIOx的pinx为1
+	else GPIOx->BSRR=pinx<<16;			//设置GPIOx的pinx为0
 }
-//ȡGPIOĳŵ״̬
+//读取GPIO某个引脚的状态
 //GPIOx:GPIOA~GPIOI.
-//pinx:ű,Χ:0~15
-//ֵ:״̬,0,ŵ͵ƽ;1,Ÿߵƽ
+//pinx:引脚编号,范围:0~15
+//返回值:引脚状态,0,引脚低电平;1,引脚高电平
 u8 GPIO_Pin_Get(GPIO_TypeDef* GPIOx,u16 pinx)
 { 
-	if(GPIOx->IDR&pinx)return 1;		//pinx״̬Ϊ1
-	else return 0;						//pinx״̬Ϊ0
+	if(GPIOx->IDR&pinx)return 1;		//pinx的状态为1
+	else return 0;						//pinx的状态为0
+}
+
+//时钟设置函数,PLL时钟源为HSI(16Mhz)
+//Fvco=16Mhz*(plln/pllm);
+//Fsys=Fvco/pllp=16Mhz*(plln/(pllm*pllp));
+//Fq=Fvco/pllq=16Mhz*(plln/(pllm*pllq));
+//plln:主PLL倍频系数(PLL倍频),取值范围:50~432.
+//pllm:主PLL和音频PLL分频系数(PLL之前的分频),取值范围:2~63.
+//pllp:系统时钟的主PLL分频系数(PLL之后的分频),取值范围:2,4,6,8.(仅限这4个值!)
+//pllq:USB/SDIO/随机数产生器等的主PLL分频系数(PLL之后的分频),取值范围:2~15.
+//下载算法运行时不能依赖板上的外部晶振,所以使用HSI.
+//例如plln=208,pllm=8,pllp=2,pllq=9时:
+//     Fvco=16*(208/8)=416Mhz
+//     Fsys=416/2=208Mhz
+//     Fq=416/9=46.2Mhz
+//已经运行在PLL上时可以重复调用,会先切回HSI再重新配置PLL.
+//返回值:0,成功;1,失败(失败时保持在HSI)
+u8 Sys_Clock_Set(u32 plln,u32 pllm,u32 pllp,u32 pllq)
+{ 
+	u32 retry=0;
+	u32 fsys=16000000/pllm*plln/pllp;			//目标系统时钟
+	RCC->CR|=1<<0;								//HSI开启
+	while((RCC->CR&(1<<1))==0);					//等待HSI RDY
+	RCC->CFGR&=~(3<<0);							//先切换到HSI,PLL运行时不能修改配置
+	while((RCC->CFGR&(3<<2))!=0);				//等待HSI作为系统时钟成功
+	SystemCoreClock=16000000;
+	RCC->CR&=~(1<<24);							//关闭主PLL
+	while(RCC->CR&(1<<25));						//等待PLL关闭
+	RCC->APB1ENR|=1<<28;						//电源接口时钟使能
+	PWR->CR1|=3<<14; 							//高性能模式,时钟可到180Mhz
+	RCC->PLLCFGR=pllm|(plln<<6)|(((pllp>>1)-1)<<16)|(pllq<<24)|(0<<22);//配置主PLL,PLL时钟源来自HSI
+	RCC->CR|=1<<24;								//打开主PLL
+	while(((RCC->CR&(1<<25))==0)&&(retry<0XFFFF))retry++;//等待PLL准备好
+	if(retry==0XFFFF)return 1;					//PLL无法锁定
+	if(fsys>180000000)
+	{
+		PWR->CR1|=1<<16; 						//使能过驱动,频率可到216Mhz
+		retry=0;
+		while(((PWR->CSR1&(1<<16))==0)&&(retry<0XFFFF))retry++;//等待过驱动就绪
+		if(retry==0XFFFF)return 1;				//过驱动无法就绪
+		PWR->CR1|=1<<17; 						//使能过驱动切换
+		retry=0;
+		while(((PWR->CSR1&(1<<17))==0)&&(retry<0XFFFF))retry++;//等待过驱动切换完成
+		if(retry==0XFFFF)return 1;				//过驱动切换失败
+	}
+	FLASH->ACR&=~(0X0F<<0);						//清零
+	FLASH->ACR|=(fsys-1)/30000000;				//等待周期,2.7~3.6V时每30Mhz加1个
+	FLASH->ACR|=1<<8;							//指令预取使能.
+	FLASH->ACR|=1<<9;							//使能ART Accelerator 
+	RCC->CFGR&=~(0XFFF<<4);						//清零
+	RCC->CFGR|=(0<<4)|(5<<10)|(4<<13);			//HCLK 不分频;APB1 4分频;APB2 2分频. 
+	RCC->CFGR|=2<<0;							//选择主PLL作为系统时钟	 
+	while((RCC->CFGR&(3<<2))!=(2<<2));			//等待主PLL作为系统时钟成功. 
+	SystemCoreClock=fsys;
+	return 0;
 }
@@ -2,33 +2,33 @@
 #define __SYS_H	 
 #include "stm32f7xx.h" 
 //////////////////////////////////////////////////////////////////////////////////	 
-//ֻѧϰʹãδɣκ;
-//ALIENTEK STM32
-//ϵͳʱӳʼ	
-//ʱ/жϹ/GPIOõ
-//ԭ@ALIENTEK
-//̳:www.openedv.com
-//:2016/7/8
-//汾V1.3
-//ȨУؾ
-//Copyright(C) ӿƼ޹˾ 2014-2024
+//本程序只供学习使用，未经作者许可，不得用于其它任何用途
+//ALIENTEK STM32开发板
+//系统时钟初始化	
+//包括时钟设置/中断管理/GPIO设置等
+//正点原子@ALIENTEK
+//技术论坛:www.openedv.com
+//创建日期:2016/7/8
+//版本：V1.3
+//版权所有，盗版必究。
+//Copyright(C) 广州市星翼电子科技有限公司 2014-2024
 //All rights reserved
 //********************************************************************************
-//޸˵
+//修改说明
 //V1.1 20160708 
-//ֲF429,F7Ӧ޸
+//移植自F429的例程,针对F7做了相应修改
 //V1.2 20160814
-//޸Sys_Clock_Set,PWR->CR1λ17,羭ʼɹbug,
+//修改Sys_Clock_Set,新增对PWR->CR1位17的设置,解决网络经常初始化不成功的bug,
 //V1.3 20160922
-//1,޸cacheƴд.
-//2,pllnȡֵΧμӢİ,STM32F7xxοֲᣩ
+//1,修改cache的拼写错误.
+//2,改正plln的取值范围（参见英文版,STM32F7xx参考手册）
 //////////////////////////////////////////////////////////////////////////////////  
 
-//0,֧OS
-//1,֧OS
-#define SYSTEM_SUPPORT_OS		0		//ϵͳļǷ֧OS
+//0,不支持OS
+//1,支持OS
+#define SYSTEM_SUPPORT_OS		0		//定义系统文件夹是否支持OS
 ///////////////////////////////////////////////////////////////////////////////////
-//һЩõͶ̹ؼ 
+//定义一些常用的数据类型短关键字 
 typedef uint32_t  u32;
 typedef uint16_t u16;
 typedef uint8_t  u8;
@@ -38,7 +38,7 @@ typedef volatile uint16_t vu16;
 typedef volatile uint8_t  vu8; 
 
 ////////////////////////////////////////////////////////////////////////////////// 
-//Ex_NVIC_Configרö
+//Ex_NVIC_Config专用定义
 #define GPIO_A 				0
 #define GPIO_B 				1
 #define GPIO_C				2
@@ -49,29 +49,29 @@ typedef volatile uint8_t  vu8;
 #define GPIO_H 				7 
 #define GPIO_I 				8 
 
-#define FTIR   				1  		//½ش
-#define RTIR   				2  		//ش
+#define FTIR   				1  		//下降沿触发
+#define RTIR   				2  		//上升沿触发
 
-//GPIOרú궨
-#define GPIO_MODE_IN    	0		//ͨģʽ
-#define GPIO_MODE_OUT		1		//ͨģʽ
-#define GPIO_MODE_AF		2		//AFģʽ
-#define GPIO_MODE_AIN		3		//ģģʽ
+//GPIO设置专用宏定义
+#define GPIO_MODE_IN    	0		//普通输入模式
+#define GPIO_MODE_OUT		1		//普通输出模式
+#define GPIO_MODE_AF		2		//AF功能模式
+#define GPIO_MODE_AIN		3		//模拟输入模式
 
-#define GPIO_SPEED_2M		0		//GPIOٶ2Mhz()
-#define GPIO_SPEED_25M		1		//GPIOٶ25Mhz()
-#define GPIO_SPEED_50M		2		//GPIOٶ50Mhz()
-#define GPIO_SPEED_100M		3		//GPIOٶ100Mhz()
+#define GPIO_SPEED_2M		0		//GPIO速度2Mhz(低速)
+#define GPIO_SPEED_25M		1		//GPIO速度25Mhz(中速)
+#define GPIO_SPEED_50M		2		//GPIO速度50Mhz(快速)
+#define GPIO_SPEED_100M		3		//GPIO速度100Mhz(高速)
 
-#define GPIO_PUPD_NONE		0		//
-#define GPIO_PUPD_PU		1		//
-#define GPIO_PUPD_PD		2		//
-#define GPIO_PUPD_RES		3		// 
+#define GPIO_PUPD_NONE		0		//不带上下拉
+#define GPIO_PUPD_PU		1		//上拉
+#define GPIO_PUPD_PD		2		//下拉
+#define GPIO_PUPD_RES		3		//保留 
 
-#define GPIO_OTYPE_PP		0		//
-#define GPIO_OTYPE_OD		1		//© 
+#define GPIO_OTYPE_PP		0		//推挽输出
+#define GPIO_OTYPE_OD		1		//开漏输出 
 
-//GPIOűŶ
+//GPIO引脚编号定义
 #define PIN0				1<<0
 #define PIN1				1<<1
 #define PIN2				1<<2
@@ -91,10 +91,11 @@ typedef volatile uint8_t  vu8;
 ////////////////////////////////////////////////////////////////////////////////// 
 
 
-void GPIO_AF_Set(GPIO_TypeDef* GPIOx,u8 BITx,u8 AFx);		//GPIOù
-void GPIO_Set(GPIO_TypeDef* GPIOx,u32 BITx,u32 MODE,u32 OTYPE,u32 OSPEED,u32 PUPD);//GPIOú 
-void GPIO_Pin_Set(GPIO_TypeDef* GPIOx,u16 pinx,u8 status);	//ĳIOڵ״̬
-u8 GPIO_Pin_Get(GPIO_TypeDef* GPIOx,u16 pinx);				//ȡĳIOڵ״̬
+void GPIO_AF_Set(GPIO_TypeDef* GPIOx,u8 BITx,u8 AFx);		//GPIO复用功能设置
+void GPIO_Set(GPIO_TypeDef* GPIOx,u32 BITx,u32 MODE,u32 OTYPE,u32 OSPEED,u32 PUPD);//GPIO设置函数 
+void GPIO_Pin_Set(GPIO_TypeDef* GPIOx,u16 pinx,u8 status);	//设置某个IO口的输出状态
+u8 GPIO_Pin_Get(GPIO_TypeDef* GPIOx,u16 pinx);				//读取某个IO口的输入状态
+u8 Sys_Clock_Set(u32 plln,u32 pllm,u32 pllp,u32 pllq);		//系统时钟设置
 
 #endif
 
@@ -0,0 +1,118 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024, sakumisu
+#
+# SPDX-License-Identifier: Apache-2.0
+#
+"""Generate FlashLayout.h (FlashDevice sector list) from an SFDP dump.
+
+The dump is the raw output of the READ SFDP (0x5A) command starting at
+address 0, at least up to the end of the JEDEC basic flash parameter table
+(256 bytes is enough for every part seen so far).
+
+Erase units are picked the same way chry_sflash_norflash_init() does:
+the smallest erase type is the sector, the largest one below 1 MB is the
+block. The first --sector-area bytes keep sector granularity, the rest of
+the device is described in blocks so EraseSector issues block erases.
+With --dual the layout is that of two such parts in dual-flash mode, size,
+erase units and the default sector area are doubled.
+
+    python3 gen_flashlayout.py w25q128.sfdp -o ../FlashLayout.h
+"""
+
+import argparse
+import struct
+import sys
+
+
+def parse_bfpt(dump):
+    if len(dump) < 16 or dump[0:4] != b"SFDP":
+        raise ValueError("no SFDP signature")
+
+    # first parameter header is always the JEDEC basic flash parameter table
+    length = dump[11] * 4
+    ptp = dump[12] | (dump[13] << 8) | (dump[14] << 16)
+    if length < 36 or ptp + length > len(dump):
+        raise ValueError("basic flash parameter table truncated")
+    return struct.unpack_from("<%dI" % (length // 4), dump, ptp)
+
+
+def flash_size(bfpt):
+    density = bfpt[1]
+    if density & 0x80000000:
+        return (1 << (density & 0x7FFFFFFF)) // 8
+    return (density + 1) // 8
+
+
+def erase_types(bfpt):
+    types = []
+    for dword in bfpt[7:9]:
+        for shift in (0, 16):
+            size_exp = (dword >> shift) & 0xFF
+            inst = (dword >> (shift + 8)) & 0xFF
+            if size_exp != 0 and (1 << size_exp) >= 1024:
+                types.append((1 << size_exp, inst))
+    if not types:
+        raise ValueError("no erase types described")
+    return types
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("sfdp", help="raw SFDP dump")
+    parser.add_argument("-o", "--output", help="output header (default stdout)")
+    parser.add_argument("-n", "--name", default="STM32F7_NORFLASH_BLOCK",
+                        help="FlashDevice device name")
+    parser.add_argument("--sector-area", type=lambda x: int(x, 0), default=None,
+                        help="bytes at the start kept at sector granularity (default 64 KB, 128 KB with --dual)")
+    parser.add_argument("--dual", action="store_true",
+                        help="two parts in dual-flash mode (FLM_DUAL)")
+    args = parser.parse_args()
+
+    with open(args.sfdp, "rb") as f:
+        bfpt = parse_bfpt(f.read())
+
+    size = flash_size(bfpt)
+    types = erase_types(bfpt)
+    if args.dual:
+        size *= 2
+        types = [(s * 2, i) for s, i in types]
+    if args.sector_area is None:
+        args.sector_area = 0x20000 if args.dual else 0x10000
+    sector = min(types)
+    block = max(t for t in types if t[0] < 1024 * 1024)
+
+    sector_area = min(args.sector_area, size)
+    sector_area -= sector_area % block[0]
+
+    lines = [
+        "/*",
+        " * Generated by tools/gen_flashlayout.py, do not edit.",
+        " * Erase types:%s" % "".join(" %dKB(0x%02X)" % (s // 1024, i) for s, i in sorted(types)),
+        " */",
+        "#ifndef FLASH_LAYOUT_H",
+        "#define FLASH_LAYOUT_H",
+        "",
+        "#define FLASH_LAYOUT_NAME      \"%s\"" % args.name,
+        "#define FLASH_LAYOUT_SIZE      0x%08X" % size,
+        "",
+        "#define FLASH_LAYOUT_SECTORS \\",
+    ]
+    if sector_area:
+        lines.append("   0x%06X, 0x%06X,         /* %d x %dKB, erase 0x%02X */ \\" %
+                     (sector[0], 0, sector_area // sector[0], sector[0] // 1024, sector[1]))
+    if size > sector_area:
+        lines.append("   0x%06X, 0x%06X,         /* %d x %dKB, erase 0x%02X */" %
+                     (block[0], sector_area, (size - sector_area) // block[0], block[0] // 1024, block[1]))
+    else:
+        lines[-1] = lines[-1].rstrip(" \\")
+    lines += ["", "#endif", ""]
+
+    out = open(args.output, "w", newline="\n") if args.output else sys.stdout
+    out.write("\n".join(lines))
+    if args.output:
+        out.close()
+
+
+if __name__ == "__main__":
+    main()